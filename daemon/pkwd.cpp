@@ -0,0 +1,90 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkwd_server.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <typeinfo>
+
+/*
+ * pkwd: serves wrap, unwrap and puncture requests on a Unix domain socket, see PKWDServer.
+ *
+ * usage: pkwd --socket <path> --key <path> [--tag-len <bits>] [--key-len <bits>] [--password-env <variable>]
+ *
+ * The key file is created with a fresh key if it does not exist. With --password-env, the key file is encrypted with
+ * the password held in the given environment variable.
+ */
+
+static PKWDServer *server = nullptr;
+
+static void onSignal(int) {
+    if (server) {
+        server->stop();
+    }
+}
+
+static int usage() {
+    std::cerr << "usage: pkwd --socket <path> --key <path> [--tag-len <bits>] [--key-len <bits>] [--password-env <variable>]"
+              << std::endl;
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    PKWDConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--socket") {
+            config.socketPath = argv[i + 1];
+        } else if (arg == "--key") {
+            config.keyPath = argv[i + 1];
+        } else if (arg == "--tag-len") {
+            config.tagLen = std::atoi(argv[i + 1]);
+        } else if (arg == "--key-len") {
+            config.keyLen = std::atoi(argv[i + 1]);
+        } else if (arg == "--password-env") {
+            const char *password = std::getenv(argv[i + 1]);
+            if (!password) {
+                std::cerr << "pkwd: " << argv[i + 1] << " is not set" << std::endl;
+                return 2;
+            }
+            config.password = password;
+        } else {
+            return usage();
+        }
+    }
+    if (argc % 2 == 0 || config.socketPath.empty() || config.keyPath.empty()) {
+        return usage();
+    }
+    try {
+        PKWDServer pkwd(config);
+        server = &pkwd;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        pkwd.run();
+        server = nullptr;
+    } catch (std::exception &e) {
+        server = nullptr;
+        std::cerr << "pkwd: failed (" << typeid(e).name() << ")" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkwd_client.h"
+#include "pkw/exceptions.h"
+#include "secure_memzero.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::vector;
+
+PKWDClient::PKWDClient(const std::string &socketPath) : fd(-1), nextId(0) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path)) {
+        throw StreamException();
+    }
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr *) &addr, sizeof(addr)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw StreamException();
+    }
+}
+
+PKWDClient::~PKWDClient() {
+    wipe(buffer);
+    ::close(fd);
+}
+
+vector<unsigned char> PKWDClient::wrap(const Tag &tag, const vector<unsigned char> &header, const vector<unsigned char> &key) {
+    PKWDResponse response = call(PKWDOp::Wrap, tag, header, key);
+    if (response.status != PKWError::None) {
+        throwPKWError(response.status);
+    }
+    return std::move(response.data);
+}
+
+vector<unsigned char> PKWDClient::unwrap(const Tag &tag, const vector<unsigned char> &header, const vector<unsigned char> &c) {
+    PKWDResponse response = call(PKWDOp::Unwrap, tag, header, c);
+    if (response.status != PKWError::None) {
+        throwPKWError(response.status);
+    }
+    return std::move(response.data);
+}
+
+void PKWDClient::punc(const Tag &tag) {
+    PKWDResponse response = call(PKWDOp::Punc, tag, {}, {});
+    if (response.status != PKWError::None) {
+        throwPKWError(response.status);
+    }
+}
+
+long PKWDClient::getNumPuncs() {
+    PKWDResponse response = call(PKWDOp::NumPuncs, Tag(), {}, {});
+    if (response.data.size() != 8) {
+        throw StreamException();
+    }
+    uint64_t puncs = 0;
+    for (int i = 0; i < 8; ++i) {
+        puncs |= uint64_t(response.data[i]) << (8 * i);
+    }
+    return (long) puncs;
+}
+
+static void sendAll(int fd, const vector<unsigned char> &out) {
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t w = ::send(fd, out.data() + done, out.size() - done, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            throw StreamException();
+        }
+        done += w;
+    }
+}
+
+/* sends out and wipes it, also if sending fails; it holds the keys of Wrap requests */
+static void sendWiping(int fd, vector<unsigned char> &out) {
+    try {
+        sendAll(fd, out);
+    } catch (StreamException &e) {
+        wipe(out);
+        throw;
+    }
+    wipe(out);
+}
+
+PKWDResponse PKWDClient::call(PKWDOp op, const Tag &tag, const vector<unsigned char> &header, const vector<unsigned char> &data) {
+    PKWDRequest request{op, ++nextId, tag, header, data};
+    vector<unsigned char> out;
+    reserveWiping(out, requestFrameLength(request));
+    encodeRequest(request, out);
+    wipe(request.data);
+    sendWiping(fd, out);
+    PKWDResponse response = receive();
+    if (response.id != request.id) {
+        throw StreamException();
+    }
+    return response;
+}
+
+vector<PKWDResponse> PKWDClient::pipeline(vector<PKWDRequest> &requests) {
+    size_t len = 0;
+    for (const PKWDRequest &request: requests) {
+        len += requestFrameLength(request);
+    }
+    vector<unsigned char> out;
+    reserveWiping(out, len);
+    for (PKWDRequest &request: requests) {
+        request.id = ++nextId;
+        encodeRequest(request, out);
+    }
+    sendWiping(fd, out);
+    vector<PKWDResponse> responses;
+    for (const PKWDRequest &request: requests) {
+        responses.push_back(receive());
+        if (responses.back().id != request.id) {
+            throw StreamException();
+        }
+    }
+    return responses;
+}
+
+PKWDResponse PKWDClient::receive() {
+    size_t bodyLen = 0;
+    while (!frameLength(buffer.data(), buffer.size(), bodyLen) || buffer.size() - PKWD_LENGTH_LEN < bodyLen) {
+        if (bodyLen > PKWD_MAX_RESPONSE) {
+            throw StreamException();
+        }
+        unsigned char chunk[4096];
+        ssize_t r = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            throw StreamException();
+        }
+        reserveWiping(buffer, buffer.size() + r);
+        buffer.insert(buffer.end(), chunk, chunk + r);
+        secure_memzero(chunk, r);
+    }
+    PKWDResponse response;
+    if (!decodeResponse(buffer.data() + PKWD_LENGTH_LEN, bodyLen, response)) {
+        throw StreamException();
+    }
+    consume(buffer, PKWD_LENGTH_LEN + bodyLen);
+    return response;
+}
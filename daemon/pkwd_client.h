@@ -0,0 +1,90 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_CLIENT_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_CLIENT_H
+
+#include "pkwd_protocol.h"
+#include <string>
+#include <vector>
+
+/**
+ * A blocking client of pkwd. Not thread-safe; use one client per thread.
+ */
+class PKWDClient {
+    public:
+        /**
+         * Connects to the daemon.
+         * @param socketPath the path of its Unix domain socket
+         * @throws StreamException if the connection fails
+         */
+        explicit PKWDClient(const std::string &socketPath);
+
+        ~PKWDClient();
+
+        PKWDClient(const PKWDClient &) = delete;
+        PKWDClient &operator=(const PKWDClient &) = delete;
+
+        /**
+         * Wraps a key, see PPRF_AEAD_PKW::wrap.
+         * @throws IllegalTagException, WrappingException as PPRF_AEAD_PKW::wrap
+         * @throws StreamException on a connection error
+         */
+        std::vector<unsigned char> wrap(const Tag &tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &key);
+
+        /**
+         * Unwraps a key, see PPRF_AEAD_PKW::unwrap.
+         * @throws IllegalTagException, UnwrappingException as PPRF_AEAD_PKW::unwrap
+         * @throws StreamException on a connection error
+         */
+        std::vector<unsigned char> unwrap(const Tag &tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &c);
+
+        /**
+         * Punctures the daemon's key on tag. Returns once the puncture is committed to the key file.
+         * @throws IllegalTagException if the size of the tag exceeds the tag length
+         * @throws StreamException on a connection error
+         */
+        void punc(const Tag &tag);
+
+        /**
+         * Returns the number of punctures of the daemon's key.
+         * @throws StreamException on a connection error
+         */
+        long getNumPuncs();
+
+        /**
+         * Sends all requests before reading any response, so the daemon can evaluate them in one batch. Request ids
+         * are assigned by the client.
+         * @param requests the requests
+         * @return the responses, in the order of the requests
+         * @throws StreamException on a connection error
+         */
+        std::vector<PKWDResponse> pipeline(std::vector<PKWDRequest> &requests);
+
+    private:
+        int fd;
+        uint32_t nextId;
+        std::vector<unsigned char> buffer;
+
+        PKWDResponse call(PKWDOp op, const Tag &tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &data);
+        PKWDResponse receive();
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_CLIENT_H
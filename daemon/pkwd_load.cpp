@@ -0,0 +1,151 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkwd_client.h"
+#include "pkwd_server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Load generator for pkwd.
+ *
+ * usage: pkwd_load [--socket <path>] [--clients <n>] [--ops <n>] [--pipeline <depth>] [--punc-ratio <p>]
+ *
+ * Every client thread opens a connection and sends --ops requests in rounds of --pipeline requests: wraps of random
+ * tags, unwraps of its earlier ciphertexts and, with probability --punc-ratio, punctures. Reports throughput and the
+ * latency of a round. Without --socket, an in-process daemon with a temporary key file is started.
+ */
+
+struct LoadConfig {
+    std::string socketPath;
+    int clients = 8;
+    long ops = 20000;
+    int pipeline = 16;
+    double puncRatio = 0.01;
+};
+
+static void runClient(const LoadConfig &config, int seed, std::vector<double> &latencies) {
+    PKWDClient client(config.socketPath);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    std::vector<PKWDRequest> wrapped;
+    for (long done = 0; done < config.ops; done += config.pipeline) {
+        std::vector<PKWDRequest> requests;
+        for (int i = 0; i < config.pipeline; ++i) {
+            double r = coin(rng);
+            if (r < config.puncRatio) {
+                requests.push_back({PKWDOp::Punc, 0, Tag(rng() & 0xfffff), {}, {}});
+            } else if (r < 0.5 || wrapped.empty()) {
+                requests.push_back({PKWDOp::Wrap, 0, Tag(rng() & 0xfffff), header, key});
+            } else {
+                requests.push_back(wrapped[rng() % wrapped.size()]);
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::vector<PKWDResponse> responses = client.pipeline(requests);
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            if (requests[i].op == PKWDOp::Wrap && responses[i].status == PKWError::None && wrapped.size() < 1024) {
+                wrapped.push_back({PKWDOp::Unwrap, 0, requests[i].tag, header, responses[i].data});
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    LoadConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--socket") {
+            config.socketPath = argv[i + 1];
+        } else if (arg == "--clients") {
+            config.clients = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--ops") {
+            config.ops = std::max(1L, std::atol(argv[i + 1]));
+        } else if (arg == "--pipeline") {
+            config.pipeline = std::max(1, std::atoi(argv[i + 1]));
+        } else if (arg == "--punc-ratio") {
+            config.puncRatio = std::atof(argv[i + 1]);
+        } else {
+            std::cerr << "usage: pkwd_load [--socket <path>] [--clients <n>] [--ops <n>] [--pipeline <depth>] "
+                         "[--punc-ratio <p>]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    std::unique_ptr<PKWDServer> server;
+    std::thread serverThread;
+    std::string dir;
+    if (config.socketPath.empty()) {
+        char tmpl[] = "/tmp/pkwd_load.XXXXXX";
+        if (!::mkdtemp(tmpl)) {
+            std::cerr << "pkwd_load: cannot create a temporary directory" << std::endl;
+            return 1;
+        }
+        dir = tmpl;
+        PKWDConfig serverConfig;
+        serverConfig.socketPath = dir + "/pkwd.sock";
+        serverConfig.keyPath = dir + "/pkwd.key";
+        server.reset(new PKWDServer(serverConfig));
+        serverThread = std::thread([&server]() { server->run(); });
+        config.socketPath = serverConfig.socketPath;
+    }
+
+    std::vector<std::vector<double>> latencies(config.clients);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < config.clients; ++c) {
+        clients.emplace_back(runClient, std::cref(config), c, std::ref(latencies[c]));
+    }
+    for (std::thread &t: clients) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto &l: latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    long rounds = (long) all.size();
+    long requests = rounds * config.pipeline;
+    std::printf("clients=%d pipeline=%d requests=%ld seconds=%.3f ops_per_second=%.0f\n", config.clients,
+                config.pipeline, requests, seconds, requests / seconds);
+    std::printf("round_latency_us p50=%.1f p99=%.1f max=%.1f\n", all[rounds / 2], all[rounds * 99 / 100], all.back());
+    if (server) {
+        std::printf("batches=%zu commits=%zu requests_per_batch=%.1f\n", server->getNumBatches(),
+                    server->getNumCommits(), (double) requests / server->getNumBatches());
+        server->stop();
+        serverThread.join();
+        server.reset();
+        std::remove((dir + "/pkwd.key").c_str());
+        ::rmdir(dir.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkwd_protocol.h"
+#include "secure_memzero.h"
+#include <algorithm>
+#include <cstring>
+
+using std::vector;
+
+static const size_t TAG_BYTES = MAX_TAG_LEN / 8;
+
+static void putU32(vector<unsigned char> &out, size_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((unsigned char) (v >> (8 * i)));
+    }
+}
+
+static uint32_t getU32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= uint32_t(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+static void putBytes(vector<unsigned char> &out, const vector<unsigned char> &bytes) {
+    putU32(out, bytes.size());
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * Reads a length-prefixed byte string at pos, advancing pos.
+ * @return false if it exceeds the body
+ */
+static bool getBytes(const unsigned char *body, size_t len, size_t &pos, vector<unsigned char> &out) {
+    if (len - pos < 4) {
+        return false;
+    }
+    size_t n = getU32(body + pos);
+    pos += 4;
+    if (len - pos < n) {
+        return false;
+    }
+    out.assign(body + pos, body + pos + n);
+    pos += n;
+    return true;
+}
+
+/* reserves the length prefix of a frame, to be filled in by endFrame */
+static size_t beginFrame(vector<unsigned char> &out) {
+    size_t start = out.size();
+    out.resize(start + PKWD_LENGTH_LEN);
+    return start;
+}
+
+static void endFrame(vector<unsigned char> &out, size_t start) {
+    size_t len = out.size() - start - PKWD_LENGTH_LEN;
+    for (int i = 0; i < 4; ++i) {
+        out[start + i] = (unsigned char) (len >> (8 * i));
+    }
+}
+
+size_t requestFrameLength(const PKWDRequest &request) {
+    return PKWD_LENGTH_LEN + 1 + 4 + TAG_BYTES + 4 + request.header.size() + 4 + request.data.size();
+}
+
+void encodeRequest(const PKWDRequest &request, vector<unsigned char> &out) {
+    size_t start = beginFrame(out);
+    out.push_back((unsigned char) request.op);
+    putU32(out, request.id);
+    TagWords words = GGM_PPRF::toWords(request.tag);
+    for (uint64_t word: words) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back((unsigned char) (word >> (8 * i)));
+        }
+    }
+    putBytes(out, request.header);
+    putBytes(out, request.data);
+    endFrame(out, start);
+}
+
+bool decodeRequest(const unsigned char *body, size_t len, PKWDRequest &out) {
+    if (len < 5 + TAG_BYTES) {
+        return false;
+    }
+    out.op = (PKWDOp) body[0];
+    if (out.op < PKWDOp::Wrap || out.op > PKWDOp::NumPuncs) {
+        return false;
+    }
+    out.id = getU32(body + 1);
+    out.tag.reset();
+    for (size_t i = 0; i < TAG_BYTES; ++i) {
+        out.tag |= Tag(body[5 + i]) << (8 * i);
+    }
+    size_t pos = 5 + TAG_BYTES;
+    return getBytes(body, len, pos, out.header) && getBytes(body, len, pos, out.data) && pos == len;
+}
+
+void encodeResponse(const PKWDResponse &response, vector<unsigned char> &out) {
+    size_t start = beginFrame(out);
+    putU32(out, response.id);
+    out.push_back((unsigned char) response.status);
+    putBytes(out, response.data);
+    endFrame(out, start);
+}
+
+size_t responseFrameLength(const PKWDResponse &response) {
+    return PKWD_LENGTH_LEN + 4 + 1 + 4 + response.data.size();
+}
+
+bool decodeResponse(const unsigned char *body, size_t len, PKWDResponse &out) {
+    if (len < 5) {
+        return false;
+    }
+    out.id = getU32(body);
+    if (body[4] > (unsigned char) PKWError::Wrapping) {
+        return false;
+    }
+    out.status = (PKWError) body[4];
+    size_t pos = 5;
+    return getBytes(body, len, pos, out.data) && pos == len;
+}
+
+bool frameLength(const unsigned char *buf, size_t len, size_t &bodyLen) {
+    if (len < PKWD_LENGTH_LEN) {
+        return false;
+    }
+    bodyLen = getU32(buf);
+    return true;
+}
+
+void wipe(vector<unsigned char> &buf) {
+    secure_memzero(buf.data(), buf.size());
+    buf.clear();
+}
+
+void reserveWiping(vector<unsigned char> &buf, size_t needed) {
+    if (needed <= buf.capacity()) {
+        return;
+    }
+    vector<unsigned char> grown;
+    grown.reserve(std::max(needed, 2 * buf.capacity()));
+    grown.assign(buf.begin(), buf.end());
+    wipe(buf);
+    buf.swap(grown);
+}
+
+void consume(vector<unsigned char> &buf, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    size_t rest = buf.size() - n;
+    std::memmove(buf.data(), buf.data() + n, rest);
+    secure_memzero(buf.data() + rest, n);
+    buf.resize(rest);
+}
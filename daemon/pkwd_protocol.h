@@ -0,0 +1,129 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_PROTOCOL_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_PROTOCOL_H
+
+#include "pkw/pkw_result.h"
+#include "pprf/ggm_pprf.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The pkwd wire protocol. Every message is a frame: the length of the body (32 bit little endian), then the body.
+ *
+ * request body:  op (1) | id (4) | tag (32, little endian) | header length (4) | header | data length (4) | data
+ * response body: id (4) | status (1, a PKWError) | data length (4) | data
+ *
+ * The data of a request is the key for Wrap and the ciphertext for Unwrap; the data of a response is the ciphertext
+ * for Wrap, the key for Unwrap and the number of punctures (64 bit little endian) for NumPuncs. Responses on a
+ * connection come in the order of its requests.
+ */
+
+/* the largest request body accepted, and the largest response body; a ciphertext is longer than its key */
+const size_t PKWD_MAX_FRAME = 1 << 20;
+const size_t PKWD_MAX_RESPONSE = PKWD_MAX_FRAME + 64;
+/* the length of the frame length prefix */
+const size_t PKWD_LENGTH_LEN = 4;
+
+enum class PKWDOp : unsigned char {
+    Wrap = 1,
+    Unwrap = 2,
+    Punc = 3,
+    NumPuncs = 4
+};
+
+struct PKWDRequest {
+    PKWDOp op;
+    uint32_t id;
+    Tag tag;
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+};
+
+struct PKWDResponse {
+    uint32_t id;
+    PKWError status;
+    std::vector<unsigned char> data;
+};
+
+/**
+ * Returns the length of the frame of request, as appended by encodeRequest.
+ */
+size_t requestFrameLength(const PKWDRequest &request);
+
+/**
+ * Appends the frame of request to out.
+ */
+void encodeRequest(const PKWDRequest &request, std::vector<unsigned char> &out);
+
+/**
+ * Decodes a request body.
+ * @return false if the body is malformed
+ */
+bool decodeRequest(const unsigned char *body, size_t len, PKWDRequest &out);
+
+/**
+ * Appends the frame of response to out.
+ */
+void encodeResponse(const PKWDResponse &response, std::vector<unsigned char> &out);
+
+/**
+ * Returns the length of the frame of response, as appended by encodeResponse.
+ */
+size_t responseFrameLength(const PKWDResponse &response);
+
+/**
+ * Decodes a response body.
+ * @return false if the body is malformed
+ */
+bool decodeResponse(const unsigned char *body, size_t len, PKWDResponse &out);
+
+/**
+ * Returns the length of the frame body starting at buf, if the length prefix is complete.
+ * @param buf the buffered bytes
+ * @param len the number of buffered bytes
+ * @param bodyLen receives the length of the body
+ * @return false if fewer than PKWD_LENGTH_LEN bytes are buffered
+ */
+bool frameLength(const unsigned char *buf, size_t len, size_t &bodyLen);
+
+/*
+ * Buffers of frames hold keys in the clear. These helpers keep the bytes beyond a buffer's size zero, so that wiping
+ * its contents erases every copy.
+ */
+
+/**
+ * Zeroizes and empties buf.
+ */
+void wipe(std::vector<unsigned char> &buf);
+
+/**
+ * Makes room for needed bytes in buf without leaving a copy of its contents in a freed allocation.
+ */
+void reserveWiping(std::vector<unsigned char> &buf, size_t needed);
+
+/**
+ * Removes the first n bytes of buf, zeroizing the bytes it vacates.
+ */
+void consume(std::vector<unsigned char> &buf, size_t n);
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_PROTOCOL_H
@@ -0,0 +1,435 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkwd_server.h"
+#include "pkw/exceptions.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "pprf/ggm_pprf_key.h"
+#include "secure_memzero.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::vector;
+
+static const int MAX_EVENTS = 64;
+static const size_t READ_CHUNK = 64 * 1024;
+/* the most unparsed input buffered for a connection: one frame of the largest size accepted */
+static const size_t MAX_INPUT = PKWD_LENGTH_LEN + PKWD_MAX_FRAME;
+
+static void wipe(vector<PKWDResponse> &responses) {
+    for (PKWDResponse &response: responses) {
+        wipe(response.data);
+    }
+    responses.clear();
+}
+
+static void writeAll(int fd, const unsigned char *buf, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t w = ::write(fd, buf + done, n - done);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            throw StreamException();
+        }
+        done += w;
+    }
+}
+
+static std::string directoryOf(const std::string &path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+PKWDServer::PKWDServer(const PKWDConfig &config)
+    : config(config), listenFd(-1), epollFd(-1), stopFd(-1), nextSerial(0), numBatches(0), numCommits(0) {
+    loadOrCreateKey();
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (config.socketPath.empty() || config.socketPath.size() >= sizeof(addr.sun_path)) {
+        throw StreamException();
+    }
+    std::strncpy(addr.sun_path, config.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ::unlink(config.socketPath.c_str());
+    /* only the owner may connect */
+    mode_t mask = ::umask(0077);
+    bool bound = listenFd >= 0 && ::bind(listenFd, (sockaddr *) &addr, sizeof(addr)) == 0;
+    ::umask(mask);
+    epoll_event listenEvent{};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.fd = listenFd;
+    epoll_event stopEvent{};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.fd = stopFd;
+    if (!bound || epollFd < 0 || stopFd < 0 || ::listen(listenFd, SOMAXCONN) != 0 ||
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) != 0 ||
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &stopEvent) != 0) {
+        for (int fd: {listenFd, epollFd, stopFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        throw StreamException();
+    }
+}
+
+PKWDServer::~PKWDServer() {
+    for (auto &entry: connections) {
+        wipe(entry.second.in);
+        wipe(entry.second.out);
+        ::close(entry.first);
+    }
+    for (Pending &pending: batch) {
+        wipe(pending.request.data);
+    }
+    ::close(listenFd);
+    ::close(epollFd);
+    ::close(stopFd);
+    ::unlink(config.socketPath.c_str());
+}
+
+void PKWDServer::loadOrCreateKey() {
+    int fd = ::open(config.keyPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT) {
+        pkw.reset(new PPRF_AEAD_PKW(PPRFKey::generate(config.keyLen, config.tagLen).serialize()));
+        commit();
+        return;
+    }
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw ImportException();
+    }
+    SecureByteBuffer stored(st.st_size);
+    size_t done = 0;
+    while (done < stored.size()) {
+        ssize_t r = ::read(fd, stored.data() + done, stored.size() - done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            break;
+        }
+        done += r;
+    }
+    ::close(fd);
+    if (done != stored.size()) {
+        throw ImportException();
+    }
+    if (config.password.empty()) {
+        pkw.reset(new PPRF_AEAD_PKW(stored));
+    } else {
+        pkw.reset(new PPRF_AEAD_PKW(decryptExport(stored, config.password)));
+    }
+}
+
+void PKWDServer::commit() {
+    SecureByteBuffer key = config.password.empty() ? pkw->serializeKey() : pkw->serializeAndEncryptKey(config.password);
+    const std::string tmp = config.keyPath + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw StreamException();
+    }
+    bool written = true;
+    try {
+        writeAll(fd, key.data(), key.size());
+    } catch (StreamException &e) {
+        written = false;
+    }
+    written = written && ::fsync(fd) == 0;
+    written = ::close(fd) == 0 && written;
+    if (!written || ::rename(tmp.c_str(), config.keyPath.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        throw StreamException();
+    }
+    int dir = ::open(directoryOf(config.keyPath).c_str(), O_RDONLY | O_CLOEXEC);
+    if (dir < 0 || ::fsync(dir) != 0) {
+        if (dir >= 0) {
+            ::close(dir);
+        }
+        throw StreamException();
+    }
+    ::close(dir);
+    ++numCommits;
+}
+
+void PKWDServer::run() {
+    epoll_event events[MAX_EVENTS];
+    while (true) {
+        int n = ::epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw StreamException();
+        }
+        bool stopping = false;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                accept();
+            } else if (fd == stopFd) {
+                uint64_t count;
+                while (::read(stopFd, &count, sizeof(count)) > 0) {
+                }
+                stopping = true;
+            } else {
+                if (events[i].events & EPOLLOUT) {
+                    flush(fd);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    read(fd);
+                }
+            }
+        }
+        evaluate();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void PKWDServer::stop() {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(stopFd, &one, sizeof(one));
+    (void) ignored;
+}
+
+size_t PKWDServer::getNumBatches() const {
+    return numBatches;
+}
+
+size_t PKWDServer::getNumCommits() const {
+    return numCommits;
+}
+
+void PKWDServer::accept() {
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections[fd].serial = ++nextSerial;
+    }
+}
+
+void PKWDServer::read(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection &conn = it->second;
+    bool eof = false;
+    /* a full buffer is parsed first; the rest stays in the socket until the next round */
+    while (conn.in.size() < MAX_INPUT) {
+        size_t size = conn.in.size();
+        size_t chunk = std::min(READ_CHUNK, MAX_INPUT - size);
+        reserveWiping(conn.in, size + chunk);
+        conn.in.resize(size + chunk);
+        ssize_t r = ::read(fd, conn.in.data() + size, chunk);
+        conn.in.resize(size + std::max<ssize_t>(r, 0));
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            eof = r == 0 || errno != EAGAIN;
+            break;
+        }
+    }
+    /* requests received before the peer hung up are still evaluated, e.g. a final puncture */
+    size_t pos = 0;
+    size_t bodyLen;
+    while (frameLength(conn.in.data() + pos, conn.in.size() - pos, bodyLen)) {
+        if (bodyLen > PKWD_MAX_FRAME) {
+            eof = true;
+            break;
+        }
+        if (conn.in.size() - pos - PKWD_LENGTH_LEN < bodyLen) {
+            break;
+        }
+        Pending pending{fd, conn.serial, {}};
+        if (!decodeRequest(conn.in.data() + pos + PKWD_LENGTH_LEN, bodyLen, pending.request)) {
+            eof = true;
+            break;
+        }
+        batch.push_back(std::move(pending));
+        pos += PKWD_LENGTH_LEN + bodyLen;
+    }
+    consume(conn.in, pos);
+    if (eof) {
+        close(fd);
+    }
+}
+
+void PKWDServer::flush(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection &conn = it->second;
+    while (conn.outPos < conn.out.size()) {
+        ssize_t w = ::send(fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w < 0 && errno == EAGAIN) {
+            break;
+        }
+        if (w <= 0) {
+            close(fd);
+            return;
+        }
+        conn.outPos += w;
+    }
+    bool pending = conn.outPos < conn.out.size();
+    if (pending) {
+        consume(conn.out, conn.outPos);
+    } else {
+        wipe(conn.out);
+    }
+    conn.outPos = 0;
+    if (pending != conn.wantWrite) {
+        epoll_event event{};
+        event.events = pending ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = fd;
+        ::epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        conn.wantWrite = pending;
+    }
+}
+
+void PKWDServer::close(int fd) {
+    auto it = connections.find(fd);
+    if (it != connections.end()) {
+        wipe(it->second.in);
+        wipe(it->second.out);
+        connections.erase(it);
+    }
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+}
+
+void PKWDServer::respond(int fd, Connection &conn, const PKWDResponse &response) {
+    size_t len = responseFrameLength(response);
+    if (conn.out.size() + len > config.maxPendingOutput) {
+        /* the peer does not read its responses */
+        close(fd);
+        return;
+    }
+    reserveWiping(conn.out, conn.out.size() + len);
+    encodeResponse(response, conn.out);
+}
+
+void PKWDServer::evaluate() {
+    vector<PKWDResponse> responses;
+    for (size_t start = 0; start < batch.size(); start += config.maxBatch) {
+        const size_t end = std::min(batch.size(), start + config.maxBatch);
+        bool punctured = false;
+        try {
+            for (size_t i = start; i < end; ++i) {
+                responses.push_back(evaluate(batch[i].request, punctured));
+            }
+            if (punctured) {
+                commit();
+            }
+        } catch (...) {
+            wipe(responses);
+            throw;
+        }
+        for (size_t i = start; i < end; ++i) {
+            auto it = connections.find(batch[i].fd);
+            if (it != connections.end() && it->second.serial == batch[i].serial) {
+                respond(batch[i].fd, it->second, responses[i - start]);
+            }
+        }
+        wipe(responses);
+        ++numBatches;
+    }
+    if (batch.empty()) {
+        return;
+    }
+    for (Pending &pending: batch) {
+        wipe(pending.request.data);
+    }
+    batch.clear();
+    vector<int> ready;
+    for (auto &entry: connections) {
+        if (!entry.second.wantWrite && !entry.second.out.empty()) {
+            ready.push_back(entry.first);
+        }
+    }
+    for (int fd: ready) {
+        flush(fd);
+    }
+}
+
+PKWDResponse PKWDServer::evaluate(const PKWDRequest &request, bool &punctured) {
+    PKWDResponse response{request.id, PKWError::None, {}};
+    switch (request.op) {
+        case PKWDOp::Wrap:
+            response.status = pkw->tryWrap(request.tag, request.header, request.data, response.data);
+            break;
+        case PKWDOp::Unwrap:
+            response.status = pkw->tryUnwrap(request.tag, request.header, request.data, response.data);
+            break;
+        case PKWDOp::Punc:
+            try {
+                /* repeated punctures change nothing and need no commit */
+                if (!pkw->isPunctured(request.tag)) {
+                    pkw->punc(request.tag);
+                    punctured = true;
+                }
+            } catch (IllegalTagException &e) {
+                response.status = PKWError::IllegalTag;
+            }
+            break;
+        case PKWDOp::NumPuncs: {
+            uint64_t puncs = pkw->getNumPuncs();
+            for (int i = 0; i < 8; ++i) {
+                response.data.push_back((unsigned char) (puncs >> (8 * i)));
+            }
+            break;
+        }
+    }
+    return response;
+}
@@ -0,0 +1,137 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_SERVER_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_SERVER_H
+
+#include "pkw/pprf_aead_pkw.h"
+#include "pkwd_protocol.h"
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PKWDConfig {
+    /* the path of the Unix domain socket to listen on; an existing socket file is replaced */
+    std::string socketPath;
+    /* the file holding the key; created with a fresh key if it does not exist */
+    std::string keyPath;
+    /* if not empty, the key file is encrypted with a key derived from this password */
+    std::string password;
+    /* tag and key length of a fresh key */
+    int tagLen = 128;
+    int keyLen = 128;
+    /* the most requests evaluated in one batch */
+    size_t maxBatch = 1024;
+    /* the most response bytes held for a connection that does not read them; the connection is closed beyond it */
+    size_t maxPendingOutput = 16 * PKWD_MAX_RESPONSE;
+};
+
+/**
+ * A local key-wrapping daemon. It owns a PPRF_AEAD_PKW key, persisted in a key file, and serves wrap, unwrap and
+ * puncture requests of the pkwd protocol (see pkwd_protocol.h) on a Unix domain socket.
+ * <br>
+ * An epoll loop reads the requests of all connections that are ready and evaluates them as one batch, in arrival
+ * order. The punctures of a batch are committed with a single write of the key file (write, fsync, rename); no
+ * response to a puncture is sent before the commit, so an acknowledged puncture survives a crash.
+ * <br>
+ * A connection buffers at most one request frame of unparsed input and maxPendingOutput bytes of unsent responses.
+ * The buffers hold keys in the clear, so they are zeroized once consumed or written, and when the connection closes.
+ */
+class PKWDServer {
+    public:
+        /**
+         * Loads or creates the key and listens on the socket.
+         * @param config the configuration
+         * @throws ImportException if the key file cannot be read or decrypted
+         * @throws StreamException if the socket or the key file cannot be set up
+         */
+        explicit PKWDServer(const PKWDConfig &config);
+
+        ~PKWDServer();
+
+        PKWDServer(const PKWDServer &) = delete;
+        PKWDServer &operator=(const PKWDServer &) = delete;
+
+        /**
+         * Serves requests until stop() is called.
+         * @throws StreamException if a puncture cannot be committed; the puncture is not acknowledged
+         */
+        void run();
+
+        /**
+         * Makes run() return. Safe to call from other threads and from signal handlers.
+         */
+        void stop();
+
+        /**
+         * Returns the number of batches evaluated so far.
+         * @return the number of batches
+         */
+        size_t getNumBatches() const;
+
+        /**
+         * Returns the number of key file commits so far.
+         * @return the number of commits
+         */
+        size_t getNumCommits() const;
+
+    private:
+        struct Connection {
+            /* distinguishes connections that reuse the descriptor of a closed one */
+            uint64_t serial = 0;
+            std::vector<unsigned char> in;
+            std::vector<unsigned char> out;
+            size_t outPos = 0;
+            bool wantWrite = false;
+        };
+
+        /* a request of a batch and the connection it came from */
+        struct Pending {
+            int fd;
+            uint64_t serial;
+            PKWDRequest request;
+        };
+
+        PKWDConfig config;
+        std::unique_ptr<PPRF_AEAD_PKW> pkw;
+        int listenFd;
+        int epollFd;
+        int stopFd;
+        std::map<int, Connection> connections;
+        std::vector<Pending> batch;
+        uint64_t nextSerial;
+        std::atomic<size_t> numBatches;
+        std::atomic<size_t> numCommits;
+
+        void loadOrCreateKey();
+        void commit();
+        void accept();
+        void read(int fd);
+        void flush(int fd);
+        void close(int fd);
+        void respond(int fd, Connection &conn, const PKWDResponse &response);
+        void evaluate();
+        PKWDResponse evaluate(const PKWDRequest &request, bool &punctured);
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PKWD_SERVER_H
@@ -0,0 +1,72 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_MEMORY_USAGE_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Memory held by a key, split by purpose. Heap blocks are accounted for as a glibc-like allocator lays them out
+ * (see heapChunkSize), so the total is close to what the process actually spends on the key.
+ */
+struct MemoryUsage {
+        /* key material: node values or per-tag keys */
+        size_t secretBytes = 0;
+        /* what locates the secrets: node prefixes or tag indices */
+        size_t indexBytes = 0;
+        /* object, container and per-node headers, including padding */
+        size_t containerBytes = 0;
+        /* reserved but unused container capacity and allocator overhead */
+        size_t slackBytes = 0;
+        /* number of nodes per depth (prefix length), indexed from 0 to the tag length; empty if the key is not a tree */
+        std::vector<size_t> depthHistogram;
+
+        size_t total() const { return secretBytes + indexBytes + containerBytes + slackBytes; }
+};
+
+enum class PunctureOrder {
+    /* uniformly random tags */
+    Random,
+    /* the smallest tags that are not punctured yet, in ascending order */
+    Sequential
+};
+
+/**
+ * Estimated state of a key after further punctures.
+ */
+struct MemoryProjection {
+        size_t numNodes = 0;
+        MemoryUsage usage;
+        size_t serializedBytes = 0;
+};
+
+/**
+ * Size of the heap chunk a malloc(n) occupies with a glibc-like allocator: an 8-byte header, 16-byte granularity and a
+ * 32-byte minimum.
+ */
+inline size_t heapChunkSize(size_t n) {
+    size_t chunk = (n + sizeof(size_t) + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_MEMORY_USAGE_H
@@ -0,0 +1,151 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "metrics.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+static const char *const COUNTER_NAMES[METRIC_COUNTERS] = {
+        "pkw_evals_total",
+        "pkw_punctures_total",
+        "pkw_prg_invocations_total",
+        "pkw_exports_total",
+        "pkw_imports_total",
+        "pkw_failed_imports_total",
+        "pkw_failed_wraps_total",
+        "pkw_failed_unwraps_total{reason=\"illegal_tag\"}",
+        "pkw_failed_unwraps_total{reason=\"authentication\"}",
+};
+
+static const char *const OP_NAMES[METRIC_OPS] = {"eval", "punc", "wrap", "unwrap", "serialize", "deserialize", "export", "import"};
+
+PKWMetrics &PKWMetrics::instance() {
+    static PKWMetrics metrics;
+    return metrics;
+}
+
+void PKWMetrics::observe(MetricOp op, uint64_t ns) {
+    if (!enabled()) {
+        return;
+    }
+    size_t bucket = 0;
+    while (bucket < METRIC_BUCKET_BOUNDS_NS.size() && ns > METRIC_BUCKET_BOUNDS_NS[bucket]) {
+        bucket++;
+    }
+    auto index = static_cast<size_t>(op);
+    buckets[index][bucket].fetch_add(1, std::memory_order_relaxed);
+    sumNs[index].fetch_add(ns, std::memory_order_relaxed);
+}
+
+PKWStats PKWMetrics::stats() const {
+    PKWStats stats{};
+    for (size_t c = 0; c < METRIC_COUNTERS; ++c) {
+        stats.counters[c] = counters[c].load(std::memory_order_relaxed);
+    }
+    for (size_t op = 0; op < METRIC_OPS; ++op) {
+        HistogramSnapshot &histogram = stats.latencies[op];
+        for (size_t b = 0; b < METRIC_BUCKETS; ++b) {
+            histogram.buckets[b] = buckets[op][b].load(std::memory_order_relaxed);
+            histogram.count += histogram.buckets[b];
+        }
+        histogram.sumNs = sumNs[op].load(std::memory_order_relaxed);
+    }
+    stats.nodes = nodeGauge.load(std::memory_order_relaxed);
+    stats.keyBytes = keyByteGauge.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void PKWMetrics::reset() {
+    for (auto &counter: counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (size_t op = 0; op < METRIC_OPS; ++op) {
+        for (auto &bucket: buckets[op]) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sumNs[op].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Appends formatted output to a fixed buffer, counting the length of the full output also beyond its capacity.
+ */
+class BufferWriter {
+    public:
+        BufferWriter(char *buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+            if (capacity > 0) {
+                buffer[0] = '\0';
+            }
+        }
+
+        void print(const char *format, ...) {
+            va_list args;
+            va_start(args, format);
+            size_t remaining = length < capacity ? capacity - length : 0;
+            int written = vsnprintf(remaining > 0 ? buffer + length : nullptr, remaining, format, args);
+            va_end(args);
+            if (written > 0) {
+                length += written;
+            }
+        }
+
+        size_t size() const { return length; }
+
+    private:
+        char *buffer;
+        size_t capacity;
+        size_t length = 0;
+};
+
+size_t renderPrometheus(const PKWStats &stats, char *buffer, size_t capacity) {
+    BufferWriter out(buffer, capacity);
+    const char *previousFamily = nullptr;
+    size_t previousLength = 0;
+    for (size_t c = 0; c < METRIC_COUNTERS; ++c) {
+        const char *name = COUNTER_NAMES[c];
+        size_t familyLength = strcspn(name, "{");
+        /* labelled counters of one family share the TYPE line */
+        if (previousFamily == nullptr || familyLength != previousLength || strncmp(previousFamily, name, familyLength) != 0) {
+            out.print("# TYPE %.*s counter\n", (int) familyLength, name);
+            previousFamily = name;
+            previousLength = familyLength;
+        }
+        out.print("%s %llu\n", name, (unsigned long long) stats.counters[c]);
+    }
+
+    out.print("# TYPE pkw_operation_duration_seconds histogram\n");
+    for (size_t op = 0; op < METRIC_OPS; ++op) {
+        const HistogramSnapshot &histogram = stats.latencies[op];
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < METRIC_BUCKET_BOUNDS_NS.size(); ++b) {
+            cumulative += histogram.buckets[b];
+            out.print("pkw_operation_duration_seconds_bucket{op=\"%s\",le=\"%g\"} %llu\n", OP_NAMES[op],
+                      METRIC_BUCKET_BOUNDS_NS[b] / 1e9, (unsigned long long) cumulative);
+        }
+        out.print("pkw_operation_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", OP_NAMES[op], (unsigned long long) histogram.count);
+        out.print("pkw_operation_duration_seconds_sum{op=\"%s\"} %.9f\n", OP_NAMES[op], histogram.sumNs / 1e9);
+        out.print("pkw_operation_duration_seconds_count{op=\"%s\"} %llu\n", OP_NAMES[op], (unsigned long long) histogram.count);
+    }
+
+    out.print("# TYPE pkw_key_nodes gauge\npkw_key_nodes %lld\n", (long long) stats.nodes);
+    out.print("# TYPE pkw_key_bytes gauge\npkw_key_bytes %lld\n", (long long) stats.keyBytes);
+    return out.size();
+}
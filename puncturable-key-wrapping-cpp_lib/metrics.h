@@ -0,0 +1,191 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_METRICS_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Process-wide runtime metrics of the PPRF and PKW implementations.
+ *
+ * Metrics are compiled in unless PKW_NO_METRICS is defined (CMake option PKW_METRICS=OFF), in which case all recording
+ * functions are empty. When compiled in, counters and latency histograms are only recorded after
+ * PKWMetrics::instance().setEnabled(true); while disabled the cost is a single relaxed load per operation.
+ * The node and key byte gauges are maintained whenever metrics are compiled in, so they are correct when enabled later.
+ */
+
+enum class MetricCounter {
+    Evals,
+    Punctures,
+    PRGInvocations,
+    Exports,
+    Imports,
+    FailedImports,
+    FailedWraps,
+    /* unwrap on a punctured tag or a tag exceeding the tag length */
+    FailedUnwrapsIllegalTag,
+    /* unwrap of a ciphertext which does not authenticate under the tag and header */
+    FailedUnwrapsAuthentication,
+    COUNT
+};
+
+enum class MetricOp {
+    Eval,
+    Punc,
+    Wrap,
+    Unwrap,
+    Serialize,
+    Deserialize,
+    Export,
+    Import,
+    COUNT
+};
+
+static const size_t METRIC_COUNTERS = static_cast<size_t>(MetricCounter::COUNT);
+static const size_t METRIC_OPS = static_cast<size_t>(MetricOp::COUNT);
+/**
+ * Upper bounds of the latency histogram buckets in nanoseconds; a last, unbounded bucket follows.
+ */
+static const std::array<uint64_t, 16> METRIC_BUCKET_BOUNDS_NS = {
+        1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000,
+        1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000};
+static const size_t METRIC_BUCKETS = METRIC_BUCKET_BOUNDS_NS.size() + 1;
+
+/**
+ * A snapshot of a latency histogram. Bucket counts are not cumulative.
+ */
+struct HistogramSnapshot {
+        std::array<uint64_t, METRIC_BUCKETS> buckets;
+        uint64_t count;
+        uint64_t sumNs;
+};
+
+/**
+ * A snapshot of all metrics, see PKWMetrics::stats().
+ */
+struct PKWStats {
+        std::array<uint64_t, METRIC_COUNTERS> counters;
+        std::array<HistogramSnapshot, METRIC_OPS> latencies;
+        /* number of nodes held by all live GGM_PPRF instances */
+        int64_t nodes;
+        /* number of secret value bytes held by all live GGM_PPRF instances */
+        int64_t keyBytes;
+
+        uint64_t counter(MetricCounter c) const { return counters[static_cast<size_t>(c)]; }
+        const HistogramSnapshot &latency(MetricOp op) const { return latencies[static_cast<size_t>(op)]; }
+};
+
+class PKWMetrics {
+    public:
+        /**
+         * The process-wide metrics.
+         */
+        static PKWMetrics &instance();
+
+        void setEnabled(bool enable) { enabledFlag.store(enable, std::memory_order_relaxed); }
+        bool enabled() const {
+#ifdef PKW_NO_METRICS
+            return false;
+#else
+            return enabledFlag.load(std::memory_order_relaxed);
+#endif
+        }
+
+        void count(MetricCounter c, uint64_t n = 1) {
+            if (enabled()) {
+                counters[static_cast<size_t>(c)].fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+
+        void observe(MetricOp op, uint64_t ns);
+
+        /**
+         * Adjusts the node and key byte gauges by the given deltas.
+         */
+        void addNodes(int64_t nodes, int64_t keyBytes) {
+#ifndef PKW_NO_METRICS
+            nodeGauge.fetch_add(nodes, std::memory_order_relaxed);
+            keyByteGauge.fetch_add(keyBytes, std::memory_order_relaxed);
+#endif
+        }
+
+        /**
+         * Takes a snapshot of all counters, histograms and gauges. Values are read individually, so a snapshot taken
+         * while operations are running is not necessarily consistent across metrics.
+         * @return the snapshot
+         */
+        PKWStats stats() const;
+
+        /**
+         * Resets counters and histograms to zero. Gauges are kept.
+         */
+        void reset();
+
+    private:
+        PKWMetrics() = default;
+        std::atomic<bool> enabledFlag{false};
+        std::array<std::atomic<uint64_t>, METRIC_COUNTERS> counters{};
+        std::array<std::array<std::atomic<uint64_t>, METRIC_BUCKETS>, METRIC_OPS> buckets{};
+        std::array<std::atomic<uint64_t>, METRIC_OPS> sumNs{};
+        std::atomic<int64_t> nodeGauge{0};
+        std::atomic<int64_t> keyByteGauge{0};
+};
+
+/**
+ * Records the lifetime of the object in the latency histogram of op, if metrics are enabled.
+ */
+class MetricsTimer {
+    public:
+        explicit MetricsTimer(MetricOp op) : op(op), active(PKWMetrics::instance().enabled()) {
+            if (active) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+        ~MetricsTimer() {
+            if (active) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                PKWMetrics::instance().observe(op, static_cast<uint64_t>(ns));
+            }
+        }
+        MetricsTimer(const MetricsTimer &) = delete;
+        MetricsTimer &operator=(const MetricsTimer &) = delete;
+
+    private:
+        MetricOp op;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Renders a snapshot in the Prometheus text exposition format into a caller-supplied buffer.
+ * Like snprintf, the output is truncated to capacity - 1 characters and null-terminated if capacity > 0.
+ * @param stats the snapshot
+ * @param buffer the buffer
+ * @param capacity the size of the buffer in bytes
+ * @return the length of the complete output, excluding the terminating null; the output is complete iff this is less than capacity
+ */
+size_t renderPrometheus(const PKWStats &stats, char *buffer, size_t capacity);
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_METRICS_H
@@ -0,0 +1,372 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "bloom_pkw.h"
+#include "exceptions.h"
+#include "metrics.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "pkw_result.h"
+#include "secure_array.h"
+#include "secure_memzero.h"
+#include "tracing.h"
+#include <cmath>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/hkdf.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/sha.h>
+#include <stdexcept>
+
+using std::vector;
+
+static const unsigned char MAGIC[8] = {'P', 'K', 'W', 'B', 'L', 'O', 'O', 'M'};
+/* header fields after the magic, in this order */
+static const int FIELD_SLOTS = 1;
+static const int FIELD_HASHES = 2;
+static const int FIELD_PUNCS = 3;
+
+/* data keys are AES-128 keys, masked with one slot-derived pad per slot of the tag */
+static const size_t DATA_KEY_LEN = BloomPKW::SLOT_LEN;
+static const size_t MAC_SIZE = 16;
+/* every data key is fresh, so the IV can be fixed */
+static const std::array<unsigned char, 12> IV{};
+static const size_t TAG_BYTES = MAX_TAG_LEN / 8;
+
+static const unsigned char SLOTS_INFO[] = {'s', 'l', 'o', 't', 's'};
+static const unsigned char MASK_INFO[] = {'m', 'a', 's', 'k'};
+
+static uint64_t getU64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+static void putU64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+static std::array<unsigned char, TAG_BYTES> tagBytes(const Tag &tag) {
+    TagWords words = GGM_PPRF::toWords(tag);
+    std::array<unsigned char, TAG_BYTES> bytes{};
+    for (size_t w = 0; w < words.size(); ++w) {
+        putU64(bytes.data() + 8 * w, words[w]);
+    }
+    return bytes;
+}
+
+/* the pad masking the data key in a slot: HKDF of the slot key, bound to the tag */
+static void slotMask(const unsigned char *slotKey, const unsigned char *tagBytes, unsigned char *mask) {
+    unsigned char info[sizeof(MASK_INFO) + TAG_BYTES];
+    std::copy(MASK_INFO, MASK_INFO + sizeof(MASK_INFO), info);
+    std::copy(tagBytes, tagBytes + TAG_BYTES, info + sizeof(MASK_INFO));
+    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
+    hkdf.DeriveKey(mask, DATA_KEY_LEN, slotKey, BloomPKW::SLOT_LEN, nullptr, 0, info, sizeof(info));
+}
+
+/* the header and tag are both authenticated */
+static vector<unsigned char> wrapAAD(const vector<unsigned char> &header, const unsigned char *tagBytes) {
+    vector<unsigned char> aad(header);
+    aad.insert(aad.end(), tagBytes, tagBytes + TAG_BYTES);
+    return aad;
+}
+
+BloomParameters BloomPKW::parametersFor(size_t expectedPuncs, double falsePunctureRate) {
+    if (expectedPuncs == 0 || !(falsePunctureRate > 0 && falsePunctureRate < 1)) {
+        throw std::invalid_argument("expected punctures and a false puncture rate in (0, 1) required");
+    }
+    const double ln2 = std::log(2.0);
+    const double n = static_cast<double>(expectedPuncs);
+    BloomParameters parameters{};
+    parameters.numSlots = static_cast<size_t>(std::ceil(-n * std::log(falsePunctureRate) / (ln2 * ln2)));
+    long k = std::lround(static_cast<double>(parameters.numSlots) / n * ln2);
+    parameters.numHashes = static_cast<int>(std::max(1L, std::min<long>(k, MAX_HASHES)));
+    return parameters;
+}
+
+double BloomPKW::expectedFalsePunctureRate(BloomParameters parameters, size_t puncs) {
+    const double k = parameters.numHashes;
+    return std::pow(1 - std::exp(-k * static_cast<double>(puncs) / static_cast<double>(parameters.numSlots)), k);
+}
+
+size_t BloomPKW::bitmapBytes(size_t numSlots) {
+    return ((numSlots + 7) / 8 + 15) / 16 * 16;
+}
+
+size_t BloomPKW::sizeFor(size_t numSlots) {
+    return HEADER_LEN + bitmapBytes(numSlots) + numSlots * SLOT_LEN;
+}
+
+BloomPKW::BloomPKW(size_t numSlots, int numHashes) {
+    if (numSlots == 0 || numHashes < 1 || numHashes > MAX_HASHES) {
+        throw std::invalid_argument("at least one slot and between 1 and MAX_HASHES hashes required");
+    }
+    SecureByteBuffer t(sizeFor(numSlots));
+    table.swap(t);
+    std::copy(MAGIC, MAGIC + sizeof(MAGIC), table.data());
+    setHeaderField(FIELD_SLOTS, numSlots);
+    setHeaderField(FIELD_HASHES, static_cast<uint64_t>(numHashes));
+    setHeaderField(FIELD_PUNCS, 0);
+    CryptoPP::OS_GenerateRandomBlock(true, table.data() + 4 * 8, HASH_KEY_LEN);
+    CryptoPP::OS_GenerateRandomBlock(true, slot(0), numSlots * SLOT_LEN);
+}
+
+BloomPKW::BloomPKW(SecureByteBuffer serializedKey) {
+    const unsigned char *p = serializedKey.data();
+    if (serializedKey.size() < HEADER_LEN || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), p)) {
+        throw DeserializationError();
+    }
+    uint64_t m = getU64(p + 8 * FIELD_SLOTS);
+    uint64_t k = getU64(p + 8 * FIELD_HASHES);
+    if (m == 0 || m > (serializedKey.size() - HEADER_LEN) / SLOT_LEN || k < 1 || k > MAX_HASHES ||
+        serializedKey.size() != sizeFor(m)) {
+        throw DeserializationError();
+    }
+    table.swap(serializedKey);
+}
+
+uint64_t BloomPKW::headerField(int index) const {
+    return getU64(table.data() + 8 * index);
+}
+
+void BloomPKW::setHeaderField(int index, uint64_t value) {
+    putU64(table.data() + 8 * index, value);
+}
+
+const unsigned char *BloomPKW::hashKey() const {
+    return table.data() + 4 * 8;
+}
+
+unsigned char *BloomPKW::slot(size_t s) {
+    return table.data() + HEADER_LEN + bitmapBytes(numSlots()) + s * SLOT_LEN;
+}
+
+bool BloomPKW::isErased(size_t s) const {
+    return (table.data()[HEADER_LEN + s / 8] >> (s % 8)) & 1;
+}
+
+size_t BloomPKW::numSlots() const {
+    return headerField(FIELD_SLOTS);
+}
+
+int BloomPKW::numHashes() const {
+    return static_cast<int>(headerField(FIELD_HASHES));
+}
+
+long BloomPKW::getNumPuncs() {
+    return static_cast<long>(headerField(FIELD_PUNCS));
+}
+
+size_t BloomPKW::numErased() const {
+    size_t erased = 0;
+    for (size_t s = 0; s < numSlots(); ++s) {
+        erased += isErased(s);
+    }
+    return erased;
+}
+
+/**
+ * Double hashing: slot i of a tag is h1 + i * h2 mod m, with h1 and h2 from an HKDF of the tag under the hash key, so
+ * the slots of a tag are not predictable without the key.
+ */
+void BloomPKW::slotsOf(const unsigned char *tagBytes, Slots &slots) const {
+    unsigned char h[16];
+    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
+    hkdf.DeriveKey(h, sizeof(h), tagBytes, TAG_BYTES, hashKey(), HASH_KEY_LEN, SLOTS_INFO, sizeof(SLOTS_INFO));
+    const uint64_t m = numSlots();
+    const uint64_t h1 = getU64(h) % m;
+    const uint64_t h2 = (getU64(h + 8) | 1) % m;
+    for (int i = 0; i < numHashes(); ++i) {
+        slots[i] = static_cast<size_t>((h1 + static_cast<uint64_t>(i) * h2) % m);
+    }
+}
+
+bool BloomPKW::isPunctured(const Tag &tag) const {
+    Slots slots;
+    slotsOf(tagBytes(tag).data(), slots);
+    for (int i = 0; i < numHashes(); ++i) {
+        if (!isErased(slots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double BloomPKW::falsePunctureRate() const {
+    return std::pow(static_cast<double>(numErased()) / static_cast<double>(numSlots()), numHashes());
+}
+
+/**
+ * Computes masked data keys || ciphertext || MAC. The k masked data keys come in the order of the tag's slots; for
+ * erased slots, whose keys are gone, they are random.
+ */
+vector<unsigned char> BloomPKW::wrap(Tag tag, vector<unsigned char> &header, vector<unsigned char> &key) {
+    MetricsTimer timer(MetricOp::Wrap);
+    PKW_TRACE_SPAN(TraceOp::Wrap, MAX_TAG_LEN, numSlots());
+    const std::array<unsigned char, TAG_BYTES> bytes = tagBytes(tag);
+    Slots slots;
+    slotsOf(bytes.data(), slots);
+    const size_t k = numHashes();
+    vector<unsigned char> out(k * DATA_KEY_LEN + key.size() + MAC_SIZE);
+    SecureArray<DATA_KEY_LEN> dataKey;
+    SecureArray<DATA_KEY_LEN> mask;
+    CryptoPP::OS_GenerateRandomBlock(false, dataKey.data(), dataKey.size());
+    bool live = false;
+    for (size_t i = 0; i < k; ++i) {
+        unsigned char *entry = out.data() + i * DATA_KEY_LEN;
+        if (isErased(slots[i])) {
+            CryptoPP::OS_GenerateRandomBlock(false, entry, DATA_KEY_LEN);
+            continue;
+        }
+        live = true;
+        slotMask(slot(slots[i]), bytes.data(), mask.data());
+        for (size_t j = 0; j < DATA_KEY_LEN; ++j) {
+            entry[j] = mask.data()[j] ^ dataKey.data()[j];
+        }
+    }
+    if (!live) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throwPKWError(PKWError::Punctured);
+    }
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        vector<unsigned char> aad = wrapAAD(header, bytes.data());
+        unsigned char *c = out.data() + k * DATA_KEY_LEN;
+        CryptoPP::GCM<CryptoPP::AES>::Encryption e;
+        e.SetKeyWithIV(dataKey.data(), dataKey.size(), IV.data(), IV.size());
+        e.EncryptAndAuthenticate(c, c + key.size(), MAC_SIZE, IV.data(), (int) IV.size(), aad.data(), aad.size(),
+                                 key.data(), key.size());
+    } catch (CryptoPP::Exception &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throwPKWError(PKWError::Wrapping);
+    }
+    return out;
+}
+
+/**
+ * Recovers the data key from the first slot of the tag which is not erased.
+ */
+vector<unsigned char> BloomPKW::unwrap(Tag tag, vector<unsigned char> &header, vector<unsigned char> &c) {
+    MetricsTimer timer(MetricOp::Unwrap);
+    PKW_TRACE_SPAN(TraceOp::Unwrap, MAX_TAG_LEN, numSlots());
+    const size_t k = numHashes();
+    if (c.size() < k * DATA_KEY_LEN + MAC_SIZE) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throwPKWError(PKWError::Authentication);
+    }
+    const std::array<unsigned char, TAG_BYTES> bytes = tagBytes(tag);
+    Slots slots;
+    slotsOf(bytes.data(), slots);
+    size_t i = 0;
+    while (i < k && isErased(slots[i])) {
+        ++i;
+    }
+    if (i == k) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsIllegalTag);
+        throwPKWError(PKWError::Punctured);
+    }
+    SecureArray<DATA_KEY_LEN> dataKey;
+    slotMask(slot(slots[i]), bytes.data(), dataKey.data());
+    const unsigned char *entry = c.data() + i * DATA_KEY_LEN;
+    for (size_t j = 0; j < DATA_KEY_LEN; ++j) {
+        dataKey.data()[j] ^= entry[j];
+    }
+    const unsigned char *body = c.data() + k * DATA_KEY_LEN;
+    const size_t n = c.size() - k * DATA_KEY_LEN - MAC_SIZE;
+    vector<unsigned char> key(n);
+    bool verified = false;
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        vector<unsigned char> aad = wrapAAD(header, bytes.data());
+        CryptoPP::GCM<CryptoPP::AES>::Decryption d;
+        d.SetKeyWithIV(dataKey.data(), dataKey.size(), IV.data(), IV.size());
+        verified = d.DecryptAndVerify(key.data(), body + n, MAC_SIZE, IV.data(), (int) IV.size(), aad.data(),
+                                      aad.size(), body, n);
+    } catch (CryptoPP::Exception &e) {
+        verified = false;
+    }
+    if (!verified) {
+        secure_memzero(key.data(), key.size());
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throwPKWError(PKWError::Authentication);
+    }
+    return key;
+}
+
+void BloomPKW::punc(Tag tag) {
+    MetricsTimer timer(MetricOp::Punc);
+    PKW_TRACE_SPAN(TraceOp::Zeroize, MAX_TAG_LEN, numSlots());
+    Slots slots;
+    slotsOf(tagBytes(tag).data(), slots);
+    bool erased = false;
+    for (int i = 0; i < numHashes(); ++i) {
+        const size_t s = slots[i];
+        if (!isErased(s)) {
+            secure_memzero(slot(s), SLOT_LEN);
+            table.data()[HEADER_LEN + s / 8] |= static_cast<unsigned char>(1 << (s % 8));
+            erased = true;
+        }
+    }
+    if (erased) {
+        setHeaderField(FIELD_PUNCS, headerField(FIELD_PUNCS) + 1);
+        PKWMetrics::instance().count(MetricCounter::Punctures);
+    }
+}
+
+void BloomPKW::secureTeardown() {
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, numSlots());
+    const size_t m = numSlots();
+    secure_memzero(slot(0), m * SLOT_LEN);
+    for (size_t s = 0; s < m; ++s) {
+        table.data()[HEADER_LEN + s / 8] |= static_cast<unsigned char>(1 << (s % 8));
+    }
+}
+
+SecureByteBuffer BloomPKW::serializeKey() {
+    return table;
+}
+
+SecureByteBuffer BloomPKW::serializeAndEncryptKey(const std::string &password) {
+    SecureByteBuffer serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
+
+MemoryUsage BloomPKW::memoryUsage() const {
+    const size_t m = numSlots();
+    const size_t live = m - numErased();
+    MemoryUsage usage;
+    usage.secretBytes = live * SLOT_LEN + HASH_KEY_LEN;
+    usage.indexBytes = HEADER_LEN - HASH_KEY_LEN + bitmapBytes(m);
+    usage.containerBytes = sizeof(*this);
+    /* erased slots stay allocated */
+    usage.slackBytes = (m - live) * SLOT_LEN + heapChunkSize(table.size()) - table.size();
+    return usage;
+}
+
+BloomPKW::~BloomPKW() {
+    BloomPKW::secureTeardown();
+}
+
+std::shared_ptr<AbstractPKW<Tag, vector<unsigned char>>> BloomPKWFactory::fromSerialized(SecureByteBuffer &serialized) {
+    return std::shared_ptr<AbstractPKW<Tag, vector<unsigned char>>>(new BloomPKW(serialized));// cannot use std::make_shared; constructor protected
+}
@@ -0,0 +1,177 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_BLOOM_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_BLOOM_PKW_H
+
+#include "memory_usage.h"
+#include "pkw.h"
+#include "pprf/ggm_pprf.h"
+#include "secure_byte_buffer.h"
+#include "static_pkw.h"
+#include <array>
+#include <vector>
+
+/**
+ * Parameters of a BloomPKW: the number of secret slots and of slots per tag.
+ */
+struct BloomParameters {
+        size_t numSlots;
+        int numHashes;
+};
+
+/**
+ * Puncturable key wrapping over a Bloom filter of secret keys. The key is a fixed array of m random slot keys, and
+ * each tag is mapped to k of them by a keyed hash. A wrap encrypts under a random data key, which is stored masked by
+ * each of the tag's k slot keys; a puncture erases the tag's k slots. So the key size is fixed and a puncture costs
+ * O(k), whatever the number of punctures.
+ * <br>
+ * In return, a tag whose slots have all been erased by punctures on other tags is punctured as well (a false
+ * puncture), with a probability that grows with the number of punctures; see parametersFor and falsePunctureRate.
+ * <br>
+ * The key is held and serialized in one fixed layout:
+ * <ul>
+ * <li>header: magic "PKWBLOOM", number of slots, number of hashes and number of punctures, each a little-endian
+ * uint64, followed by the HASH_KEY_LEN byte hash key</li>
+ * <li>bitmap: bit s % 8 of byte s / 8 is set if slot s is erased, padded to a multiple of 16 bytes</li>
+ * <li>slots: SLOT_LEN bytes per slot; erased slots are zero</li>
+ * </ul>
+ */
+class BloomPKW final : public StaticPKW<BloomPKW, Tag, std::vector<unsigned char>> {
+    public:
+        static const size_t HEADER_LEN = 48;
+        static const size_t SLOT_LEN = 16;
+        static const size_t HASH_KEY_LEN = 16;
+        static const int MAX_HASHES = 32;
+
+        /**
+         * Constructs a fresh instance with random slot keys.
+         * @param numSlots the number of slots m
+         * @param numHashes the number of slots per tag k
+         * @throws std::invalid_argument if numSlots is 0 or numHashes is not between 1 and MAX_HASHES
+         */
+        BloomPKW(size_t numSlots, int numHashes);
+
+        explicit BloomPKW(BloomParameters parameters) : BloomPKW(parameters.numSlots, parameters.numHashes) {}
+
+        /**
+         * Returns the smallest number of slots, and the matching number of hashes, for which the false puncture rate
+         * after expectedPuncs punctures is at most falsePunctureRate: m = -n ln(p) / ln(2)^2 and k = m / n ln(2).
+         * @param expectedPuncs the number of punctures n the key has to support
+         * @param falsePunctureRate the false puncture rate p after n punctures, between 0 and 1 exclusive
+         * @return the parameters
+         * @throws std::invalid_argument if expectedPuncs is 0 or falsePunctureRate is out of range
+         */
+        static BloomParameters parametersFor(size_t expectedPuncs, double falsePunctureRate);
+
+        /**
+         * Returns the expected false puncture rate (1 - e^(-kn/m))^k of a key after n punctures.
+         */
+        static double expectedFalsePunctureRate(BloomParameters parameters, size_t puncs);
+
+        std::vector<unsigned char> wrap(Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+
+        std::vector<unsigned char> unwrap(Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &c) override;
+
+        /**
+         * Erases the slots of tag; unwrapping any ciphertext under a tag which shares all its slots with punctured
+         * tags fails from then on.
+         * @param tag the tag
+         */
+        void punc(Tag tag) override;
+
+        /**
+         * Returns the number of punctures which erased at least one slot.
+         */
+        long getNumPuncs() override;
+
+        void secureTeardown() override;
+
+        /**
+         * Returns the table, whose size depends on the parameters only.
+         * @return the serialized key
+         */
+        SecureByteBuffer serializeKey() override;
+
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+        /**
+         * Returns whether all slots of tag are erased, which holds for punctured and falsely punctured tags.
+         */
+        bool isPunctured(const Tag &tag) const;
+
+        /**
+         * Returns the probability (erased / m)^k that a tag which was not punctured is falsely punctured.
+         */
+        double falsePunctureRate() const;
+
+        size_t numSlots() const;
+
+        int numHashes() const;
+
+        /**
+         * Returns the number of erased slots.
+         */
+        size_t numErased() const;
+
+        /**
+         * Returns the memory held by the key; the depth histogram is empty.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+        ~BloomPKW();
+
+    protected:
+        explicit BloomPKW(SecureByteBuffer serializedKey);
+
+    private:
+        friend class BloomPKWFactory;
+        SecureByteBuffer table;
+
+        using Slots = std::array<size_t, MAX_HASHES>;
+
+        static size_t sizeFor(size_t numSlots);
+
+        static size_t bitmapBytes(size_t numSlots);
+
+        uint64_t headerField(int index) const;
+
+        void setHeaderField(int index, uint64_t value);
+
+        const unsigned char *hashKey() const;
+
+        unsigned char *slot(size_t s);
+
+        bool isErased(size_t s) const;
+
+        void slotsOf(const unsigned char *tagBytes, Slots &slots) const;
+};
+
+class BloomPKWFactory : public AbstractPKWFactory<Tag, std::vector<unsigned char>> {
+    public:
+        /**
+         * Reconstructs a BloomPKW from its table.
+         * @throws DeserializationError if serialized is not a table of consistent size
+         */
+        std::shared_ptr<AbstractPKW<Tag, std::vector<unsigned char>>> fromSerialized(SecureByteBuffer &serialized) override;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_BLOOM_PKW_H
@@ -0,0 +1,242 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "epoch_pkw.h"
+#include "exceptions.h"
+#include "pprf/ggm_pprf_key.h"
+#include "pprf/pprf_key_serializer.h"
+#include <algorithm>
+
+using std::vector;
+
+static const size_t HEADER_FIELDS = 5;
+
+static void putU64(SecureByteBuffer &b, size_t offset, uint64_t v) {
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        b.data()[offset + i] = static_cast<unsigned char>((v >> (8 * i)) & 0xFF);
+    }
+}
+
+static uint64_t getU64(const SecureByteBuffer &b, size_t offset) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        v |= static_cast<uint64_t>(b.data()[offset + i]) << (8 * i);
+    }
+    return v;
+}
+
+EpochPKW::EpochPKW(int epochBits, int counterBits, uint64_t retention, int keyLen)
+    : epochBits(epochBits), counterBits(counterBits), retention(retention) {
+    checkParameters();
+    pkw.reset(new PPRF_AEAD_PKW(PPRFKey::generate(keyLen, epochBits + counterBits).serialize()));
+}
+
+/*
+ * Layout: epoch bits, counter bits, retention, current epoch and oldest live epoch as little-endian 64-bit words,
+ * followed by the serialized PPRF key.
+ */
+EpochPKW::EpochPKW(SecureByteBuffer serializedKey) : epochBits(0), counterBits(0), retention(0) {
+    const size_t headerLen = HEADER_FIELDS * sizeof(uint64_t);
+    if (serializedKey.size() < headerLen) {
+        throw DeserializationError();
+    }
+    uint64_t bits[2] = {getU64(serializedKey, 0), getU64(serializedKey, 8)};
+    if (bits[0] > 63 || bits[1] > 64) {
+        throw DeserializationError();
+    }
+    epochBits = static_cast<int>(bits[0]);
+    counterBits = static_cast<int>(bits[1]);
+    retention = getU64(serializedKey, 16);
+    current = getU64(serializedKey, 24);
+    firstLive = getU64(serializedKey, 32);
+    try {
+        checkParameters();
+    } catch (IllegalTagException &e) {
+        throw DeserializationError();
+    }
+    if (current >> epochBits != 0 || firstLive > current + 1) {
+        throw DeserializationError();
+    }
+    vector<unsigned char> rest(serializedKey.begin() + headerLen, serializedKey.end());
+    SecureByteBuffer key(rest);
+    if (PPRFKeySerializer::deserialize(key).tagLen != epochBits + counterBits) {
+        throw DeserializationError();
+    }
+    pkw.reset(new PPRF_AEAD_PKW(key));
+}
+
+EpochPKW::~EpochPKW() {
+    stopScheduler();
+}
+
+void EpochPKW::checkParameters() const {
+    if (epochBits < 1 || epochBits > 63 || counterBits < 0 || counterBits > 64 || epochBits + counterBits > (int) MAX_TAG_LEN || retention < 1) {
+        throw IllegalTagException();
+    }
+}
+
+Tag EpochPKW::toTag(const EpochTag &tag) const {
+    if (tag.epoch < firstLive || tag.epoch > current || (counterBits < 64 && tag.counter >> counterBits != 0)) {
+        throw IllegalTagException();
+    }
+    return (Tag(tag.epoch) << counterBits) | Tag(tag.counter);
+}
+
+ciphertext EpochPKW::wrap(EpochTag tag, vector<unsigned char> &header, vector<unsigned char> &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pkw->wrap(toTag(tag), header, key);
+}
+
+vector<unsigned char> EpochPKW::unwrap(EpochTag tag, vector<unsigned char> &header, ciphertext &c) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pkw->unwrap(toTag(tag), header, c);
+}
+
+void EpochPKW::punc(EpochTag tag) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tag.epoch < firstLive) {
+        return; /* the whole epoch is punctured */
+    }
+    pkw->punc(toTag(tag));
+}
+
+long EpochPKW::getNumPuncs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pkw->getNumPuncs();
+}
+
+size_t EpochPKW::getNumNodes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pkw->getNumNodes();
+}
+
+uint64_t EpochPKW::currentEpoch() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+uint64_t EpochPKW::oldestLiveEpoch() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return firstLive;
+}
+
+void EpochPKW::secureTeardown() {
+    stopScheduler();
+    std::lock_guard<std::mutex> lock(mutex);
+    pkw->secureTeardown();
+}
+
+SecureByteBuffer EpochPKW::serializeKey() {
+    std::lock_guard<std::mutex> lock(mutex);
+    SecureByteBuffer key = pkw->serializeKey();
+    const size_t headerLen = HEADER_FIELDS * sizeof(uint64_t);
+    SecureByteBuffer serialized(headerLen + key.size());
+    putU64(serialized, 0, epochBits);
+    putU64(serialized, 8, counterBits);
+    putU64(serialized, 16, retention);
+    putU64(serialized, 24, current);
+    putU64(serialized, 32, firstLive);
+    std::copy(key.begin(), key.end(), serialized.begin() + headerLen);
+    return serialized;
+}
+
+SecureByteBuffer EpochPKW::serializeAndEncryptKey(const std::string &password) {
+    auto serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
+
+void EpochPKW::advanceTo(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    advanceLocked(epoch);
+}
+
+void EpochPKW::expireThrough(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (epoch >= current) {
+        throw IllegalTagException();
+    }
+    expireLocked(epoch);
+}
+
+void EpochPKW::advanceLocked(uint64_t epoch) {
+    if (epoch >> epochBits != 0) {
+        throw IllegalTagException();
+    }
+    if (epoch <= current) {
+        return;
+    }
+    current = epoch;
+    if (current >= retention) {
+        expireLocked(current - retention);
+    }
+}
+
+/*
+ * Punctures the epochs from firstLive to last as few aligned subtrees as possible: a range of n epochs takes at most
+ * 2 log n subtree punctures.
+ */
+void EpochPKW::expireLocked(uint64_t last) {
+    uint64_t from = firstLive;
+    while (from <= last) {
+        int level = 0;
+        while (level < epochBits && (from & ((uint64_t(2) << level) - 1)) == 0 && last - from >= (uint64_t(2) << level) - 1) {
+            ++level;
+        }
+        pkw->puncPrefix(Tag(from) << counterBits, epochBits - level);
+        from += uint64_t(1) << level;
+    }
+    firstLive = std::max(firstLive, last + 1);
+}
+
+void EpochPKW::startScheduler(std::chrono::milliseconds epochLength) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (scheduler.joinable()) {
+        throw PuncturableKeyWrappingException();
+    }
+    stopping = false;
+    scheduler = std::thread(&EpochPKW::runScheduler, this, epochLength);
+}
+
+void EpochPKW::stopScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    if (scheduler.joinable() && scheduler.get_id() != std::this_thread::get_id()) {
+        scheduler.join();
+    }
+}
+
+void EpochPKW::runScheduler(std::chrono::milliseconds epochLength) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next = std::chrono::steady_clock::now() + epochLength;
+    while (!wakeup.wait_until(lock, next, [this]() { return stopping; })) {
+        if ((current + 1) >> epochBits != 0) {
+            return; /* epoch space exhausted */
+        }
+        advanceLocked(current + 1);
+        next += epochLength;
+    }
+}
+
+std::shared_ptr<AbstractPKW<EpochTag, ciphertext>> EpochPKWFactory::fromSerialized(SecureByteBuffer &serialized) {
+    return std::shared_ptr<AbstractPKW<EpochTag, ciphertext>>(new EpochPKW(serialized));// constructor protected
+}
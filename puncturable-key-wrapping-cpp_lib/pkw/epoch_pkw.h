@@ -0,0 +1,138 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_EPOCH_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_EPOCH_PKW_H
+
+#include "pkw.h"
+#include "pprf_aead_pkw.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Tag of an EpochPKW: a counter within an epoch.
+ */
+struct EpochTag {
+        uint64_t epoch;
+        uint64_t counter;
+};
+
+/**
+ * A PPRF_AEAD_PKW whose tags are (epoch, counter) pairs, with the epoch in the high tag bits, so that all tags of an
+ * epoch form one subtree of the GGM tree. Epochs older than the retention window are expired by puncturing their
+ * subtrees as a whole (see GGM_PPRF::puncPrefix), which leaves at most one node per tree level behind instead of one
+ * co-path per tag. The key thus grows with the number of live epochs and the punctures within them only.
+ * <br>
+ * Only the epochs of the retention window, ending with the current epoch, can be used. Epochs advance explicitly or
+ * from a background scheduler. All methods may be called concurrently.
+ */
+class EpochPKW : public AbstractPKW<EpochTag, ciphertext> {
+    public:
+        /**
+         * Constructs a fresh instance with a random key, starting at epoch 0.
+         * @param epochBits the number of bits of the epoch, between 1 and 63
+         * @param counterBits the number of bits of the counter within an epoch, between 0 and 64
+         * @param retention the number of live epochs, at least 1
+         * @param keyLen the size of the key space in number of bits
+         * @throws IllegalTagException if the parameters are out of range
+         */
+        EpochPKW(int epochBits, int counterBits, uint64_t retention, int keyLen = 128);
+
+        ~EpochPKW();
+
+        ciphertext wrap(EpochTag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+        std::vector<unsigned char> unwrap(EpochTag tag, std::vector<unsigned char> &header, ciphertext &c) override;
+        void punc(EpochTag tag) override;
+        long getNumPuncs() override;
+        void secureTeardown() override;
+
+        /**
+         * Serializes the epoch state and the key.
+         * @return the serialized key
+         */
+        SecureByteBuffer serializeKey() override;
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+        /**
+         * Makes epoch the current epoch and expires the epochs that fall out of the retention window. Earlier epochs
+         * than the current one are ignored.
+         * @param epoch the new current epoch
+         * @throws IllegalTagException if epoch does not fit in the epoch bits
+         */
+        void advanceTo(uint64_t epoch);
+
+        /**
+         * Expires all epochs up to and including epoch ahead of the retention window.
+         * @param epoch the last epoch to expire
+         * @throws IllegalTagException if epoch is not before the current epoch
+         */
+        void expireThrough(uint64_t epoch);
+
+        uint64_t currentEpoch();
+        uint64_t oldestLiveEpoch();
+        size_t getNumNodes();
+
+        /**
+         * Starts a background thread advancing to the next epoch every epochLength.
+         * @param epochLength the length of an epoch
+         * @throws PuncturableKeyWrappingException if a scheduler is already running
+         */
+        void startScheduler(std::chrono::milliseconds epochLength);
+
+        /**
+         * Stops the background scheduler, if running, and waits for it to finish.
+         */
+        void stopScheduler();
+
+    protected:
+        explicit EpochPKW(SecureByteBuffer serializedKey);
+
+    private:
+        friend class EpochPKWFactory;
+        int epochBits;
+        int counterBits;
+        uint64_t retention;
+        uint64_t current = 0;
+        uint64_t firstLive = 0;
+        std::unique_ptr<PPRF_AEAD_PKW> pkw;
+
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::thread scheduler;
+        bool stopping = false;
+
+        void checkParameters() const;
+        Tag toTag(const EpochTag &tag) const;
+        void advanceLocked(uint64_t epoch);
+        void expireLocked(uint64_t last);
+        void runScheduler(std::chrono::milliseconds epochLength);
+};
+
+class EpochPKWFactory : public AbstractPKWFactory<EpochTag, ciphertext> {
+    public:
+        std::shared_ptr<AbstractPKW<EpochTag, ciphertext>> fromSerialized(SecureByteBuffer &serialized) override;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_EPOCH_PKW_H
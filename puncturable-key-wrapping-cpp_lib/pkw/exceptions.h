@@ -41,4 +41,8 @@ class IllegalTagException : public PuncturableKeyWrappingException {
 class DeserializationError : public PuncturableKeyWrappingException {};
 class ExportException : public PuncturableKeyWrappingException {};
 class ImportException : public PuncturableKeyWrappingException {};
+class MigrationException : public PuncturableKeyWrappingException {};
+class StreamException : public PuncturableKeyWrappingException {};
+/* the operation needs key material that secureTeardown already erased */
+class TornDownException : public PuncturableKeyWrappingException {};
 #endif//PUNCTURABLE_KEY_WRAPPING_CPP_EXCEPTIONS_H
\ No newline at end of file
@@ -19,6 +19,7 @@
  **********************************************************************************************************************/
 
 #include "password_encrypt.h"
+#include "metrics.h"
 #include "pkw/exceptions.h"
 #include "secure_byte_buffer.h"
 #include <cryptopp/aes.h>
@@ -38,6 +39,8 @@
 SecureByteBuffer generateKeyFromPassword(const std::string &password, SecureByteBuffer &salt);
 
 SecureByteBuffer encryptExport(SecureByteBuffer &plaintext, const std::string &password) {
+    MetricsTimer timer(MetricOp::Export);
+    PKWMetrics::instance().count(MetricCounter::Exports);
     SecureByteBuffer salt(SALT_LEN);
     CryptoPP::OS_GenerateRandomBlock(true, salt.data(), salt.size());
     SecureByteBuffer enc_key = generateKeyFromPassword(password, salt);
@@ -79,6 +82,8 @@ SecureByteBuffer generateKeyFromPassword(const std::string &password, SecureByte
 }
 
 SecureByteBuffer decryptExport(const SecureByteBuffer &data, const std::string &password) {
+    MetricsTimer timer(MetricOp::Import);
+    PKWMetrics::instance().count(MetricCounter::Imports);
     SecureByteBuffer salt(SALT_LEN);
     SecureByteBuffer iv(NONCE_LEN);
 
@@ -93,6 +98,9 @@ SecureByteBuffer decryptExport(const SecureByteBuffer &data, const std::string &
 }
 
 SecureByteBuffer decrypt(const SecureByteBuffer &ciphertext, SecureByteBuffer &enc_key, SecureByteBuffer &iv, std::vector<unsigned char> aad) {
+    if (ciphertext.size() < MAC_LEN) {
+        throw UnwrappingException();
+    }
     try {
         CryptoPP::GCM<CryptoPP::AES>::Decryption d;
         d.SetKeyWithIV(enc_key.data(), enc_key.size(), iv.data(), iv.size());
@@ -130,6 +138,7 @@ SecureByteBuffer decrypt(const SecureByteBuffer &ciphertext, SecureByteBuffer &e
         }
         return SecureByteBuffer(retrieved);
     } catch (CryptoPP::Exception &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedImports);
         throw ImportException();
     }
 }
\ No newline at end of file
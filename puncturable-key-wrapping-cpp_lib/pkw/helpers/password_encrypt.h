@@ -21,6 +21,7 @@
 #ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PASSWORD_ENCRYPT_H
 #define PUNCTURABLE_KEY_WRAPPING_CPP_PASSWORD_ENCRYPT_H
 #include "secure_byte_buffer.h"
+#include <string>
 #include <vector>
 
 SecureByteBuffer encryptExport(SecureByteBuffer &plaintext, const std::string &password);
@@ -0,0 +1,154 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "puncture_set.h"
+#include "pkw/exceptions.h"
+#include <algorithm>
+
+const size_t PunctureSet::ARRAY_MAX;
+
+template<typename T>
+static void writeLE(std::vector<unsigned char> &buffer, T t) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        buffer.push_back(static_cast<unsigned char>((static_cast<uint64_t>(t) >> (8 * i)) & 0xFF));
+    }
+}
+
+template<typename T>
+static T readLE(const unsigned char *data, size_t size, size_t &offset) {
+    if (size < offset + sizeof(T)) {
+        throw DeserializationError();
+    }
+    uint64_t t = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        t |= static_cast<uint64_t>(data[offset + i]) << (8 * i);
+    }
+    offset += sizeof(T);
+    return static_cast<T>(t);
+}
+
+bool PunctureSet::insert(uint64_t tag) {
+    Container &container = containers[tag >> 16];
+    const uint16_t low = tag & 0xFFFF;
+    if (container.bitmap.empty()) {
+        auto it = std::lower_bound(container.array.begin(), container.array.end(), low);
+        if (it != container.array.end() && *it == low) {
+            return false;
+        }
+        if (container.array.size() < ARRAY_MAX) {
+            container.array.insert(it, low);
+        } else {
+            container.bitmap.assign(BITMAP_WORDS, 0);
+            for (uint16_t v: container.array) {
+                container.bitmap[v >> 6] |= uint64_t(1) << (v & 63);
+            }
+            std::vector<uint16_t>().swap(container.array);
+            container.bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+    } else {
+        uint64_t &word = container.bitmap[low >> 6];
+        if (word & (uint64_t(1) << (low & 63))) {
+            return false;
+        }
+        word |= uint64_t(1) << (low & 63);
+    }
+    container.cardinality += 1;
+    cardinality += 1;
+    return true;
+}
+
+bool PunctureSet::contains(uint64_t tag) const {
+    auto it = containers.find(tag >> 16);
+    if (it == containers.end()) {
+        return false;
+    }
+    const Container &container = it->second;
+    const uint16_t low = tag & 0xFFFF;
+    if (container.bitmap.empty()) {
+        return std::binary_search(container.array.begin(), container.array.end(), low);
+    }
+    return (container.bitmap[low >> 6] >> (low & 63)) & 1u;
+}
+
+size_t PunctureSet::memoryBytes() const {
+    /* a red-black tree node: color and three links, followed by the entry */
+    size_t bytes = sizeof(*this) + containers.size() * (4 * sizeof(void *) + sizeof(std::pair<const uint64_t, Container>));
+    for (auto &entry: containers) {
+        bytes += entry.second.array.capacity() * sizeof(uint16_t) + entry.second.bitmap.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+void PunctureSet::serialize(std::vector<unsigned char> &buffer) const {
+    writeLE<uint64_t>(buffer, containers.size());
+    for (auto &entry: containers) {
+        const Container &container = entry.second;
+        writeLE<uint64_t>(buffer, entry.first);
+        writeLE<uint32_t>(buffer, container.cardinality);
+        writeLE<uint8_t>(buffer, container.bitmap.empty() ? 0 : 1);
+        if (container.bitmap.empty()) {
+            for (uint16_t v: container.array) {
+                writeLE<uint16_t>(buffer, v);
+            }
+        } else {
+            for (uint64_t w: container.bitmap) {
+                writeLE<uint64_t>(buffer, w);
+            }
+        }
+    }
+}
+
+PunctureSet PunctureSet::deserialize(const unsigned char *data, size_t size, size_t &offset) {
+    PunctureSet set;
+    auto numContainers = readLE<uint64_t>(data, size, offset);
+    for (uint64_t c = 0; c < numContainers; ++c) {
+        auto key = readLE<uint64_t>(data, size, offset);
+        auto count = readLE<uint32_t>(data, size, offset);
+        auto kind = readLE<uint8_t>(data, size, offset);
+        if (count == 0 || count > (1u << 16) || kind > 1 || (kind == 0) != (count <= ARRAY_MAX) ||
+            (!set.containers.empty() && set.containers.rbegin()->first >= key)) {
+            throw DeserializationError();
+        }
+        Container &container = set.containers[key];
+        if (kind == 0) {
+            container.array.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                auto v = readLE<uint16_t>(data, size, offset);
+                if (!container.array.empty() && container.array.back() >= v) {
+                    throw DeserializationError();
+                }
+                container.array.push_back(v);
+            }
+        } else {
+            container.bitmap.reserve(BITMAP_WORDS);
+            uint32_t bits = 0;
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                container.bitmap.push_back(readLE<uint64_t>(data, size, offset));
+                bits += __builtin_popcountll(container.bitmap.back());
+            }
+            if (bits != count) {
+                throw DeserializationError();
+            }
+        }
+        container.cardinality = count;
+        set.cardinality += count;
+    }
+    return set;
+}
@@ -0,0 +1,82 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PUNCTURE_SET_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PUNCTURE_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * A compressed set of punctured tags in the style of roaring bitmaps: tags are grouped by their upper 48 bits, and each
+ * group of up to 2^16 tags is stored as a sorted array of the lower 16 bits while it is sparse, and as a bitmap once it
+ * holds more than ARRAY_MAX tags. Memory is thus proportional to the number of tags, with at most 8 KiB per group.
+ */
+class PunctureSet {
+    public:
+        static const size_t ARRAY_MAX = 4096;
+
+        /**
+         * Adds a tag.
+         * @param tag the tag
+         * @return false if the tag was already contained
+         */
+        bool insert(uint64_t tag);
+        bool contains(uint64_t tag) const;
+        size_t size() const { return cardinality; }
+
+        /**
+         * Returns the bytes held by the containers, including the map nodes.
+         */
+        size_t memoryBytes() const;
+
+        /**
+         * Appends the set to buffer: the number of groups, then per group its key, cardinality, kind and payload.
+         * @param buffer the buffer
+         */
+        void serialize(std::vector<unsigned char> &buffer) const;
+
+        /**
+         * Reads a set written by serialize.
+         * @param data the serialized data
+         * @param size the size of data
+         * @param offset the offset of the set in data; advanced past it
+         * @return the set
+         * @throws DeserializationError if the data is malformed
+         */
+        static PunctureSet deserialize(const unsigned char *data, size_t size, size_t &offset);
+
+    private:
+        static const size_t BITMAP_WORDS = (1u << 16) / 64;
+
+        /* either a sorted array of low bits (bitmap empty) or a bitmap of BITMAP_WORDS words */
+        struct Container {
+                std::vector<uint16_t> array;
+                std::vector<uint64_t> bitmap;
+                uint32_t cardinality = 0;
+        };
+
+        std::map<uint64_t, Container> containers;
+        size_t cardinality = 0;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PUNCTURE_SET_H
@@ -0,0 +1,163 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "mapped_naive_pkw.h"
+#include "exceptions.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "tracing.h"
+#include <cryptopp/osrng.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using byte = unsigned char;
+using std::vector;
+
+MappedNaivePKW::MappedNaivePKW(const std::string &path) {
+    fd = ::open(path.c_str(), O_RDWR);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        MappedNaivePKW::secureTeardown();
+        throw ImportException();
+    }
+    mappingSize = st.st_size;
+    void *addr = mappingSize == 0 ? MAP_FAILED : mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        MappedNaivePKW::secureTeardown();
+        throw ImportException();
+    }
+    mapping = static_cast<byte *>(addr);
+    try {
+        NaiveKeyTable::open(mapping, mappingSize);
+    } catch (DeserializationError &e) {
+        MappedNaivePKW::secureTeardown();
+        throw;
+    }
+}
+
+void MappedNaivePKW::create(const std::string &path, int tagLen) {
+    const size_t size = NaiveKeyTable::sizeFor(tagLen);
+    int out = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (out < 0) {
+        throw ExportException();
+    }
+    void *addr = ftruncate(out, size) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0) : MAP_FAILED;
+    if (addr == MAP_FAILED) {
+        ::close(out);
+        throw ExportException();
+    }
+    NaiveKeyTable t = NaiveKeyTable::init(static_cast<byte *>(addr), tagLen);
+    CryptoPP::OS_GenerateRandomBlock(true, t.key(0), t.numTags() * KEY_LEN);
+    bool synced = msync(addr, size, MS_SYNC) == 0;
+    munmap(addr, size);
+    ::close(out);
+    if (!synced) {
+        throw ExportException();
+    }
+}
+
+MappedNaivePKW::~MappedNaivePKW() {
+    MappedNaivePKW::secureTeardown();
+}
+
+void MappedNaivePKW::secureTeardown() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+NaiveKeyTable MappedNaivePKW::layout() const {
+    if (mapping == nullptr) {
+        throw TornDownException();
+    }
+    return NaiveKeyTable::open(mapping, mappingSize);
+}
+
+void MappedNaivePKW::checkTag(long tag) const {
+    if (tag < 0 || tag >= layout().numTags()) {
+        throw IllegalTagException();
+    }
+}
+
+const byte *MappedNaivePKW::getAndCheckKey(long tag) const {
+    checkTag(tag);
+    NaiveKeyTable t = layout();
+    /* a zero key is never random: the file was modified or torn by a crash, and must not be wrapped under */
+    if (t.isPunctured(tag) || t.isZeroKey(tag)) {
+        throw IllegalTagException();
+    }
+    return t.key(tag);
+}
+
+vector<byte> MappedNaivePKW::wrap(long tag, vector<byte> &, vector<byte> &key) {
+    return naiveWrap(getAndCheckKey(tag), key);
+}
+
+vector<byte> MappedNaivePKW::unwrap(long tag, vector<byte> &, vector<byte> &c) {
+    return naiveUnwrap(getAndCheckKey(tag), c);
+}
+
+void MappedNaivePKW::flush(size_t offset, size_t len) const {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page * page;
+    if (msync(mapping + begin, offset + len - begin, MS_SYNC) != 0) {
+        throw PuncturingException();
+    }
+}
+
+void MappedNaivePKW::punc(long tag) {
+    checkTag(tag);
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, layout().numTags());
+    NaiveKeyTable t = layout();
+    /*
+     * The mark is durable before the key is erased, so a crash in between leaves the tag punctured with its key still
+     * on disk, never live with a zero key. Puncturing such a tag again erases the key.
+     */
+    if (t.markPunctured(tag)) {
+        flush(t.bitmapOffset(tag), 1);
+        flush(0, NaiveKeyTable::HEADER_LEN);
+    } else if (t.isZeroKey(tag)) {
+        return;
+    }
+    t.zeroizeKey(tag);
+    flush(t.keyOffset(tag), KEY_LEN);
+}
+
+long MappedNaivePKW::getNumPuncs() {
+    return layout().numPunctures();
+}
+
+SecureByteBuffer MappedNaivePKW::serializeKey() {
+    NaiveKeyTable t = layout();
+    SecureByteBuffer copy(t.size());
+    std::copy(t.data(), t.data() + t.size(), copy.begin());
+    return copy;
+}
+
+SecureByteBuffer MappedNaivePKW::serializeAndEncryptKey(const std::string &password) {
+    SecureByteBuffer serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
@@ -0,0 +1,89 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_MAPPED_NAIVE_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_MAPPED_NAIVE_PKW_H
+
+#include "naive_key_table.h"
+#include "naive_pkw.h"
+#include "pkw.h"
+#include <string>
+#include <vector>
+
+/**
+ * A NaivePKW working directly on a NaiveKeyTable in a memory-mapped file, e.g. one written from
+ * NaivePKW::serializeKey. Opening is O(1) regardless of the table size; wrap and unwrap read the key from the mapping,
+ * and punc sets the tag's bitmap bit and then zeroizes its key in place, flushing each step to the file before the
+ * next. A tag whose key reads as zero is rejected like a punctured one.
+ */
+class MappedNaivePKW : public AbstractPKW<long, std::vector<unsigned char>> {
+    public:
+        /**
+         * Maps an existing table.
+         * @param path the file
+         * @throws ImportException if the file cannot be opened or mapped
+         * @throws DeserializationError if the file does not hold a table
+         */
+        explicit MappedNaivePKW(const std::string &path);
+
+        /**
+         * Creates a file holding a fresh table with random keys.
+         * @param path the file, which is replaced
+         * @param tagLen the size of the tag space in number of bits
+         * @throws IllegalTagException if tagLen is not between 0 and NaiveKeyTable::MAX_TAG_LEN
+         * @throws ExportException if the file cannot be written
+         */
+        static void create(const std::string &path, int tagLen);
+
+        MappedNaivePKW(const MappedNaivePKW &) = delete;
+        MappedNaivePKW &operator=(const MappedNaivePKW &) = delete;
+        ~MappedNaivePKW();
+
+        std::vector<unsigned char> unwrap(long tag, std::vector<unsigned char> &header, std::vector<unsigned char> &c) override;
+
+        std::vector<unsigned char>
+        wrap(long tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+
+        void punc(long tag) override;
+
+        long getNumPuncs() override;
+
+        /**
+         * Unmaps the table; the instance cannot be used afterwards, its operations throw TornDownException. The file is
+         * kept, as it is the key's storage.
+         */
+        void secureTeardown() override;
+
+        SecureByteBuffer serializeKey() override;
+
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+    private:
+        int fd = -1;
+        unsigned char *mapping = nullptr;
+        size_t mappingSize = 0;
+
+        NaiveKeyTable layout() const;
+        const unsigned char *getAndCheckKey(long tag) const;
+        void checkTag(long tag) const;
+        void flush(size_t offset, size_t len) const;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_MAPPED_NAIVE_PKW_H
@@ -0,0 +1,131 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "naive_key_table.h"
+#include "exceptions.h"
+#include "naive_pkw.h"
+#include "secure_memzero.h"
+#include <cstring>
+
+const size_t NaiveKeyTable::HEADER_LEN;
+const int NaiveKeyTable::MAX_TAG_LEN;
+
+static const char MAGIC[8] = {'N', 'P', 'K', 'W', 'T', 'B', 'L', '1'};
+static const size_t TAG_LEN_FIELD = 8;
+static const size_t KEY_LEN_FIELD = 16;
+static const size_t PUNCS_FIELD = 24;
+
+static uint64_t readField(const unsigned char *base, size_t offset) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        v |= static_cast<uint64_t>(base[offset + i]) << (8 * i);
+    }
+    return v;
+}
+
+static void writeField(unsigned char *base, size_t offset, uint64_t v) {
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        base[offset + i] = static_cast<unsigned char>((v >> (8 * i)) & 0xFF);
+    }
+}
+
+static size_t bitmapBytesFor(int tagLen) {
+    size_t bytes = ((size_t(1) << tagLen) + 7) / 8;
+    return (bytes + 15) & ~size_t(15);
+}
+
+size_t NaiveKeyTable::keyBytes() {
+    return KEY_LEN;
+}
+
+size_t NaiveKeyTable::sizeFor(int tagLen) {
+    if (tagLen < 0 || tagLen > MAX_TAG_LEN) {
+        throw IllegalTagException();
+    }
+    return HEADER_LEN + bitmapBytesFor(tagLen) + (size_t(1) << tagLen) * keyBytes();
+}
+
+size_t NaiveKeyTable::bitmapBytes() const {
+    return bitmapBytesFor(len);
+}
+
+NaiveKeyTable NaiveKeyTable::init(unsigned char *base, int tagLen) {
+    std::memcpy(base, MAGIC, sizeof(MAGIC));
+    writeField(base, TAG_LEN_FIELD, tagLen);
+    writeField(base, KEY_LEN_FIELD, keyBytes() * 8);
+    writeField(base, PUNCS_FIELD, 0);
+    std::memset(base + HEADER_LEN, 0, bitmapBytesFor(tagLen));
+    return {base, tagLen};
+}
+
+bool NaiveKeyTable::hasMagic(const unsigned char *base, size_t size) {
+    return size >= HEADER_LEN && std::memcmp(base, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+NaiveKeyTable NaiveKeyTable::open(unsigned char *base, size_t size) {
+    if (!hasMagic(base, size)) {
+        throw DeserializationError();
+    }
+    uint64_t tagLen = readField(base, TAG_LEN_FIELD);
+    if (tagLen > (uint64_t) MAX_TAG_LEN || readField(base, KEY_LEN_FIELD) != keyBytes() * 8 || size != sizeFor((int) tagLen)) {
+        throw DeserializationError();
+    }
+    return {base, (int) tagLen};
+}
+
+long NaiveKeyTable::numPunctures() const {
+    return static_cast<long>(readField(base, PUNCS_FIELD));
+}
+
+bool NaiveKeyTable::punc(long tag) {
+    if (!markPunctured(tag)) {
+        return false;
+    }
+    zeroizeKey(tag);
+    return true;
+}
+
+bool NaiveKeyTable::markPunctured(long tag) {
+    if (isPunctured(tag)) {
+        return false;
+    }
+    bitmap()[tag >> 3] |= static_cast<unsigned char>(1u << (tag & 7));
+    writeField(base, PUNCS_FIELD, numPunctures() + 1);
+    return true;
+}
+
+void NaiveKeyTable::zeroizeKey(long tag) {
+    secure_memzero(key(tag), keyBytes());
+}
+
+bool NaiveKeyTable::isZeroKey(long tag) const {
+    unsigned char bits = 0;
+    const unsigned char *k = key(tag);
+    for (size_t i = 0; i < keyBytes(); ++i) {
+        bits |= k[i];
+    }
+    return bits == 0;
+}
+
+void NaiveKeyTable::puncAll() {
+    secure_memzero(keys(), numTags() * keyBytes());
+    std::memset(bitmap(), 0xFF, bitmapBytes());
+    writeField(base, PUNCS_FIELD, numTags());
+}
@@ -0,0 +1,128 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_NAIVE_KEY_TABLE_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_NAIVE_KEY_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * View of the fixed layout in which NaivePKW keys are held and serialized:
+ * <ul>
+ * <li>header: magic "NPKWTBL1", tag length, key length and number of punctures, each a little-endian uint64</li>
+ * <li>bitmap: bit t % 8 of byte t / 8 is set if tag t is punctured, padded to a multiple of 16 bytes</li>
+ * <li>keys: KEY_LEN bytes per tag, the key of tag t at offset t * KEY_LEN; keys of punctured tags are zero</li>
+ * </ul>
+ * All offsets follow from the tag length, so a table works in place, e.g. in a memory-mapped file.
+ * The view does not own the memory.
+ */
+class NaiveKeyTable {
+    public:
+        static const size_t HEADER_LEN = 32;
+        static const int MAX_TAG_LEN = 40;
+
+        /**
+         * Returns the size of the table for 2^tagLen tags.
+         * @throws IllegalTagException if tagLen is not between 0 and MAX_TAG_LEN
+         */
+        static size_t sizeFor(int tagLen);
+
+        /**
+         * Writes the header and an empty bitmap; the keys are left to the caller.
+         * @param base memory of sizeFor(tagLen) bytes
+         * @param tagLen the size of the tag space in number of bits
+         * @return the view
+         */
+        static NaiveKeyTable init(unsigned char *base, int tagLen);
+
+        /**
+         * Checks the header and the size of an existing table.
+         * @param base the table
+         * @param size the size of the memory at base
+         * @return the view
+         * @throws DeserializationError if base does not hold a table of this size
+         */
+        static NaiveKeyTable open(unsigned char *base, size_t size);
+
+        /**
+         * Returns whether the memory starts with the table magic.
+         */
+        static bool hasMagic(const unsigned char *base, size_t size);
+
+        /**
+         * Views memory already known to hold a table for tagLen, without checking it.
+         */
+        NaiveKeyTable(unsigned char *base, int tagLen) : base(base), len(tagLen) {}
+
+        int tagLen() const { return len; }
+        long numTags() const { return 1L << len; }
+        long numPunctures() const;
+        bool isPunctured(long tag) const { return (bitmap()[tag >> 3] >> (tag & 7)) & 1u; }
+        unsigned char *key(long tag) const { return keys() + tag * keyBytes(); }
+        unsigned char *data() const { return base; }
+        size_t size() const { return sizeFor(len); }
+        size_t bitmapBytes() const;
+
+        /**
+         * Zeroizes the key of tag, marks it in the bitmap and counts the puncture in the header.
+         * @param tag the tag, which must be in range
+         * @return false if the tag was already punctured
+         */
+        bool punc(long tag);
+
+        /**
+         * The first half of punc: marks tag in the bitmap and counts the puncture, leaving its key in place.
+         * @param tag the tag, which must be in range
+         * @return false if the tag was already punctured
+         */
+        bool markPunctured(long tag);
+
+        /**
+         * The second half of punc: zeroizes the key of tag.
+         */
+        void zeroizeKey(long tag);
+
+        /**
+         * Returns whether the key of tag is all zeros, in time independent of its value.
+         */
+        bool isZeroKey(long tag) const;
+
+        /**
+         * Zeroizes all keys and marks all tags as punctured.
+         */
+        void puncAll();
+
+        /**
+         * Offsets of the memory punc(tag) writes, for callers that need to flush it.
+         */
+        size_t bitmapOffset(long tag) const { return HEADER_LEN + (tag >> 3); }
+        size_t keyOffset(long tag) const { return HEADER_LEN + bitmapBytes() + tag * keyBytes(); }
+
+    private:
+        unsigned char *base;
+        int len;
+
+        static size_t keyBytes();
+        unsigned char *bitmap() const { return base + HEADER_LEN; }
+        unsigned char *keys() const { return base + HEADER_LEN + bitmapBytes(); }
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_NAIVE_KEY_TABLE_H
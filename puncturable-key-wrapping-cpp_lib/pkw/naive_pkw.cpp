@@ -20,45 +20,18 @@
 
 #include "naive_pkw.h"
 #include "exceptions.h"
+#include "naive_key_table.h"
 #include "pkw/helpers/password_encrypt.h"
-#include "secure_memzero.h"
-#include <cmath>
+#include "tracing.h"
+#include <algorithm>
 #include <cryptopp/cryptlib.h>
 #include <cryptopp/osrng.h>
 #include <utility>
 
 using byte = unsigned char;
-using std::array;
-using std::pair;
 using std::vector;
 
-NaivePKW::NaivePKW(SecureByteBuffer serializedKey) {
-    this->numPunctures = NaivePKWSerializer::deserializePuncs(serializedKey);
-    this->keys = NaivePKWSerializer::deserializeKey(serializedKey, sizeof(long));
-}
-
-NaivePKW::NaivePKW(int tagLen) : numPunctures(0) {
-    for (long i = 0; i < powl(2, tagLen); ++i) {
-        this->keys[i] = new array<byte, KEY_LEN>;
-        CryptoPP::OS_GenerateRandomBlock(true, this->keys[i]->data(), this->keys[i]->size());
-    }
-}
-
-void NaivePKW::punc(long tag) {
-    checkTag(tag);
-    if (this->keys[tag] == nullptr) {
-        return;
-    }
-    secure_memzero(this->keys[tag]->data(), KEY_LEN);
-    delete this->keys[tag];
-    this->keys[tag] = nullptr;
-    this->numPunctures += 1;
-}
-
-vector<byte>
-NaivePKW::wrap(long tag, vector<byte> &header, vector<byte> &key) {
-    byte *kek = getAndCheckKey(tag);
-    long cipherTextLen = MAC_LEN + key.size();
+vector<byte> naiveWrap(const byte *kek, vector<byte> &key) {
     SecureByteBuffer iv(KEY_LEN);
     SecureByteBuffer enc_key(KEY_LEN);
     std::copy(kek, kek + KEY_LEN, enc_key.begin());
@@ -67,11 +40,9 @@ NaivePKW::wrap(long tag, vector<byte> &header, vector<byte> &key) {
     return encrypt(key_buffer, enc_key, iv, vector<byte>());
 }
 
-vector<byte>
-NaivePKW::unwrap(long tag, vector<byte> &header, vector<byte> &c) {
-    byte *kek = getAndCheckKey(tag);
-    checkTag(tag);
-    SecureByteBuffer ciphertext(c);
+vector<byte> naiveUnwrap(const byte *kek, vector<byte> &c) {
+    vector<byte> ccopy = c; /* the buffer takes over the memory of the vector */
+    SecureByteBuffer ciphertext(ccopy);
     SecureByteBuffer enc_key(KEY_LEN);
     SecureByteBuffer iv(KEY_LEN);
     std::copy(kek, kek + KEY_LEN, enc_key.begin());
@@ -79,33 +50,68 @@ NaivePKW::unwrap(long tag, vector<byte> &header, vector<byte> &c) {
     return {plain.begin(), plain.end()};
 }
 
+NaivePKW::NaivePKW(SecureByteBuffer serializedKey) : tagLen(0) {
+    if (NaiveKeyTable::hasMagic(serializedKey.data(), serializedKey.size())) {
+        tagLen = NaiveKeyTable::open(serializedKey.data(), serializedKey.size()).tagLen();
+        table.swap(serializedKey);
+    } else {
+        SecureByteBuffer records = NaivePKWSerializer::deserializeRecords(serializedKey);
+        table.swap(records);
+        tagLen = NaiveKeyTable::open(table.data(), table.size()).tagLen();
+    }
+}
+
+NaivePKW::NaivePKW(int tagLen) : tagLen(tagLen), table(NaiveKeyTable::sizeFor(tagLen)) {
+    NaiveKeyTable t = NaiveKeyTable::init(table.data(), tagLen);
+    CryptoPP::OS_GenerateRandomBlock(true, t.key(0), t.numTags() * KEY_LEN);
+}
+
+NaiveKeyTable NaivePKW::layout() const {
+    return {const_cast<byte *>(table.data()), tagLen};
+}
+
+void NaivePKW::punc(long tag) {
+    checkTag(tag);
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, layout().numTags());
+    layout().punc(tag);
+}
+
+long NaivePKW::getNumPuncs() {
+    return layout().numPunctures();
+}
+
+vector<byte>
+NaivePKW::wrap(long tag, vector<byte> &, vector<byte> &key) {
+    return naiveWrap(getAndCheckKey(tag), key);
+}
+
+vector<byte>
+NaivePKW::unwrap(long tag, vector<byte> &, vector<byte> &c) {
+    return naiveUnwrap(getAndCheckKey(tag), c);
+}
+
 byte *NaivePKW::getAndCheckKey(long tag) {
     checkTag(tag);
-    byte *kek = keys[tag]->data();
-    if (kek == nullptr) {
+    NaiveKeyTable t = layout();
+    if (t.isPunctured(tag)) {
         throw IllegalTagException();
     }
-    return kek;
+    return t.key(tag);
 }
 
 void NaivePKW::checkTag(long tag) const {
-    if (tag >= keys.size()) {
+    if (tag < 0 || tag >= layout().numTags()) {
         throw IllegalTagException();
     }
 }
 
 void NaivePKW::secureTeardown() {
-    for (pair<const long, array<byte, KEY_LEN> *> &p: this->keys) {
-        if (p.second != nullptr) {
-            secure_memzero(p.second->data(), KEY_LEN);
-            delete p.second;
-            p.second = nullptr;
-        }
-    }
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, layout().numTags());
+    layout().puncAll();
 }
 
 SecureByteBuffer NaivePKW::serializeKey() {
-    return NaivePKWSerializer(this->keys, this->numPunctures).serialize();
+    return table;
 }
 
 
@@ -114,82 +120,80 @@ SecureByteBuffer NaivePKW::serializeAndEncryptKey(const std::string &password) {
     return encryptExport(serialized, password);
 }
 
-NaivePKW::~NaivePKW() {
-    NaivePKW::secureTeardown();
+MemoryUsage NaivePKW::memoryUsageFor(size_t liveKeys) const {
+    NaiveKeyTable t = layout();
+    MemoryUsage usage;
+    usage.secretBytes = liveKeys * KEY_LEN;
+    usage.indexBytes = NaiveKeyTable::HEADER_LEN + t.bitmapBytes();
+    usage.containerBytes = sizeof(*this);
+    /* zeroized slots of punctured tags stay allocated */
+    usage.slackBytes = (t.numTags() - liveKeys) * KEY_LEN + heapChunkSize(table.size()) - table.size();
+    return usage;
 }
 
-std::shared_ptr<AbstractPKW<long, vector<unsigned char>>> NaivePKWFactory::fromSerialized(SecureByteBuffer &serialized) {
-    return std::shared_ptr<AbstractPKW<long, vector<unsigned char>>>(new NaivePKW(serialized));// cannot use std::make_shared; constructor protected
+MemoryUsage NaivePKW::memoryUsage() const {
+    return memoryUsageFor(layout().numTags() - layout().numPunctures());
 }
 
-template<typename T>
-void NaivePKWSerializer::writeT(std::vector<unsigned char> &underlyingBuffer, T t) {
-    for (int i = 0; i < sizeof(T); ++i) {
-        underlyingBuffer.push_back((t >> (8 * i)) & 0xFF);
-    }
+MemoryProjection NaivePKW::projectMemoryUsage(size_t k, PunctureOrder, uint64_t) const {
+    size_t liveKeys = layout().numTags() - layout().numPunctures();
+    liveKeys -= std::min(k, liveKeys);
+    MemoryProjection projection;
+    projection.numNodes = liveKeys;
+    projection.usage = memoryUsageFor(liveKeys);
+    projection.serializedBytes = table.size();
+    return projection;
 }
 
-void NaivePKWSerializer::copy(std::vector<unsigned char> &buffer, const unsigned char *toCopy, size_t size) const {
-    for (int i = 0; i < size; ++i) {
-        buffer.push_back(toCopy[i] & 0xFF);
-    }
+NaivePKW::~NaivePKW() {
+    NaivePKW::secureTeardown();
 }
 
-int NaivePKWSerializer::getInt(SecureByteBuffer b, size_t offset) {
-    if (b.size() < offset + sizeof(int)) {
-        throw DeserializationError();
-    }
-    int ret = 0;
-    for (int i = 0; i < sizeof(int); i++) {
-        ret = ret | (b.data()[offset + i] << (i * 8));
-    }
-    return ret;
+std::shared_ptr<AbstractPKW<long, vector<unsigned char>>> NaivePKWFactory::fromSerialized(SecureByteBuffer &serialized) {
+    return std::shared_ptr<AbstractPKW<long, vector<unsigned char>>>(new NaivePKW(serialized));// cannot use std::make_shared; constructor protected
 }
 
-long NaivePKWSerializer::getLong(SecureByteBuffer b, size_t offset) {
+size_t NaivePKWSerializer::getSize(const SecureByteBuffer &b, size_t offset) {
     if (b.size() < offset + sizeof(size_t)) {
         throw DeserializationError();
     }
-    long ret = 0;
-    for (int i = 0; i < sizeof(size_t); i++) {
-        ret = ret | (b.data()[offset + i] << (i * 8));
+    size_t ret = 0;
+    for (size_t i = 0; i < sizeof(size_t); i++) {
+        ret = ret | (static_cast<size_t>(b.data()[offset + i]) << (i * 8));
     }
     return ret;
 }
 
-size_t NaivePKWSerializer::getSize(SecureByteBuffer b, size_t offset) {
-    if (b.size() < offset + sizeof(size_t)) {
+SecureByteBuffer NaivePKWSerializer::deserializeRecords(SecureByteBuffer &serialized) {
+    const size_t recordLen = sizeof(long) + KEY_LEN;
+    size_t puncs = getSize(serialized, 0);
+    if ((serialized.size() - sizeof(long)) % recordLen != 0) {
         throw DeserializationError();
     }
-    size_t ret = 0;
-    for (int i = 0; i < sizeof(size_t); i++) {
-        ret = ret | (b.data()[offset + i] << (i * 8));
+    /* punctured tags have no record */
+    const size_t numTags = (serialized.size() - sizeof(long)) / recordLen + puncs;
+    int tagLen = 0;
+    while (tagLen < NaiveKeyTable::MAX_TAG_LEN && (size_t(1) << tagLen) < numTags) {
+        ++tagLen;
     }
-    return ret;
-}
-NaivePKWSerializer::NaivePKWSerializer(Key keys, long puncs) : keys(std::move(keys)), puncs(puncs) {}
-SecureByteBuffer NaivePKWSerializer::serialize() {
-    vector<unsigned char> buffer;
-    writeT(buffer, puncs);
-    for (auto &entry: keys) {
-        if (entry.second != nullptr) {
-            writeT(buffer, entry.first);
-            copy(buffer, entry.second->begin(), entry.second->size());
+    if ((size_t(1) << tagLen) != numTags) {
+        throw DeserializationError();
+    }
+    SecureByteBuffer table(NaiveKeyTable::sizeFor(tagLen));
+    NaiveKeyTable t = NaiveKeyTable::init(table.data(), tagLen);
+    vector<bool> seen(numTags, false);
+    for (size_t offset = sizeof(long); offset < serialized.size(); offset += recordLen) {
+        size_t index = getSize(serialized, offset);
+        if (index >= numTags || seen[index]) {
+            throw DeserializationError();
         }
+        std::copy(serialized.begin() + offset + sizeof(long), serialized.begin() + offset + recordLen, t.key(index));
+        seen[index] = true;
     }
-    return SecureByteBuffer(buffer);
-}
-Key NaivePKWSerializer::deserializeKey(SecureByteBuffer &serialized, size_t offset) {
-    Key key;
-    while (offset + sizeof(long) < serialized.size()) {
-        long index = getLong(serialized, offset);
-        offset += sizeof(long);
-        key[index] = new std::array<unsigned char, KEY_LEN>;
-        std::copy(serialized.begin() + offset, serialized.begin() + offset + KEY_LEN, key[index]->begin());
-        offset += KEY_LEN;
+    for (size_t tag = 0; tag < numTags; ++tag) {
+        if (!seen[tag]) {
+            t.punc(tag);
+        }
     }
-    return key;
+    return table;
 }
-long NaivePKWSerializer::deserializePuncs(SecureByteBuffer &serialized) {
-    return getLong(serialized, 0);
-}
\ No newline at end of file
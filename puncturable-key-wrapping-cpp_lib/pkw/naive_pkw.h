@@ -22,19 +22,40 @@
 #define PUNCTURABLE_KEY_WRAPPING_CPP_NAIVE_PKW_H
 
 #include "exceptions.h"
+#include "memory_usage.h"
 #include "pkw.h"
+#include "static_pkw.h"
 #include "secure_byte_buffer.h"
-#include <array>
-#include <map>
+#include <vector>
 
 #define MAC_LEN 12
 #define NONCE_LEN 16
 #define KEY_LEN 16
 
-using Key = std::map<long, std::array<unsigned char, KEY_LEN> *>;
-
-class NaivePKW : public AbstractPKW<long, std::vector<unsigned char>> {
+class NaiveKeyTable;
+
+/**
+ * Wraps key with AES-GCM under the key encryption key kek of KEY_LEN bytes; shared by the naive constructions.
+ */
+std::vector<unsigned char> naiveWrap(const unsigned char *kek, std::vector<unsigned char> &key);
+
+/**
+ * Unwraps a ciphertext of naiveWrap.
+ * @throws UnwrappingException if the ciphertext is not authentic
+ */
+std::vector<unsigned char> naiveUnwrap(const unsigned char *kek, std::vector<unsigned char> &c);
+
+/**
+ * Puncturable key wrapping with one independent key per tag. The keys of all 2^tagLen tags live in one contiguous
+ * table in the layout of NaiveKeyTable; puncturing a tag zeroizes its key and marks it in the table's bitmap.
+ * serializeKey returns the table as is, so it can be stored and used in place by MappedNaivePKW.
+ */
+class NaivePKW final : public StaticPKW<NaivePKW, long, std::vector<unsigned char>> {
     public:
+        /**
+         * Creates a table with a random key for each of the 2^tagLen tags.
+         * @throws IllegalTagException if tagLen is not between 0 and NaiveKeyTable::MAX_TAG_LEN
+         */
         explicit NaivePKW(int tagLen);
 
         std::vector<unsigned char> unwrap(long tag, std::vector<unsigned char> &header, std::vector<unsigned char> &c) override;
@@ -44,29 +65,51 @@ class NaivePKW : public AbstractPKW<long, std::vector<unsigned char>> {
 
         void punc(long tag) override;
 
-        long getNumPuncs() override {
-            return numPunctures;
-        }
+        long getNumPuncs() override;
 
         void secureTeardown() override;
 
         SecureByteBuffer serializeKey() override;
 
-        virtual ~NaivePKW();
+        ~NaivePKW();
 
         SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
 
+        /**
+         * Returns the memory held by the key; the depth histogram is empty.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+        /**
+         * Estimates memory and serialized size after k further punctures. Every puncture erases one key, so the order
+         * does not matter.
+         * @param k the number of punctures
+         * @param order ignored
+         * @param seed ignored
+         * @return the projection
+         */
+        MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed = 0) const;
+
     protected:
+        /**
+         * Reconstructs an instance from a table, or from a key in the record format of earlier versions.
+         * @throws DeserializationError if the key is malformed
+         */
         explicit NaivePKW(SecureByteBuffer serializedKey);
 
     private:
         friend class NaivePKWFactory;
-        long numPunctures{};
-        Key keys;
+        int tagLen;
+        SecureByteBuffer table;
+
+        NaiveKeyTable layout() const;
 
         void checkTag(long tag) const;
 
         unsigned char *getAndCheckKey(long tag);
+
+        MemoryUsage memoryUsageFor(size_t liveKeys) const;
 };
 
 
@@ -75,21 +118,22 @@ class NaivePKWFactory : public AbstractPKWFactory<long, std::vector<unsigned cha
         std::shared_ptr<AbstractPKW<long, std::vector<unsigned char>>> fromSerialized(SecureByteBuffer &serialized) override;
 };
 
+/**
+ * Reader for keys in the record format of earlier versions: the number of punctures, then an (index, key) record per
+ * tag that is not punctured.
+ */
 class NaivePKWSerializer {
-    private:
-        static int getInt(SecureByteBuffer b, size_t offset);
-        static size_t getSize(SecureByteBuffer b, size_t offset);
-        template<typename T>
-        void writeT(std::vector<unsigned char> &underlyingBuffer, T t);
-
     public:
-        NaivePKWSerializer(Key keys, long puncs);
-        Key keys;
-        long puncs;
-        SecureByteBuffer serialize();
-        static long deserializePuncs(SecureByteBuffer &serialized);
-        static Key deserializeKey(SecureByteBuffer &serialized, size_t offset);
-        void copy(std::vector<unsigned char> &buffer, const unsigned char *toCopy, size_t size) const;
-        static long getLong(SecureByteBuffer b, size_t offset);
+        /**
+         * Converts a key in the record format into a NaiveKeyTable.
+         * @param serialized the key
+         * @return the table
+         * @throws DeserializationError if the records are truncated, an index is out of range or the number of tags is
+         * not a power of two
+         */
+        static SecureByteBuffer deserializeRecords(SecureByteBuffer &serialized);
+
+    private:
+        static size_t getSize(const SecureByteBuffer &b, size_t offset);
 };
 #endif//PUNCTURABLE_KEY_WRAPPING_CPP_NAIVE_PKW_H
\ No newline at end of file
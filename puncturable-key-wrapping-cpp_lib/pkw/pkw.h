@@ -22,6 +22,8 @@
 #define PUNCTURABLE_KEY_WRAPPING_CPP_ABSTRACT_PKW_H
 #include "pkw/helpers/password_encrypt.h"
 #include "secure_byte_buffer.h"
+#include <memory>
+#include <string>
 #include <vector>
 
 /**
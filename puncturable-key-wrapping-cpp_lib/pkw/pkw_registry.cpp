@@ -0,0 +1,402 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pkw_registry.h"
+#include "exceptions.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "pprf/ggm_pprf_key.h"
+#include <cerrno>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/osrng.h>
+#include <fcntl.h>
+#include <iterator>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* spill files are nonce || ciphertext || MAC, the tenant id being authenticated */
+static const size_t SPILL_NONCE_LEN = 12;
+static const size_t SPILL_MAC_LEN = 16;
+
+static bool writeAll(int fd, const unsigned char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t written = ::write(fd, buf, n);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        buf += written;
+        n -= written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, unsigned char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t got = ::read(fd, buf, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        buf += got;
+        n -= got;
+    }
+    return true;
+}
+
+static std::string hex(const unsigned char *p, size_t n) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string s;
+    for (size_t i = 0; i < n; ++i) {
+        s += DIGITS[p[i] >> 4];
+        s += DIGITS[p[i] & 15];
+    }
+    return s;
+}
+
+PKWRegistry::PKWRegistry(PKWRegistryOptions options) : options(std::move(options)) {
+    if (this->options.memoryBudget == 0) {
+        throw std::invalid_argument("memory budget required");
+    }
+    CryptoPP::OS_GenerateRandomBlock(true, spillKey.data(), spillKey.size());
+    unsigned char id[8];
+    CryptoPP::OS_GenerateRandomBlock(false, id, sizeof(id));
+    registryId = hex(id, sizeof(id));
+}
+
+PKWRegistry::~PKWRegistry() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &e: entries) {
+        if (e.second->spilled) {
+            ::unlink(spillPath(*e.second).c_str());
+        }
+        if (e.second->pkw) {
+            e.second->pkw->secureTeardown();
+        }
+    }
+}
+
+PKWRegistry::Entry &PKWRegistry::newEntry(const std::string &tenant) {
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->tenant = tenant;
+    entry->fileId = nextFileId++;
+    Entry &ref = *entry;
+    entries.emplace(tenant, std::move(entry));
+    return ref;
+}
+
+void PKWRegistry::create(const std::string &tenant, int tagLen, int keyLen) {
+    std::unique_ptr<PPRF_AEAD_PKW> pkw(new PPRF_AEAD_PKW(PPRFKey::generate(keyLen, tagLen).serialize()));
+    const size_t bytes = pkw->memoryUsage().total();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.count(tenant) != 0) {
+        throw std::invalid_argument("tenant exists");
+    }
+    admit(&newEntry(tenant), std::move(pkw), bytes);
+}
+
+void PKWRegistry::add(const std::string &tenant, const SecureByteBuffer &serializedKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.count(tenant) != 0) {
+        throw std::invalid_argument("tenant exists");
+    }
+    Entry &entry = newEntry(tenant);
+    try {
+        writeSpill(entry, serializedKey);
+    } catch (ExportException &) {
+        entries.erase(tenant);
+        throw;
+    }
+    entry.spilled = true;
+}
+
+ciphertext PKWRegistry::wrap(const std::string &tenant, Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) {
+    return with(tenant, [&](PPRF_AEAD_PKW &pkw) { return pkw.wrap(tag, header, key); });
+}
+
+std::vector<unsigned char> PKWRegistry::unwrap(const std::string &tenant, Tag tag, std::vector<unsigned char> &header, ciphertext &c) {
+    return with(tenant, [&](PPRF_AEAD_PKW &pkw) { return pkw.unwrap(tag, header, c); });
+}
+
+void PKWRegistry::punc(const std::string &tenant, Tag tag) {
+    with(tenant, [&](PPRF_AEAD_PKW &pkw) { pkw.punc(tag); });
+}
+
+PKWRegistry::Lease::Lease(PKWRegistry &registry, const std::string &tenant) : entry(registry.pin(tenant)), registry(registry) {
+    entry->use.lock();
+    if (!entry->pkw) {
+        try {
+            registry.load(entry);
+        } catch (...) {
+            entry->use.unlock();
+            registry.unpin(entry);
+            throw;
+        }
+    }
+}
+
+/**
+ * Accounts for punctures during the lease while the entry is still locked, so that concurrent leases update the
+ * accounting in order; the pin is dropped after the entry is unlocked, as the entry may be removed once it has no pins.
+ */
+PKWRegistry::Lease::~Lease() {
+    const long puncs = entry->pkw->getNumPuncs();
+    if (puncs != entry->puncs) {
+        const size_t bytes = entry->pkw->memoryUsage().total();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.resident = registry.resident - entry->bytes + bytes;
+        entry->bytes = bytes;
+        entry->puncs = puncs;
+    }
+    entry->use.unlock();
+    registry.unpin(entry);
+}
+
+PKWRegistry::Entry *PKWRegistry::pin(const std::string &tenant) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(tenant);
+    Entry *entry;
+    if (it != entries.end()) {
+        entry = it->second.get();
+    } else if (options.loader) {
+        entry = &newEntry(tenant);
+    } else {
+        throw std::out_of_range("unknown tenant");
+    }
+    if (entry->pkw) {
+        ++counters.hits;
+        lru.splice(lru.begin(), lru, entry->lru);
+    }
+    ++entry->pins;
+    return entry;
+}
+
+void PKWRegistry::unpin(Entry *entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    --entry->pins;
+    if (entry->pins == 0 && !entry->pkw && !entry->spilled) {
+        /* the loader did not know the tenant */
+        entries.erase(entry->tenant);
+        return;
+    }
+    evictOverBudget();
+}
+
+/**
+ * Reads the key from the spill file or the loader and deserializes it, without holding the registry's lock; the
+ * entry is locked and pinned.
+ */
+void PKWRegistry::load(Entry *entry) {
+    SecureByteBuffer serialized;
+    if (entry->spilled) {
+        serialized = readSpill(*entry);
+    } else {
+        serialized = options.loader(entry->tenant);
+        if (serialized.size() == 0) {
+            throw std::out_of_range("unknown tenant");
+        }
+        if (!options.loaderPassword.empty()) {
+            serialized = decryptExport(serialized, options.loaderPassword);
+        }
+    }
+    std::unique_ptr<PPRF_AEAD_PKW> pkw;
+    try {
+        pkw.reset(new PPRF_AEAD_PKW(serialized));
+    } catch (std::exception &) {
+        throw ImportException();
+    }
+    const size_t bytes = pkw->memoryUsage().total();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entry->spilled) {
+        /* the spill file holds the key as it was before the punctures to come */
+        ::unlink(spillPath(*entry).c_str());
+        entry->spilled = false;
+    }
+    ++counters.loads;
+    admit(entry, std::move(pkw), bytes);
+}
+
+void PKWRegistry::admit(Entry *entry, std::unique_ptr<PPRF_AEAD_PKW> pkw, size_t bytes) {
+    entry->puncs = pkw->getNumPuncs();
+    entry->pkw = std::move(pkw);
+    entry->bytes = bytes;
+    lru.push_front(entry);
+    entry->lru = lru.begin();
+    resident += bytes;
+    evictOverBudget();
+}
+
+/**
+ * Evicts unpinned entries from the least recently used end until the resident keys fit the budget. If a spill file
+ * cannot be written, the entry stays resident and eviction is retried on the next access.
+ */
+void PKWRegistry::evictOverBudget() {
+    auto it = lru.end();
+    while (resident > options.memoryBudget && it != lru.begin()) {
+        --it;
+        Entry *entry = *it;
+        if (entry->pins > 0) {
+            continue;
+        }
+        auto next = std::next(it);
+        try {
+            evict(entry);
+        } catch (std::exception &) {
+            return;
+        }
+        it = next;
+    }
+}
+
+void PKWRegistry::evict(Entry *entry) {
+    {
+        SecureByteBuffer serialized = entry->pkw->serializeKey();
+        writeSpill(*entry, serialized);
+    }
+    entry->spilled = true;
+    entry->pkw->secureTeardown();
+    entry->pkw.reset();
+    lru.erase(entry->lru);
+    resident -= entry->bytes;
+    entry->bytes = 0;
+    ++counters.evictions;
+}
+
+void PKWRegistry::remove(const std::string &tenant) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(tenant);
+    if (it == entries.end()) {
+        return;
+    }
+    Entry *entry = it->second.get();
+    if (entry->pins > 0) {
+        throw std::logic_error("tenant in use");
+    }
+    if (entry->pkw) {
+        entry->pkw->secureTeardown();
+        lru.erase(entry->lru);
+        resident -= entry->bytes;
+    }
+    if (entry->spilled) {
+        ::unlink(spillPath(*entry).c_str());
+    }
+    entries.erase(it);
+}
+
+std::string PKWRegistry::spillPath(const Entry &entry) const {
+    return options.spillDirectory + "/pkw-" + registryId + "-" + std::to_string(entry.fileId) + ".spill";
+}
+
+void PKWRegistry::writeSpill(const Entry &entry, const SecureByteBuffer &serialized) const {
+    std::vector<unsigned char> file(SPILL_NONCE_LEN + serialized.size() + SPILL_MAC_LEN);
+    unsigned char *nonce = file.data();
+    unsigned char *c = nonce + SPILL_NONCE_LEN;
+    try {
+        CryptoPP::OS_GenerateRandomBlock(false, nonce, SPILL_NONCE_LEN);
+        CryptoPP::GCM<CryptoPP::AES>::Encryption e;
+        e.SetKeyWithIV(spillKey.data(), spillKey.size(), nonce, SPILL_NONCE_LEN);
+        e.EncryptAndAuthenticate(c, c + serialized.size(), SPILL_MAC_LEN, nonce, (int) SPILL_NONCE_LEN,
+                                 reinterpret_cast<const unsigned char *>(entry.tenant.data()), entry.tenant.size(),
+                                 serialized.data(), serialized.size());
+    } catch (CryptoPP::Exception &) {
+        throw ExportException();
+    }
+    const std::string path = spillPath(entry);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool ok = fd >= 0 && writeAll(fd, file.data(), file.size());
+    if (fd >= 0) {
+        ok = ::close(fd) == 0 && ok;
+    }
+    if (!ok) {
+        ::unlink(path.c_str());
+        throw ExportException();
+    }
+}
+
+SecureByteBuffer PKWRegistry::readSpill(const Entry &entry) const {
+    int fd = ::open(spillPath(entry).c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < SPILL_NONCE_LEN + SPILL_MAC_LEN) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw ImportException();
+    }
+    std::vector<unsigned char> file(st.st_size);
+    bool ok = readAll(fd, file.data(), file.size());
+    ::close(fd);
+    if (!ok) {
+        throw ImportException();
+    }
+    const unsigned char *nonce = file.data();
+    const size_t n = file.size() - SPILL_NONCE_LEN - SPILL_MAC_LEN;
+    const unsigned char *c = nonce + SPILL_NONCE_LEN;
+    SecureByteBuffer serialized(n);
+    bool verified = false;
+    try {
+        CryptoPP::GCM<CryptoPP::AES>::Decryption d;
+        d.SetKeyWithIV(spillKey.data(), spillKey.size(), nonce, SPILL_NONCE_LEN);
+        verified = d.DecryptAndVerify(serialized.data(), c + n, SPILL_MAC_LEN, nonce, (int) SPILL_NONCE_LEN,
+                                      reinterpret_cast<const unsigned char *>(entry.tenant.data()), entry.tenant.size(),
+                                      c, n);
+    } catch (CryptoPP::Exception &) {
+        verified = false;
+    }
+    if (!verified) {
+        throw ImportException();
+    }
+    return serialized;
+}
+
+bool PKWRegistry::contains(const std::string &tenant) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(tenant) != 0;
+}
+
+bool PKWRegistry::isResident(const std::string &tenant) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(tenant);
+    return it != entries.end() && it->second->pkw != nullptr;
+}
+
+size_t PKWRegistry::numTenants() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t PKWRegistry::numResident() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size();
+}
+
+size_t PKWRegistry::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return resident;
+}
+
+PKWRegistryStats PKWRegistry::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
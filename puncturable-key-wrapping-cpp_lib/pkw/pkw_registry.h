@@ -0,0 +1,201 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PKW_REGISTRY_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PKW_REGISTRY_H
+
+#include "pprf_aead_pkw.h"
+#include "secure_array.h"
+#include "secure_byte_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Configuration of a PKWRegistry.
+ */
+struct PKWRegistryOptions {
+        /* bound on the memory of the resident keys, as reported by PPRF_AEAD_PKW::memoryUsage */
+        size_t memoryBudget = size_t(64) << 20;
+        /* existing directory receiving the keys of evicted tenants */
+        std::string spillDirectory = ".";
+        /* fetches the serialized key of a tenant the registry does not know yet; returns an empty buffer if there is
+         * no such tenant. Optional. */
+        std::function<SecureByteBuffer(const std::string &tenant)> loader;
+        /* if not empty, the loader returns exports encrypted with this passphrase (see serializeAndEncryptKey) */
+        std::string loaderPassword;
+};
+
+struct PKWRegistryStats {
+        /* accesses to resident keys */
+        size_t hits = 0;
+        /* keys deserialized from a spill file, the loader or add */
+        size_t loads = 0;
+        size_t evictions = 0;
+};
+
+/**
+ * Maps tenant ids to PPRF_AEAD_PKW instances and keeps the memory of the resident ones within a budget. Keys are
+ * deserialized on first use; once the resident keys exceed the budget, the least recently used ones that are not in
+ * use are evicted: serialized, encrypted to a spill file and zeroized in memory. A later access loads them back and
+ * deletes the spill file, so that punctures of a resident key cannot be undone from an older copy.
+ * <br>
+ * Spill files are encrypted with AES-GCM under a random key which exists only in the memory of the registry, and are
+ * deleted with it, so they do not persist keys beyond the registry's lifetime; use serializeKey through with() for that.
+ * <br>
+ * Thread-safe. Operations on one tenant are serialized, operations on different tenants run concurrently, and so may
+ * the loader. Evictions run under the registry's lock.
+ */
+class PKWRegistry {
+    public:
+        /**
+         * @throws std::invalid_argument if the memory budget is 0
+         */
+        explicit PKWRegistry(PKWRegistryOptions options);
+
+        /**
+         * Zeroizes the resident keys and deletes the spill files.
+         */
+        ~PKWRegistry();
+
+        PKWRegistry(const PKWRegistry &) = delete;
+        PKWRegistry &operator=(const PKWRegistry &) = delete;
+
+        /**
+         * Adds a tenant with a fresh key, which is resident.
+         * @throws std::invalid_argument if the tenant exists
+         */
+        void create(const std::string &tenant, int tagLen, int keyLen);
+
+        /**
+         * Adds a tenant with a serialized key, which is spilled right away and only deserialized on first use.
+         * @throws std::invalid_argument if the tenant exists
+         * @throws ExportException if the spill file cannot be written
+         */
+        void add(const std::string &tenant, const SecureByteBuffer &serializedKey);
+
+        /**
+         * Runs f on the key of tenant, loading it first if it is not resident. The key stays resident during the call
+         * and must not be used after it.
+         * @param tenant the tenant
+         * @param f called with the PPRF_AEAD_PKW of the tenant
+         * @return the result of f
+         * @throws std::out_of_range if the tenant is unknown to the registry and the loader
+         * @throws ImportException if the key cannot be loaded
+         */
+        template<class F>
+        auto with(const std::string &tenant, F &&f) -> decltype(f(std::declval<PPRF_AEAD_PKW &>())) {
+            Lease lease(*this, tenant);
+            return f(*lease.entry->pkw);
+        }
+
+        ciphertext wrap(const std::string &tenant, Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key);
+
+        std::vector<unsigned char> unwrap(const std::string &tenant, Tag tag, std::vector<unsigned char> &header, ciphertext &c);
+
+        void punc(const std::string &tenant, Tag tag);
+
+        /**
+         * Drops a tenant: zeroizes its key if it is resident and deletes its spill file.
+         * @throws std::logic_error if the tenant is in use
+         */
+        void remove(const std::string &tenant);
+
+        bool contains(const std::string &tenant) const;
+
+        bool isResident(const std::string &tenant) const;
+
+        size_t numTenants() const;
+
+        size_t numResident() const;
+
+        /**
+         * Returns the memory of the resident keys. It exceeds the budget only while keys in use do not fit.
+         */
+        size_t residentBytes() const;
+
+        PKWRegistryStats stats() const;
+
+    private:
+        struct Entry {
+                std::string tenant;
+                uint64_t fileId = 0;
+                /* null unless resident */
+                std::unique_ptr<PPRF_AEAD_PKW> pkw;
+                bool spilled = false;
+                /* serializes the operations on the key */
+                std::mutex use;
+                /* number of callers holding or waiting for use; entries with pins are not evicted or removed */
+                size_t pins = 0;
+                size_t bytes = 0;
+                long puncs = 0;
+                std::list<Entry *>::iterator lru;
+        };
+
+        /**
+         * Pins an entry and holds its lock for the duration of a with() call.
+         */
+        class Lease {
+            public:
+                Lease(PKWRegistry &registry, const std::string &tenant);
+                ~Lease();
+                Lease(const Lease &) = delete;
+                Lease &operator=(const Lease &) = delete;
+
+                Entry *entry;
+
+            private:
+                PKWRegistry &registry;
+        };
+
+        static const size_t SPILL_KEY_LEN = 32;
+
+        PKWRegistryOptions options;
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+        /* resident entries, most recently used first */
+        std::list<Entry *> lru;
+        size_t resident = 0;
+        uint64_t nextFileId = 0;
+        PKWRegistryStats counters;
+        /* encrypts the spill files; spill file names carry the registry's id so that registries can share a directory */
+        SecureArray<SPILL_KEY_LEN> spillKey;
+        std::string registryId;
+
+        Entry *pin(const std::string &tenant);
+        void unpin(Entry *entry);
+        void load(Entry *entry);
+        void admit(Entry *entry, std::unique_ptr<PPRF_AEAD_PKW> pkw, size_t bytes);
+        void evictOverBudget();
+        void evict(Entry *entry);
+        Entry &newEntry(const std::string &tenant);
+        std::string spillPath(const Entry &entry) const;
+        void writeSpill(const Entry &entry, const SecureByteBuffer &serialized) const;
+        SecureByteBuffer readSpill(const Entry &entry) const;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PKW_REGISTRY_H
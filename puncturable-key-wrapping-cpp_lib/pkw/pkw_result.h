@@ -0,0 +1,107 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PKW_RESULT_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PKW_RESULT_H
+
+#include "exceptions.h"
+#include <utility>
+
+/**
+ * Errors of the non-throwing PKW operations.
+ */
+enum class PKWError {
+    None,
+    /* the tag is outside the tag space */
+    IllegalTag,
+    /* the key was punctured on the tag */
+    Punctured,
+    /* the ciphertext or header failed authentication */
+    Authentication,
+    /* the key could not be wrapped */
+    Wrapping
+};
+
+/**
+ * Throws the exception the throwing PKW operations use for error.
+ * @param error an error other than PKWError::None
+ */
+[[noreturn]] inline void throwPKWError(PKWError error) {
+    switch (error) {
+        case PKWError::Authentication:
+            throw UnwrappingException();
+        case PKWError::Wrapping:
+            throw WrappingException();
+        default:
+            throw IllegalTagException();
+    }
+}
+
+/**
+ * Either a value or the error that prevented computing it, in the style of std::expected.
+ * @tparam T the type of the value
+ */
+template<class T>
+class PKWResult {
+    public:
+        PKWResult(T value) : err(PKWError::None), val(std::move(value)) {}
+        PKWResult(PKWError error) : err(error), val() {}
+
+        bool ok() const { return err == PKWError::None; }
+        explicit operator bool() const { return ok(); }
+        PKWError error() const { return err; }
+
+        /**
+         * Returns the value.
+         * @throws the exception of the error (see throwPKWError) if there is no value
+         */
+        T &value() {
+            if (!ok()) {
+                throwPKWError(err);
+            }
+            return val;
+        }
+        const T &value() const {
+            if (!ok()) {
+                throwPKWError(err);
+            }
+            return val;
+        }
+
+    private:
+        PKWError err;
+        T val;
+};
+
+template<>
+class PKWResult<void> {
+    public:
+        PKWResult() : err(PKWError::None) {}
+        PKWResult(PKWError error) : err(error) {}
+
+        bool ok() const { return err == PKWError::None; }
+        explicit operator bool() const { return ok(); }
+        PKWError error() const { return err; }
+
+    private:
+        PKWError err;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PKW_RESULT_H
@@ -0,0 +1,442 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "pprf_aead_pkw.h"
+#include "metrics.h"
+#include "pkw/exceptions.h"
+#include "pprf/pprf_exceptions.h"
+#include "secure_array.h"
+#include "secure_memzero.h"
+#include "thread_crypto.h"
+#include "tracing.h"
+#include <array>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/hkdf.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/sha.h>
+#include <limits>
+
+const size_t TAG_SIZE = 16;
+using std::vector;
+/* the fixed all-zero IV of the construction */
+static const std::array<unsigned char, 16> IV{};
+/* the largest AES key */
+static const size_t MAX_WRAPPING_KEY = 32;
+
+/* bundles: nonce length of an entry, and the prefix of the HKDF info deriving an entry's subkey from the wrapping key */
+static const size_t BUNDLE_NONCE_LEN = 12;
+static const unsigned char BUNDLE_INFO[] = {'b', 'u', 'n', 'd', 'l', 'e'};
+
+static PKWError tagError(PPRFStatus status) {
+    return status == PPRFStatus::Punctured ? PKWError::Punctured : PKWError::IllegalTag;
+}
+
+ciphertext PPRF_AEAD_PKW::wrap(Tag tag, vector<unsigned char> &header, vector<unsigned char> &key) {
+    ciphertext cipher;
+    wrap(tag, header, key, cipher);
+    return cipher;
+}
+
+void PPRF_AEAD_PKW::wrap(Tag tag, const vector<unsigned char> &header, const vector<unsigned char> &key, ciphertext &out) {
+    PKWError error = tryWrap(tag, header, key, out);
+    if (error != PKWError::None) {
+        throwPKWError(error);
+    }
+}
+
+PKWResult<ciphertext> PPRF_AEAD_PKW::tryWrap(Tag tag, const vector<unsigned char> &header, const vector<unsigned char> &key) {
+    ciphertext cipher;
+    PKWError error = tryWrap(tag, header, key, cipher);
+    if (error != PKWError::None) {
+        return error;
+    }
+    return cipher;
+}
+
+/**
+ * Computes ciphertext || MAC, as the AuthenticatedEncryptionFilter did in https://cryptopp.com/wiki/GCM_Mode#AEAD,
+ * but without a filter pipeline.
+ */
+PKWError PPRF_AEAD_PKW::tryWrap(Tag tag, const vector<unsigned char> &header, const vector<unsigned char> &key, ciphertext &out) {
+    MetricsTimer timer(MetricOp::Wrap);
+    PKW_TRACE_SPAN(TraceOp::Wrap, pprf.tagLen(), pprf.getNumNodes());
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (keyBytes > wrappingKey.size()) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        return PKWError::Wrapping;
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        return tagError(status);
+    }
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        ThreadLocalCrypto<CryptoPP::GCM<CryptoPP::AES>::Encryption> e;
+        e->SetKeyWithIV(wrappingKey.data(), keyBytes, IV.data(), IV.size());
+        out.resize(key.size() + TAG_SIZE);
+        e->EncryptAndAuthenticate(out.data(), out.data() + key.size(), TAG_SIZE, IV.data(), (int) IV.size(),
+                                  header.data(), header.size(), key.data(), key.size());
+    } catch (CryptoPP::Exception &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        return PKWError::Wrapping;
+    }
+    return PKWError::None;
+}
+
+vector<unsigned char> PPRF_AEAD_PKW::unwrap(Tag tag, vector<unsigned char> &header, ciphertext &c) {
+    vector<unsigned char> key;
+    unwrap(tag, header, c, key);
+    return key;
+}
+
+void PPRF_AEAD_PKW::unwrap(Tag tag, const vector<unsigned char> &header, const ciphertext &c, vector<unsigned char> &out) {
+    PKWError error = tryUnwrap(tag, header, c, out);
+    if (error != PKWError::None) {
+        throwPKWError(error);
+    }
+}
+
+PKWResult<vector<unsigned char>> PPRF_AEAD_PKW::tryUnwrap(Tag tag, const vector<unsigned char> &header, const ciphertext &c) {
+    vector<unsigned char> key;
+    PKWError error = tryUnwrap(tag, header, c, key);
+    if (error != PKWError::None) {
+        return error;
+    }
+    return key;
+}
+
+PKWError PPRF_AEAD_PKW::tryUnwrap(Tag tag, const vector<unsigned char> &header, const ciphertext &c, vector<unsigned char> &out) {
+    return tryUnwrap(tag, header.data(), header.size(), c.data(), c.size(), out);
+}
+
+PKWError PPRF_AEAD_PKW::tryUnwrap(Tag tag, const unsigned char *header, size_t headerLen, const unsigned char *c, size_t cLen,
+                                 vector<unsigned char> &out) {
+    MetricsTimer timer(MetricOp::Unwrap);
+    PKW_TRACE_SPAN(TraceOp::Unwrap, pprf.tagLen(), pprf.getNumNodes());
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (cLen < TAG_SIZE || keyBytes > wrappingKey.size()) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        return PKWError::Authentication;
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsIllegalTag);
+        return tagError(status);
+    }
+    bool verified = false;
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        ThreadLocalCrypto<CryptoPP::GCM<CryptoPP::AES>::Decryption> d;
+        d->SetKeyWithIV(wrappingKey.data(), keyBytes, IV.data(), IV.size());
+        const size_t n = cLen - TAG_SIZE;
+        out.resize(n);
+        verified = d->DecryptAndVerify(out.data(), c + n, TAG_SIZE, IV.data(), (int) IV.size(),
+                                       header, headerLen, c, n);
+    } catch (CryptoPP::Exception &e) {
+        verified = false;
+    }
+    if (!verified) {
+        secure_memzero(out.data(), out.size());
+        out.clear();
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        return PKWError::Authentication;
+    }
+    return PKWError::None;
+}
+
+static void putU32(unsigned char *p, size_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (unsigned char) (v >> (8 * i));
+    }
+}
+
+static size_t getU32(const unsigned char *p) {
+    size_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= size_t(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+/**
+ * Derives the subkey of entry index from the wrapping key; the entry's AEAD authenticates the header, the number of
+ * entries and the index, so entries cannot be moved within or between bundles.
+ */
+static void bundleEntryKey(const unsigned char *wrappingKey, size_t keyBytes, size_t index, unsigned char *subkey) {
+    unsigned char info[sizeof(BUNDLE_INFO) + 4];
+    std::copy(BUNDLE_INFO, BUNDLE_INFO + sizeof(BUNDLE_INFO), info);
+    putU32(info + sizeof(BUNDLE_INFO), index);
+    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
+    hkdf.DeriveKey(subkey, keyBytes, wrappingKey, keyBytes, nullptr, 0, info, sizeof(info));
+}
+
+static vector<unsigned char> bundleEntryAAD(const vector<unsigned char> &header, size_t count, size_t index) {
+    vector<unsigned char> aad(header);
+    aad.resize(header.size() + 8);
+    putU32(aad.data() + header.size(), count);
+    putU32(aad.data() + header.size() + 4, index);
+    return aad;
+}
+
+/**
+ * Layout: count || end offset of each entry, relative to the first entry || entries, each nonce || ciphertext || MAC.
+ * All integers are 32 bit little endian.
+ */
+ciphertext PPRF_AEAD_PKW::wrapBundle(Tag tag, const vector<unsigned char> &header, const vector<vector<unsigned char>> &keys) {
+    MetricsTimer timer(MetricOp::Wrap);
+    PKW_TRACE_SPAN(TraceOp::Wrap, pprf.tagLen(), pprf.getNumNodes());
+    const size_t count = keys.size();
+    const size_t tableLen = 4 + 4 * count;
+    size_t total = tableLen;
+    for (const auto &key: keys) {
+        total += BUNDLE_NONCE_LEN + key.size() + TAG_SIZE;
+    }
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (keyBytes > wrappingKey.size() || total > std::numeric_limits<uint32_t>::max()) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throw WrappingException();
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throwPKWError(tagError(status));
+    }
+    ciphertext bundle(total);
+    putU32(bundle.data(), count);
+    size_t offset = tableLen;
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        SecureArray<MAX_WRAPPING_KEY> subkey;
+        for (size_t i = 0; i < count; ++i) {
+            const vector<unsigned char> &key = keys[i];
+            unsigned char *nonce = bundle.data() + offset;
+            CryptoPP::OS_GenerateRandomBlock(false, nonce, BUNDLE_NONCE_LEN);
+            bundleEntryKey(wrappingKey.data(), keyBytes, i, subkey.data());
+            vector<unsigned char> aad = bundleEntryAAD(header, count, i);
+            CryptoPP::GCM<CryptoPP::AES>::Encryption e;
+            e.SetKeyWithIV(subkey.data(), keyBytes, nonce, BUNDLE_NONCE_LEN);
+            unsigned char *c = nonce + BUNDLE_NONCE_LEN;
+            e.EncryptAndAuthenticate(c, c + key.size(), TAG_SIZE, nonce, (int) BUNDLE_NONCE_LEN, aad.data(), aad.size(),
+                                     key.data(), key.size());
+            offset += BUNDLE_NONCE_LEN + key.size() + TAG_SIZE;
+            putU32(bundle.data() + 4 + 4 * i, offset - tableLen);
+        }
+    } catch (CryptoPP::Exception &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throw WrappingException();
+    }
+    return bundle;
+}
+
+vector<unsigned char> PPRF_AEAD_PKW::unwrapBundle(Tag tag, const vector<unsigned char> &header, const ciphertext &bundle, size_t index) {
+    MetricsTimer timer(MetricOp::Unwrap);
+    PKW_TRACE_SPAN(TraceOp::Unwrap, pprf.tagLen(), pprf.getNumNodes());
+    const size_t count = bundle.size() < 4 ? 0 : getU32(bundle.data());
+    const size_t tableLen = 4 + 4 * count;
+    size_t begin = 0;
+    size_t end = 0;
+    if (index < count && tableLen <= bundle.size()) {
+        begin = index == 0 ? 0 : getU32(bundle.data() + 4 * index);
+        end = getU32(bundle.data() + 4 + 4 * index);
+    }
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (end < begin + BUNDLE_NONCE_LEN + TAG_SIZE || end > bundle.size() - tableLen || keyBytes > wrappingKey.size()) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throw UnwrappingException();
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsIllegalTag);
+        throwPKWError(tagError(status));
+    }
+    const unsigned char *nonce = bundle.data() + tableLen + begin;
+    const unsigned char *c = nonce + BUNDLE_NONCE_LEN;
+    const size_t n = end - begin - BUNDLE_NONCE_LEN - TAG_SIZE;
+    vector<unsigned char> key(n);
+    bool verified = false;
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        SecureArray<MAX_WRAPPING_KEY> subkey;
+        bundleEntryKey(wrappingKey.data(), keyBytes, index, subkey.data());
+        vector<unsigned char> aad = bundleEntryAAD(header, count, index);
+        CryptoPP::GCM<CryptoPP::AES>::Decryption d;
+        d.SetKeyWithIV(subkey.data(), keyBytes, nonce, BUNDLE_NONCE_LEN);
+        verified = d.DecryptAndVerify(key.data(), c + n, TAG_SIZE, nonce, (int) BUNDLE_NONCE_LEN, aad.data(), aad.size(),
+                                      c, n);
+    } catch (CryptoPP::Exception &e) {
+        verified = false;
+    }
+    if (!verified) {
+        secure_memzero(key.data(), key.size());
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throw UnwrappingException();
+    }
+    return key;
+}
+
+void PPRF_AEAD_PKW::wrapStream(Tag tag, const vector<unsigned char> &header, ByteSource &in, ByteSink &out, size_t chunkSize) {
+    MetricsTimer timer(MetricOp::Wrap);
+    PKW_TRACE_SPAN(TraceOp::Wrap, pprf.tagLen(), pprf.getNumNodes());
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (keyBytes > wrappingKey.size()) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throw WrappingException();
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throwPKWError(tagError(status));
+    }
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        streamEncrypt(wrappingKey.data(), keyBytes, header, in, out, chunkSize);
+    } catch (WrappingException &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedWraps);
+        throw;
+    }
+}
+
+StreamDecryptor PPRF_AEAD_PKW::openStream(Tag tag, const vector<unsigned char> &header, ByteSource &in) {
+    SecureArray<MAX_WRAPPING_KEY> wrappingKey;
+    const size_t keyBytes = pprf.keyLen() / 8;
+    if (keyBytes > wrappingKey.size()) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throw UnwrappingException();
+    }
+    PPRFStatus status = pprf.tryEval(tag, wrappingKey.data());
+    if (status != PPRFStatus::Ok) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsIllegalTag);
+        throwPKWError(tagError(status));
+    }
+    try {
+        return StreamDecryptor(wrappingKey.data(), keyBytes, header, in);
+    } catch (UnwrappingException &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throw;
+    }
+}
+
+void PPRF_AEAD_PKW::unwrapStream(Tag tag, const vector<unsigned char> &header, ByteSource &in, ByteSink &out) {
+    MetricsTimer timer(MetricOp::Unwrap);
+    PKW_TRACE_SPAN(TraceOp::Unwrap, pprf.tagLen(), pprf.getNumNodes());
+    StreamDecryptor decryptor = openStream(tag, header, in);
+    try {
+        PKW_TRACE_SPAN(TraceOp::AEAD, 0, 0);
+        decryptor.decryptTo(out);
+    } catch (UnwrappingException &e) {
+        PKWMetrics::instance().count(MetricCounter::FailedUnwrapsAuthentication);
+        throw;
+    }
+}
+
+void PPRF_AEAD_PKW::punc(Tag tag) {
+    try {
+        pprf.punc(tag);
+    } catch (TagException &e) {
+        throw IllegalTagException();
+    }
+}
+
+PKWResult<void> PPRF_AEAD_PKW::tryPunc(Tag tag) {
+    if ((tag >> pprf.tagLen()).any()) {
+        return PKWError::IllegalTag;
+    }
+    pprf.punc(tag);
+    return {};
+}
+
+bool PPRF_AEAD_PKW::isPunctured(Tag tag) {
+    try {
+        return pprf.isPunctured(tag);
+    } catch (TagException &e) {
+        throw IllegalTagException();
+    }
+}
+
+void PPRF_AEAD_PKW::puncPrefix(Tag tag, int prefixLen) {
+    try {
+        pprf.puncPrefix(tag, prefixLen);
+    } catch (TagException &e) {
+        throw IllegalTagException();
+    }
+}
+SecureByteBuffer PPRF_AEAD_PKW::delegate(Tag tag, int prefixLen) const {
+    try {
+        return pprf.delegate(tag, prefixLen).serialize();
+    } catch (TagException &e) {
+        throw IllegalTagException();
+    }
+}
+
+void PPRF_AEAD_PKW::merge(Tag tag, int prefixLen, SecureByteBuffer &delegated) {
+    PPRFKey key = PPRFKey::fromSerialized(delegated);
+    try {
+        pprf.merge(tag, prefixLen, key);
+    } catch (TagException &e) {
+        throw IllegalTagException();
+    }
+}
+
+long PPRF_AEAD_PKW::getNumPuncs() {
+    return pprf.getNumPuncs();
+}
+size_t PPRF_AEAD_PKW::getNumNodes() {
+    return pprf.getNumNodes();
+}
+/* Not needed because of use of SecureByteBuffer */
+void PPRF_AEAD_PKW::secureTeardown() {
+}
+MemoryUsage PPRF_AEAD_PKW::memoryUsage() const {
+    MemoryUsage usage = pprf.memoryUsage();
+    usage.containerBytes += sizeof(*this) - sizeof(pprf);
+    return usage;
+}
+MemoryProjection PPRF_AEAD_PKW::projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed) const {
+    MemoryProjection projection = pprf.projectMemoryUsage(k, order, seed);
+    projection.usage.containerBytes += sizeof(*this) - sizeof(pprf);
+    return projection;
+}
+GGM_PPRFSnapshot PPRF_AEAD_PKW::snapshot() const {
+    return pprf.snapshot();
+}
+SecureByteBuffer PPRF_AEAD_PKW::serializeKey() {
+    return pprf.serializeKey();
+}
+SecureByteBuffer PPRF_AEAD_PKW::serializeAndEncryptKey(const std::string &password) {
+    auto serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
+PPRF_AEAD_PKW::PPRF_AEAD_PKW(int tagLen, int keyLen) : pprf(PPRFKey(keyLen, tagLen)) {}
+
+PPRF_AEAD_PKW::PPRF_AEAD_PKW(SecureByteBuffer serializedKey) : pprf(PPRFKey::fromSerialized(serializedKey)) {}
+
+PPRF_AEAD_PKW::PPRF_AEAD_PKW(SecureByteBuffer serializedKey, int frontierDepth)
+    : pprf(PPRFKey::fromSerialized(serializedKey), frontierDepth) {}
+
+std::shared_ptr<AbstractPKW<Tag, ciphertext>> PPRF_AEAD_PKW_Factory::fromSerialized(SecureByteBuffer &serialized) {
+    return std::shared_ptr<AbstractPKW<Tag, ciphertext>>(new PPRF_AEAD_PKW(serialized));
+}
@@ -0,0 +1,256 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_PPRF_AEAD_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_PPRF_AEAD_PKW_H
+
+
+#include "pkw.h"
+#include "pkw_result.h"
+#include "static_pkw.h"
+#include "stream_aead.h"
+#include "pprf/ggm_pprf.h"
+#include <vector>
+
+using ciphertext = std::vector<unsigned char>;
+
+/**
+ * Puncturable Key Wrapping instantiated using composition of a Puncturable Pseudo-Random Function (PPRF) and an AEAD scheme
+ * <br>
+ * <div class="csl-entry">Backendal, M., Günther, F., &#38; Paterson, K. G. (2022). Puncturable Key Wrapping and Its Applications. <i>Cryptology EPrint Archive</i>.</div>
+ */
+class PPRF_AEAD_PKW final : public StaticPKW<PPRF_AEAD_PKW, Tag, ciphertext> {
+    public:
+        /**
+         * Constructs a fresh instance of the PKW.
+         * @param tagLen the size of the tag space in number of bits.
+         * @param keyLen the size of the key space in number of bits.
+         */
+        PPRF_AEAD_PKW(int tagLen, int keyLen);
+
+        /**
+         * Reconstructs a previous instance using the serialized key as input
+         * @param serializedKey the serialized key
+         */
+        explicit PPRF_AEAD_PKW(SecureByteBuffer serializedKey);
+
+        /**
+         * Reconstructs a previous instance with a pre-expanded frontier, see GGM_PPRF(PPRFKey, int).
+         * @param serializedKey the serialized key
+         * @param frontierDepth the depth of the frontier
+         */
+        PPRF_AEAD_PKW(SecureByteBuffer serializedKey, int frontierDepth);
+
+        ciphertext wrap(Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+        std::vector<unsigned char> unwrap(Tag tag, std::vector<unsigned char> &header, ciphertext &c) override;
+
+        /**
+         * Wraps into a caller-supplied ciphertext. Once out has the capacity for the ciphertext, e.g. when it is
+         * reused, this does not allocate for 128 and 256 bit keys.
+         * @param tag the tag
+         * @param header the header
+         * @param key the key to be wrapped
+         * @param out receives the ciphertext
+         */
+        void wrap(Tag tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &key, ciphertext &out);
+
+        /**
+         * Unwraps into a caller-supplied buffer, without allocating once out has the capacity for the key.
+         * @param tag the tag with which the key was wrapped
+         * @param header the header with which the key was wrapped
+         * @param c the ciphertext
+         * @param out receives the wrapped key
+         */
+        void unwrap(Tag tag, const std::vector<unsigned char> &header, const ciphertext &c, std::vector<unsigned char> &out);
+        void punc(Tag tag) override;
+
+        /**
+         * Wraps several keys under one tag and header. The wrapping key is derived from the PPRF once per bundle; each
+         * entry is encrypted under its own subkey, derived from the wrapping key and the entry's index, with a random
+         * nonce. The bundle starts with the number of entries and a table of their end offsets, so that single
+         * entries can be unwrapped with unwrapBundle.
+         * @param tag the tag
+         * @param header the header, authenticated with every entry
+         * @param keys the keys to be wrapped
+         * @return the bundle
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws WrappingException if the bundle is too large
+         */
+        ciphertext wrapBundle(Tag tag, const std::vector<unsigned char> &header, const std::vector<std::vector<unsigned char>> &keys);
+
+        /**
+         * Unwraps entry index of a bundle of wrapBundle, without decrypting the others.
+         * @param tag the tag with which the bundle was wrapped
+         * @param header the header with which the bundle was wrapped
+         * @param bundle the bundle
+         * @param index the index of the key in the keys passed to wrapBundle
+         * @return the key
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws UnwrappingException if the bundle is malformed, index is out of range or the entry is not authentic
+         */
+        std::vector<unsigned char> unwrapBundle(Tag tag, const std::vector<unsigned char> &header, const ciphertext &bundle, size_t index);
+
+        /**
+         * Wraps a stream of any length in constant memory: in is encrypted in chunks under the key derived for tag, see
+         * streamEncrypt.
+         * @param tag the tag
+         * @param header the header, authenticated with every chunk
+         * @param in the data to be wrapped
+         * @param out receives the ciphertext
+         * @param chunkSize the plaintext length of a chunk
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws WrappingException if chunkSize is out of range
+         * @throws StreamException on an I/O error
+         */
+        void wrapStream(Tag tag, const std::vector<unsigned char> &header, ByteSource &in, ByteSink &out,
+                        size_t chunkSize = STREAM_DEFAULT_CHUNK_SIZE);
+
+        /**
+         * Unwraps a stream of wrapStream in constant memory.
+         * @param tag the tag with which the stream was wrapped
+         * @param header the header with which the stream was wrapped
+         * @param in the ciphertext
+         * @param out receives the data, chunk by chunk once each chunk is authenticated
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws UnwrappingException if a chunk is not authentic or the stream is truncated
+         * @throws StreamException on an I/O error
+         */
+        void unwrapStream(Tag tag, const std::vector<unsigned char> &header, ByteSource &in, ByteSink &out);
+
+        /**
+         * Opens a stream of wrapStream for decryption chunk by chunk, e.g. starting at a chunk in the middle of a
+         * seekable source.
+         * @param tag the tag with which the stream was wrapped
+         * @param header the header with which the stream was wrapped
+         * @param in the ciphertext, positioned at its start; must outlive the decryptor
+         * @return the decryptor
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws UnwrappingException if the stream header is malformed
+         */
+        StreamDecryptor openStream(Tag tag, const std::vector<unsigned char> &header, ByteSource &in);
+
+        /**
+         * Like wrap, but reports errors as a PKWError instead of throwing.
+         * @return the ciphertext, or PKWError::IllegalTag, PKWError::Punctured or PKWError::Wrapping
+         */
+        PKWResult<ciphertext> tryWrap(Tag tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &key);
+
+        /**
+         * Like wrap into a caller-supplied ciphertext, but reports errors instead of throwing.
+         * @return PKWError::None on success
+         */
+        PKWError tryWrap(Tag tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &key, ciphertext &out);
+
+        /**
+         * Like unwrap, but reports errors as a PKWError instead of throwing.
+         * @return the key, or PKWError::IllegalTag, PKWError::Punctured or PKWError::Authentication
+         */
+        PKWResult<std::vector<unsigned char>> tryUnwrap(Tag tag, const std::vector<unsigned char> &header, const ciphertext &c);
+
+        /**
+         * Like unwrap into a caller-supplied buffer, but reports errors instead of throwing.
+         * @return PKWError::None on success
+         */
+        PKWError tryUnwrap(Tag tag, const std::vector<unsigned char> &header, const ciphertext &c, std::vector<unsigned char> &out);
+
+        /**
+         * Like tryUnwrap into a caller-supplied buffer, for header and ciphertext held elsewhere, e.g. in a mapped file.
+         * @return PKWError::None on success
+         */
+        PKWError tryUnwrap(Tag tag, const unsigned char *header, size_t headerLen, const unsigned char *c, size_t cLen,
+                           std::vector<unsigned char> &out);
+
+        /**
+         * Like punc, but reports a tag outside the tag space as PKWError::IllegalTag instead of throwing.
+         */
+        PKWResult<void> tryPunc(Tag tag);
+
+        /**
+         * Tells whether the key was punctured on tag, from the PPRF's node index alone.
+         * @param tag the tag
+         * @return true iff tag was punctured
+         * @throws IllegalTagException if the size of the tag exceeds the tag length
+         */
+        bool isPunctured(Tag tag);
+
+        /**
+         * Punctures on all tags sharing the first prefixLen bits with tag, see GGM_PPRF::puncPrefix.
+         * @param tag any tag of the subtree
+         * @param prefixLen the length of the common prefix
+         * @throws IllegalTagException if the size of the tag exceeds the tag length or prefixLen is out of range
+         */
+        void puncPrefix(Tag tag, int prefixLen);
+
+        /**
+         * Serializes a key that wraps and unwraps only under the tags sharing the first prefixLen bits with tag, see
+         * GGM_PPRF::delegate. A worker constructs its PPRF_AEAD_PKW from it.
+         * @throws IllegalTagException if the size of the tag exceeds the tag length or prefixLen is out of range
+         */
+        SecureByteBuffer delegate(Tag tag, int prefixLen) const;
+
+        /**
+         * Takes over the punctures of a serialized key obtained from delegate(tag, prefixLen), see GGM_PPRF::merge.
+         * @throws IllegalTagException if the size of the tag exceeds the tag length or prefixLen is out of range
+         * @throws InitializationException if the key does not stem from this key's subtree
+         */
+        void merge(Tag tag, int prefixLen, SecureByteBuffer &delegated);
+        long getNumPuncs() override;
+        void secureTeardown() override;
+        SecureByteBuffer serializeKey() override;
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+        /**
+         * Returns the number of nodes held by the underlying PPRF key, which determines its size.
+         * @return the number of nodes
+         */
+        size_t getNumNodes();
+
+        /**
+         * Returns the memory held by the key, see GGM_PPRF::memoryUsage.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+        /**
+         * Estimates nodes, memory and serialized size after k further punctures, see GGM_PPRF::projectMemoryUsage.
+         * @param k the number of punctures
+         * @param order which tags are punctured
+         * @param seed seed for the tags drawn by PunctureOrder::Random
+         * @return the projection
+         */
+        MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed = 0) const;
+
+        /**
+         * Takes an O(1) copy-on-write snapshot of the key, see GGM_PPRF::snapshot. Its serializeKey() can be
+         * reimported with PPRF_AEAD_PKW_Factory.
+         * @return the snapshot
+         */
+        GGM_PPRFSnapshot snapshot() const;
+
+    private:
+        GGM_PPRF pprf;
+};
+
+class PPRF_AEAD_PKW_Factory : public AbstractPKWFactory<Tag, ciphertext> {
+    public:
+        std::shared_ptr<AbstractPKW<Tag, ciphertext>> fromSerialized(SecureByteBuffer &serialized) override;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PPRF_AEAD_PKW_H
\ No newline at end of file
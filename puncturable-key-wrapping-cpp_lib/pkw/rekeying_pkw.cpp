@@ -0,0 +1,202 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "rekeying_pkw.h"
+#include "exceptions.h"
+#include "pprf/ggm_pprf_key.h"
+#include "pprf/pprf_key_serializer.h"
+#include "secure_memzero.h"
+#include <algorithm>
+#include <utility>
+
+using std::vector;
+
+static std::unique_ptr<PPRF_AEAD_PKW> freshKey(int tagLen, int keyLen) {
+    return std::unique_ptr<PPRF_AEAD_PKW>(new PPRF_AEAD_PKW(PPRFKey::generate(keyLen, tagLen).serialize()));
+}
+
+static void addUsage(MemoryUsage &usage, const MemoryUsage &other) {
+    usage.secretBytes += other.secretBytes;
+    usage.indexBytes += other.indexBytes;
+    usage.containerBytes += other.containerBytes;
+    usage.slackBytes += other.slackBytes;
+    if (usage.depthHistogram.size() < other.depthHistogram.size()) {
+        usage.depthHistogram.resize(other.depthHistogram.size(), 0);
+    }
+    for (size_t i = 0; i < other.depthHistogram.size(); ++i) {
+        usage.depthHistogram[i] += other.depthHistogram[i];
+    }
+}
+
+RekeyingPKW::RekeyingPKW(int tagLen, int keyLen, RekeyPolicy policy) : tagLen(tagLen), keyLen(keyLen), policy(policy),
+                                                                       current(freshKey(tagLen, keyLen)) {}
+
+RekeyingPKW::RekeyingPKW(SecureByteBuffer serializedKey, RekeyPolicy policy) : tagLen(0), keyLen(0), policy(policy) {
+    PPRFKey key = PPRFKeySerializer::deserialize(serializedKey);
+    tagLen = key.tagLen;
+    keyLen = key.keyLen;
+    current.reset(new PPRF_AEAD_PKW(serializedKey));
+}
+
+ciphertext RekeyingPKW::wrap(Tag tag, vector<unsigned char> &header, vector<unsigned char> &key) {
+    expireGrace();
+    return current->wrap(tag, header, key);
+}
+
+vector<unsigned char> RekeyingPKW::unwrap(Tag tag, vector<unsigned char> &header, ciphertext &c) {
+    expireGrace();
+    try {
+        return current->unwrap(tag, header, c);
+    } catch (UnwrappingException &e) {
+        if (!previous) {
+            throw;
+        }
+    }
+    /* the ciphertexts carry no key identifier: a ciphertext the current key rejects may be one of the previous key */
+    return previous->unwrap(tag, header, c);
+}
+
+void RekeyingPKW::punc(Tag tag) {
+    expireGrace();
+    current->punc(tag);
+    if (previous) {
+        previous->punc(tag);
+    } else if (overBudget()) {
+        beginMigration();
+    }
+}
+
+long RekeyingPKW::getNumPuncs() {
+    return current->getNumPuncs();
+}
+
+size_t RekeyingPKW::getNumNodes() {
+    return current->getNumNodes();
+}
+
+void RekeyingPKW::secureTeardown() {
+    previous.reset();
+    current->secureTeardown();
+}
+
+SecureByteBuffer RekeyingPKW::serializeKey() {
+    if (migrating()) {
+        throw MigrationException();
+    }
+    return current->serializeKey();
+}
+
+SecureByteBuffer RekeyingPKW::serializeAndEncryptKey(const std::string &password) {
+    auto serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
+
+void RekeyingPKW::beginMigration() {
+    expireGrace();
+    if (previous) {
+        throw MigrationException();
+    }
+    previous = std::move(current);
+    current = freshKey(tagLen, keyLen);
+    graceEnd = std::chrono::steady_clock::now() + policy.graceWindow;
+    nextByteCheck = 0;
+    generation += 1;
+}
+
+size_t RekeyingPKW::migrate(vector<WrappedKey> &batch) {
+    expireGrace();
+    if (!previous) {
+        throw MigrationException();
+    }
+    size_t migrated = 0;
+    auto keep = batch.begin();
+    for (WrappedKey &wrapped: batch) {
+        bool valid = true;
+        /* holds the plaintext key, zeroized whichever way the migration of this key ends */
+        vector<unsigned char> key;
+        try {
+            key = previous->unwrap(wrapped.tag, wrapped.header, wrapped.c);
+            wrapped.c = current->wrap(wrapped.tag, wrapped.header, key);
+            migrated += 1;
+        } catch (PuncturableKeyWrappingException &e) {
+            secure_memzero(key.data(), key.size());
+            /* already migrated, or dead */
+            try {
+                key = current->unwrap(wrapped.tag, wrapped.header, wrapped.c);
+            } catch (PuncturableKeyWrappingException &e) {
+                valid = false;
+            }
+        } catch (...) {
+            secure_memzero(key.data(), key.size());
+            throw;
+        }
+        secure_memzero(key.data(), key.size());
+        if (valid) {
+            if (&*keep != &wrapped) {
+                *keep = std::move(wrapped);
+            }
+            ++keep;
+        }
+    }
+    batch.erase(keep, batch.end());
+    return migrated;
+}
+
+void RekeyingPKW::finishMigration() {
+    if (!previous) {
+        throw MigrationException();
+    }
+    previous.reset();
+}
+
+bool RekeyingPKW::migrating() {
+    expireGrace();
+    return previous != nullptr;
+}
+
+MemoryUsage RekeyingPKW::memoryUsage() const {
+    MemoryUsage usage = current->memoryUsage();
+    if (previous) {
+        addUsage(usage, previous->memoryUsage());
+    }
+    usage.containerBytes += sizeof(*this);
+    return usage;
+}
+
+bool RekeyingPKW::overBudget() {
+    size_t nodes = current->getNumNodes();
+    if (policy.maxNodes > 0 && nodes > policy.maxNodes) {
+        return true;
+    }
+    if (policy.maxBytes > 0 && nodes >= nextByteCheck) {
+        if (current->memoryUsage().total() > policy.maxBytes) {
+            return true;
+        }
+        /* recheck after 1/16 growth: bounds the overshoot, and the linear-time check stays amortized O(1) per node */
+        nextByteCheck = nodes + std::max<size_t>(1, nodes / 16);
+    }
+    return false;
+}
+
+void RekeyingPKW::expireGrace() {
+    if (previous && policy.graceWindow.count() > 0 && std::chrono::steady_clock::now() >= graceEnd) {
+        previous.reset();
+    }
+}
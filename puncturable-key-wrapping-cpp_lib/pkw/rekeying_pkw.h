@@ -0,0 +1,170 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_REKEYING_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_REKEYING_PKW_H
+
+#include "memory_usage.h"
+#include "pkw.h"
+#include "pprf_aead_pkw.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/**
+ * When RekeyingPKW starts over with a fresh key, and how long the previous key is kept.
+ */
+struct RekeyPolicy {
+        /** rekey once the key holds more than this many nodes, 0 for no limit */
+        size_t maxNodes = 0;
+        /** rekey once the key's memory (see MemoryUsage::total) exceeds this many bytes, 0 for no limit */
+        size_t maxBytes = 0;
+        /** how long the previous key stays usable after a rekey, 0 to keep it until finishMigration */
+        std::chrono::milliseconds graceWindow{0};
+};
+
+/**
+ * A wrapped key as held by the caller, for migration to a new key.
+ */
+struct WrappedKey {
+        Tag tag;
+        std::vector<unsigned char> header;
+        ciphertext c;
+};
+
+/**
+ * A PPRF_AEAD_PKW that bounds the size of its key: once a puncture takes the key past the budget of its RekeyPolicy,
+ * a fresh random key is created and used for all new wraps. The caller then streams its live ciphertexts through
+ * migrate in batches, which re-wraps them under the new key. Until the migration is finished (explicitly or when the
+ * grace window has passed), the previous key still unwraps and is punctured along with the new one; it is then
+ * destroyed, which zeroizes it.
+ * <br>
+ * Punctures do not carry over to the new key: ciphertexts of punctured tags cannot be migrated, but the tags can be
+ * used again for new wraps.
+ */
+class RekeyingPKW : public AbstractPKW<Tag, ciphertext> {
+    public:
+        /**
+         * Constructs an instance with a fresh random key.
+         * @param tagLen the size of the tag space in number of bits.
+         * @param keyLen the size of the key space in number of bits.
+         * @param policy when to rekey
+         */
+        RekeyingPKW(int tagLen, int keyLen, RekeyPolicy policy);
+
+        /**
+         * Continues with a key serialized by serializeKey (or PPRF_AEAD_PKW::serializeKey).
+         * @param serializedKey the serialized key
+         * @param policy when to rekey
+         */
+        RekeyingPKW(SecureByteBuffer serializedKey, RekeyPolicy policy);
+
+        /**
+         * Wraps under the current key.
+         */
+        ciphertext wrap(Tag tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+
+        /**
+         * Unwraps under the current key or, during a migration, the previous key.
+         */
+        std::vector<unsigned char> unwrap(Tag tag, std::vector<unsigned char> &header, ciphertext &c) override;
+
+        /**
+         * Punctures the current key and, during a migration, the previous key. Starts a migration if the current key
+         * is now over budget.
+         */
+        void punc(Tag tag) override;
+
+        /**
+         * Returns the number of punctures on the current key.
+         * @return the number of punctures
+         */
+        long getNumPuncs() override;
+
+        /**
+         * Destroys the previous key, if any, and tears down the current one.
+         */
+        void secureTeardown() override;
+
+        /**
+         * Serializes the current key.
+         * @return the serialized key
+         * @throws MigrationException during a migration, as the previous key cannot be exported
+         */
+        SecureByteBuffer serializeKey() override;
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+        /**
+         * Switches to a fresh key, keeping the current one as the previous key until the migration is finished.
+         * Called by punc when the budget is exceeded.
+         * @throws MigrationException if a migration is already in progress
+         */
+        void beginMigration();
+
+        /**
+         * Re-wraps a batch of ciphertexts of the previous key under the current key, in place. Entries that were
+         * already migrated are kept as they are; entries that neither key can unwrap (e.g. of punctured tags) are
+         * removed from the batch.
+         * @param batch the ciphertexts
+         * @return the number of entries re-wrapped
+         * @throws MigrationException if no migration is in progress
+         */
+        size_t migrate(std::vector<WrappedKey> &batch);
+
+        /**
+         * Destroys the previous key. Ciphertexts that were not migrated can no longer be unwrapped.
+         * @throws MigrationException if no migration is in progress
+         */
+        void finishMigration();
+
+        /**
+         * Whether a previous key is still held, i.e. ciphertexts are waiting to be migrated.
+         */
+        bool migrating();
+
+        /**
+         * The number of rekeys since construction.
+         */
+        unsigned long getGeneration() const { return generation; }
+
+        size_t getNumNodes();
+
+        /**
+         * Returns the memory held by the current and, during a migration, the previous key.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+    private:
+        int tagLen;
+        int keyLen;
+        RekeyPolicy policy;
+        std::unique_ptr<PPRF_AEAD_PKW> current;
+        std::unique_ptr<PPRF_AEAD_PKW> previous;
+        std::chrono::steady_clock::time_point graceEnd;
+        unsigned long generation = 0;
+        /* node count at which the byte budget is checked next; memoryUsage is linear in the nodes */
+        size_t nextByteCheck = 0;
+
+        bool overBudget();
+        void expireGrace();
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_REKEYING_PKW_H
@@ -0,0 +1,132 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "seeded_naive_pkw.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "secure_memzero.h"
+#include "tracing.h"
+#include <cryptopp/osrng.h>
+
+using byte = unsigned char;
+using std::vector;
+
+SeededNaivePKW::SeededNaivePKW(int tagLen) : tagLen(tagLen), seed(KEY_LEN) {
+    if (tagLen < 0 || tagLen > 63) {
+        throw IllegalTagException();
+    }
+    CryptoPP::OS_GenerateRandomBlock(true, seed.data(), seed.size());
+    prf.SetKey(seed.data(), seed.size());
+}
+
+/*
+ * Layout: tag length and seed, followed by the punctured tags (see PunctureSet::serialize). The number of punctures is
+ * the size of the set.
+ */
+SeededNaivePKW::SeededNaivePKW(SecureByteBuffer serializedKey) : tagLen(0), seed(KEY_LEN) {
+    if (serializedKey.size() < sizeof(uint64_t) + KEY_LEN) {
+        throw DeserializationError();
+    }
+    uint64_t len = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        len |= static_cast<uint64_t>(serializedKey.data()[i]) << (8 * i);
+    }
+    if (len > 63) {
+        throw DeserializationError();
+    }
+    tagLen = static_cast<int>(len);
+    std::copy(serializedKey.begin() + sizeof(uint64_t), serializedKey.begin() + sizeof(uint64_t) + KEY_LEN, seed.begin());
+    prf.SetKey(seed.data(), seed.size());
+    size_t offset = sizeof(uint64_t) + KEY_LEN;
+    punctured = PunctureSet::deserialize(serializedKey.data(), serializedKey.size(), offset);
+    if (offset != serializedKey.size()) {
+        throw DeserializationError();
+    }
+}
+
+SeededNaivePKW::~SeededNaivePKW() {
+    SeededNaivePKW::secureTeardown();
+}
+
+void SeededNaivePKW::checkTag(long tag) const {
+    if (tornDown || tag < 0 || (tagLen < 63 && tag >= (1L << tagLen)) || punctured.contains(tag)) {
+        throw IllegalTagException();
+    }
+}
+
+SecureByteBuffer SeededNaivePKW::deriveKey(long tag) const {
+    SecureByteBuffer key(KEY_LEN);
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        key.data()[i] = static_cast<byte>((static_cast<uint64_t>(tag) >> (8 * i)) & 0xFF);
+    }
+    prf.ProcessBlock(key.data(), key.data());
+    return key;
+}
+
+vector<byte> SeededNaivePKW::wrap(long tag, vector<byte> &, vector<byte> &key) {
+    checkTag(tag);
+    return naiveWrap(deriveKey(tag).data(), key);
+}
+
+vector<byte> SeededNaivePKW::unwrap(long tag, vector<byte> &, vector<byte> &c) {
+    checkTag(tag);
+    return naiveUnwrap(deriveKey(tag).data(), c);
+}
+
+void SeededNaivePKW::punc(long tag) {
+    if (tag < 0 || (tagLen < 63 && tag >= (1L << tagLen))) {
+        throw IllegalTagException();
+    }
+    punctured.insert(tag);
+}
+
+void SeededNaivePKW::secureTeardown() {
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, punctured.size());
+    secure_memzero(seed.data(), seed.size());
+    prf.SetKey(seed.data(), seed.size());
+    tornDown = true;
+}
+
+SecureByteBuffer SeededNaivePKW::serializeKey() {
+    vector<byte> buffer;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        buffer.push_back(static_cast<byte>((static_cast<uint64_t>(tagLen) >> (8 * i)) & 0xFF));
+    }
+    buffer.insert(buffer.end(), seed.begin(), seed.end());
+    punctured.serialize(buffer);
+    return SecureByteBuffer(buffer);
+}
+
+SecureByteBuffer SeededNaivePKW::serializeAndEncryptKey(const std::string &password) {
+    SecureByteBuffer serialized = serializeKey();
+    return encryptExport(serialized, password);
+}
+
+MemoryUsage SeededNaivePKW::memoryUsage() const {
+    MemoryUsage usage;
+    usage.secretBytes = seed.size();
+    usage.indexBytes = punctured.memoryBytes() - sizeof(punctured);
+    usage.containerBytes = sizeof(*this);
+    usage.slackBytes = heapChunkSize(seed.size()) - seed.size();
+    return usage;
+}
+
+std::shared_ptr<AbstractPKW<long, vector<unsigned char>>> SeededNaivePKWFactory::fromSerialized(SecureByteBuffer &serialized) {
+    return std::shared_ptr<AbstractPKW<long, vector<unsigned char>>>(new SeededNaivePKW(serialized));// constructor protected
+}
@@ -0,0 +1,102 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_SEEDED_NAIVE_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_SEEDED_NAIVE_PKW_H
+
+#include "exceptions.h"
+#include "memory_usage.h"
+#include "naive_pkw.h"
+#include "pkw.h"
+#include "pkw/helpers/puncture_set.h"
+#include "secure_byte_buffer.h"
+#include <cryptopp/aes.h>
+#include <vector>
+
+/**
+ * A NaivePKW whose per-tag keys are derived on demand as AES_seed(tag) instead of being stored. Construction is O(1),
+ * and memory and serialized size grow with the number of punctures only, which are kept in a PunctureSet.
+ * <br>
+ * Punctures are NOT forward secure: punc only adds the tag to a deny-list, and the seed, held in memory and in every
+ * serialized key, still derives the keys of punctured tags. Anyone who obtains the seed after a puncture can unwrap
+ * the tag's ciphertexts. Use PPRF_AEAD_PKW or NaivePKW where punctured keys must be unrecoverable.
+ * <br>
+ * Tags range from 0 to 2^tagLen - 1, with tagLen at most 63.
+ */
+class SeededNaivePKW : public AbstractPKW<long, std::vector<unsigned char>> {
+    public:
+        /**
+         * Constructs a fresh instance with a random seed.
+         * @param tagLen the size of the tag space in number of bits
+         * @throws IllegalTagException if tagLen is not between 0 and 63
+         */
+        explicit SeededNaivePKW(int tagLen);
+
+        std::vector<unsigned char> unwrap(long tag, std::vector<unsigned char> &header, std::vector<unsigned char> &c) override;
+
+        std::vector<unsigned char>
+        wrap(long tag, std::vector<unsigned char> &header, std::vector<unsigned char> &key) override;
+
+        void punc(long tag) override;
+
+        long getNumPuncs() override {
+            return static_cast<long>(punctured.size());
+        }
+
+        void secureTeardown() override;
+
+        /**
+         * Serializes the tag length, the seed and the punctured tags.
+         * @return the serialized key
+         */
+        SecureByteBuffer serializeKey() override;
+
+        SecureByteBuffer serializeAndEncryptKey(const std::string &password) override;
+
+        ~SeededNaivePKW();
+
+        /**
+         * Returns the memory held by the key; the depth histogram is empty.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+    protected:
+        explicit SeededNaivePKW(SecureByteBuffer serializedKey);
+
+    private:
+        friend class SeededNaivePKWFactory;
+        int tagLen;
+        bool tornDown = false;
+        SecureByteBuffer seed;
+        CryptoPP::AES::Encryption prf;
+        PunctureSet punctured;
+
+        void checkTag(long tag) const;
+
+        SecureByteBuffer deriveKey(long tag) const;
+};
+
+class SeededNaivePKWFactory : public AbstractPKWFactory<long, std::vector<unsigned char>> {
+    public:
+        std::shared_ptr<AbstractPKW<long, std::vector<unsigned char>>> fromSerialized(SecureByteBuffer &serialized) override;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_SEEDED_NAIVE_PKW_H
@@ -0,0 +1,97 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_PKW_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_PKW_H
+
+#include "pkw.h"
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Static (CRTP) counterpart of AbstractPKW. Impl derives from StaticPKW<Impl, T, C>, which is an AbstractPKW<T, C>, and
+ * overrides its operations; Impl should be final. The batch drivers below call them through Impl, so the calls are
+ * devirtualized and tag handling and AEAD setup can be inlined into the loop, while Impl still binds to AbstractPKW
+ * references and pointers.
+ * @tparam Impl the implementation
+ * @tparam T the type of the tag
+ * @tparam C the type of the ciphertext
+ */
+template<class Impl, class T, class C>
+class StaticPKW : public AbstractPKW<T, C> {
+    public:
+        typedef T TagType;
+        typedef C CiphertextType;
+
+        /**
+         * Wraps keys[i] under tags[i] and the common header.
+         * @param tags the tags
+         * @param header the header
+         * @param keys the keys to be wrapped, one per tag
+         * @param out receives the ciphertexts, one per tag
+         * @throws std::invalid_argument if tags and keys differ in size
+         */
+        void wrapBatch(const std::vector<T> &tags, std::vector<unsigned char> &header,
+                       std::vector<std::vector<unsigned char>> &keys, std::vector<C> &out) {
+            if (tags.size() != keys.size()) {
+                throw std::invalid_argument("one key per tag required");
+            }
+            out.resize(tags.size());
+            for (size_t i = 0; i < tags.size(); ++i) {
+                out[i] = self().wrap(tags[i], header, keys[i]);
+            }
+        }
+
+        /**
+         * Unwraps cs[i], wrapped under tags[i] and the common header.
+         * @param tags the tags
+         * @param header the header
+         * @param cs the ciphertexts, one per tag
+         * @param out receives the keys, one per tag
+         * @throws std::invalid_argument if tags and cs differ in size
+         */
+        void unwrapBatch(const std::vector<T> &tags, std::vector<unsigned char> &header, std::vector<C> &cs,
+                         std::vector<std::vector<unsigned char>> &out) {
+            if (tags.size() != cs.size()) {
+                throw std::invalid_argument("one ciphertext per tag required");
+            }
+            out.resize(tags.size());
+            for (size_t i = 0; i < tags.size(); ++i) {
+                out[i] = self().unwrap(tags[i], header, cs[i]);
+            }
+        }
+
+        /**
+         * Punctures on each of tags, in order.
+         * @param tags the tags
+         */
+        void puncBatch(const std::vector<T> &tags) {
+            for (const T &tag: tags) {
+                self().punc(tag);
+            }
+        }
+
+    private:
+        Impl &self() {
+            return static_cast<Impl &>(*this);
+        }
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_PKW_H
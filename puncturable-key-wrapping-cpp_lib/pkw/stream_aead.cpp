@@ -0,0 +1,245 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "stream_aead.h"
+#include "exceptions.h"
+#include "secure_array.h"
+#include "secure_memzero.h"
+#include <algorithm>
+#include <cerrno>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/hkdf.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/sha.h>
+#include <cstring>
+#include <unistd.h>
+
+using std::vector;
+
+static const unsigned char STREAM_MAGIC[] = {'P', 'K', 'S', 1};
+static const unsigned char STREAM_INFO[] = {'s', 't', 'r', 'e', 'a', 'm'};
+static const size_t SALT_LEN = 16;
+static const size_t MAC_SIZE = 16;
+static const size_t NONCE_SIZE = 12;
+/* the largest AES key */
+static const size_t MAX_STREAM_KEY = 32;
+
+void ByteSource::seek(uint64_t) {
+    throw StreamException();
+}
+
+FdSource::FdSource(int fd) : fd(fd), start(::lseek(fd, 0, SEEK_CUR)) {}
+
+size_t FdSource::read(unsigned char *buf, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t r = ::read(fd, buf + done, n - done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r < 0) {
+            throw StreamException();
+        }
+        if (r == 0) {
+            break;
+        }
+        done += r;
+    }
+    return done;
+}
+
+void FdSource::seek(uint64_t offset) {
+    if (start < 0 || ::lseek(fd, start + (off_t) offset, SEEK_SET) < 0) {
+        throw StreamException();
+    }
+}
+
+void FdSink::write(const unsigned char *buf, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t w = ::write(fd, buf + done, n - done);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            throw StreamException();
+        }
+        done += w;
+    }
+}
+
+size_t MemorySource::read(unsigned char *buf, size_t n) {
+    n = std::min(n, size - pos);
+    std::copy(data + pos, data + pos + n, buf);
+    pos += n;
+    return n;
+}
+
+void MemorySource::seek(uint64_t offset) {
+    pos = (size_t) std::min<uint64_t>(offset, size);
+}
+
+void VectorSink::write(const unsigned char *buf, size_t n) {
+    vec.insert(vec.end(), buf, buf + n);
+}
+
+static void deriveStreamKey(const unsigned char *key, size_t keyLen, const unsigned char *salt, unsigned char *streamKey) {
+    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
+    hkdf.DeriveKey(streamKey, keyLen, key, keyLen, salt, SALT_LEN, STREAM_INFO, sizeof(STREAM_INFO));
+}
+
+/* chunk counter (64 bit big endian), three zero bytes and the flag of the final chunk */
+static void chunkNonce(uint64_t index, bool last, unsigned char *nonce) {
+    for (int i = 0; i < 8; ++i) {
+        nonce[i] = (unsigned char) (index >> (56 - 8 * i));
+    }
+    nonce[8] = nonce[9] = nonce[10] = 0;
+    nonce[11] = last ? 1 : 0;
+}
+
+/* the associated data of every chunk: the caller's header followed by the stream header */
+static vector<unsigned char> streamAAD(const vector<unsigned char> &header, const unsigned char *streamHeader) {
+    vector<unsigned char> aad(header);
+    aad.insert(aad.end(), streamHeader, streamHeader + STREAM_HEADER_LEN);
+    return aad;
+}
+
+static bool validKeyLen(size_t keyLen) {
+    return keyLen == 16 || keyLen == 24 || keyLen == 32;
+}
+
+void streamEncrypt(const unsigned char *key, size_t keyLen, const vector<unsigned char> &header, ByteSource &in,
+                   ByteSink &out, size_t chunkSize) {
+    if (chunkSize == 0 || chunkSize > STREAM_MAX_CHUNK_SIZE || !validKeyLen(keyLen)) {
+        throw WrappingException();
+    }
+    unsigned char streamHeader[STREAM_HEADER_LEN];
+    std::copy(STREAM_MAGIC, STREAM_MAGIC + sizeof(STREAM_MAGIC), streamHeader);
+    for (int i = 0; i < 4; ++i) {
+        streamHeader[4 + i] = (unsigned char) (chunkSize >> (8 * i));
+    }
+    CryptoPP::OS_GenerateRandomBlock(false, streamHeader + 8, SALT_LEN);
+    SecureArray<MAX_STREAM_KEY> streamKey;
+    deriveStreamKey(key, keyLen, streamHeader + 8, streamKey.data());
+    vector<unsigned char> aad = streamAAD(header, streamHeader);
+    out.write(streamHeader, STREAM_HEADER_LEN);
+
+    /* one byte more than a chunk, to tell whether the chunk is the final one */
+    SecureByteBuffer plain(chunkSize + 1);
+    vector<unsigned char> chunk(chunkSize + MAC_SIZE);
+    size_t filled = 0;
+    unsigned char nonce[NONCE_SIZE];
+    try {
+        CryptoPP::GCM<CryptoPP::AES>::Encryption e;
+        for (uint64_t index = 0;; ++index) {
+            filled += in.read(plain.data() + filled, plain.size() - filled);
+            const bool last = filled <= chunkSize;
+            const size_t n = last ? filled : chunkSize;
+            chunkNonce(index, last, nonce);
+            e.SetKeyWithIV(streamKey.data(), keyLen, nonce, NONCE_SIZE);
+            e.EncryptAndAuthenticate(chunk.data(), chunk.data() + n, MAC_SIZE, nonce, (int) NONCE_SIZE, aad.data(),
+                                     aad.size(), plain.data(), n);
+            out.write(chunk.data(), n + MAC_SIZE);
+            if (last) {
+                break;
+            }
+            plain.data()[0] = plain.data()[chunkSize];
+            filled = 1;
+        }
+    } catch (CryptoPP::Exception &e) {
+        throw WrappingException();
+    }
+}
+
+StreamDecryptor::StreamDecryptor(const unsigned char *key, size_t keyLen, const vector<unsigned char> &header, ByteSource &in)
+    : in(in), streamKey(keyLen), chunkLen(0), filled(0), index(0), done(false) {
+    unsigned char streamHeader[STREAM_HEADER_LEN];
+    if (!validKeyLen(keyLen) || in.read(streamHeader, STREAM_HEADER_LEN) != STREAM_HEADER_LEN ||
+        !std::equal(STREAM_MAGIC, STREAM_MAGIC + sizeof(STREAM_MAGIC), streamHeader)) {
+        throw UnwrappingException();
+    }
+    for (int i = 0; i < 4; ++i) {
+        chunkLen |= size_t(streamHeader[4 + i]) << (8 * i);
+    }
+    if (chunkLen == 0 || chunkLen > STREAM_MAX_CHUNK_SIZE) {
+        throw UnwrappingException();
+    }
+    deriveStreamKey(key, keyLen, streamHeader + 8, streamKey.data());
+    aad = streamAAD(header, streamHeader);
+    buffer.resize(chunkLen + MAC_SIZE + 1);
+}
+
+size_t StreamDecryptor::chunkSize() const {
+    return chunkLen;
+}
+
+bool StreamDecryptor::next(vector<unsigned char> &out) {
+    out.clear();
+    if (done) {
+        return false;
+    }
+    filled += in.read(buffer.data() + filled, buffer.size() - filled);
+    const bool last = filled < buffer.size();
+    const size_t n = last ? filled : buffer.size() - 1;
+    if (n < MAC_SIZE) {
+        throw UnwrappingException();
+    }
+    unsigned char nonce[NONCE_SIZE];
+    chunkNonce(index, last, nonce);
+    bool verified = false;
+    out.resize(n - MAC_SIZE);
+    try {
+        CryptoPP::GCM<CryptoPP::AES>::Decryption d;
+        d.SetKeyWithIV(streamKey.data(), streamKey.size(), nonce, NONCE_SIZE);
+        verified = d.DecryptAndVerify(out.data(), buffer.data() + out.size(), MAC_SIZE, nonce, (int) NONCE_SIZE,
+                                      aad.data(), aad.size(), buffer.data(), out.size());
+    } catch (CryptoPP::Exception &e) {
+        verified = false;
+    }
+    if (!verified) {
+        secure_memzero(out.data(), out.size());
+        out.clear();
+        throw UnwrappingException();
+    }
+    ++index;
+    done = last;
+    if (!last) {
+        buffer[0] = buffer[n];
+        filled = 1;
+    }
+    return true;
+}
+
+void StreamDecryptor::seek(uint64_t chunk) {
+    in.seek(STREAM_HEADER_LEN + chunk * (chunkLen + MAC_SIZE));
+    index = chunk;
+    filled = 0;
+    done = false;
+}
+
+void StreamDecryptor::decryptTo(ByteSink &out) {
+    vector<unsigned char> chunk;
+    chunk.reserve(chunkLen);
+    while (next(chunk)) {
+        out.write(chunk.data(), chunk.size());
+        secure_memzero(chunk.data(), chunk.size());
+    }
+}
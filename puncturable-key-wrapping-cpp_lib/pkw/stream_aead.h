@@ -0,0 +1,201 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_STREAM_AEAD_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_STREAM_AEAD_H
+
+#include "secure_byte_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A source of bytes for streaming encryption and decryption.
+ */
+class ByteSource {
+    public:
+        virtual ~ByteSource() = default;
+
+        /**
+         * Reads up to n bytes. Fewer bytes are returned only at the end of the source.
+         * @param buf receives the bytes
+         * @param n the number of bytes to read
+         * @return the number of bytes read
+         * @throws StreamException on a read error
+         */
+        virtual size_t read(unsigned char *buf, size_t n) = 0;
+
+        /**
+         * Positions the source at offset, counted from where the source started.
+         * @param offset the offset
+         * @throws StreamException if the source cannot seek
+         */
+        virtual void seek(uint64_t offset);
+};
+
+/**
+ * A sink of bytes for streaming encryption and decryption.
+ */
+class ByteSink {
+    public:
+        virtual ~ByteSink() = default;
+
+        /**
+         * Writes all n bytes of buf.
+         * @throws StreamException on a write error
+         */
+        virtual void write(const unsigned char *buf, size_t n) = 0;
+};
+
+/**
+ * Reads from a file descriptor, which is not closed. Seeking is relative to the file offset at construction.
+ */
+class FdSource : public ByteSource {
+    public:
+        explicit FdSource(int fd);
+        size_t read(unsigned char *buf, size_t n) override;
+        void seek(uint64_t offset) override;
+
+    private:
+        int fd;
+        int64_t start;
+};
+
+/**
+ * Writes to a file descriptor, which is not closed.
+ */
+class FdSink : public ByteSink {
+    public:
+        explicit FdSink(int fd) : fd(fd) {}
+        void write(const unsigned char *buf, size_t n) override;
+
+    private:
+        int fd;
+};
+
+/**
+ * Reads from memory owned by the caller.
+ */
+class MemorySource : public ByteSource {
+    public:
+        MemorySource(const unsigned char *data, size_t size) : data(data), size(size), pos(0) {}
+        size_t read(unsigned char *buf, size_t n) override;
+        void seek(uint64_t offset) override;
+
+    private:
+        const unsigned char *data;
+        size_t size;
+        size_t pos;
+};
+
+/**
+ * Appends to a vector owned by the caller.
+ */
+class VectorSink : public ByteSink {
+    public:
+        explicit VectorSink(std::vector<unsigned char> &vec) : vec(vec) {}
+        void write(const unsigned char *buf, size_t n) override;
+
+    private:
+        std::vector<unsigned char> &vec;
+};
+
+/* the default plaintext length of a chunk, and the largest one accepted */
+const size_t STREAM_DEFAULT_CHUNK_SIZE = 64 * 1024;
+const size_t STREAM_MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+/* the length of the stream header: version, chunk size and salt */
+const size_t STREAM_HEADER_LEN = 24;
+
+/**
+ * Encrypts a stream in the STREAM construction (Hoang, Reyhanitabar, Rogaway & Vizár, 2015) with AES-GCM, in constant
+ * memory. The stream key is derived with HKDF from key and a random salt; chunk i is encrypted under the nonce
+ * i || last, where last marks the final chunk, so reordering, dropping and truncating chunks is detected. Every chunk
+ * authenticates header and the stream header. The output is the stream header, followed by the chunks, each of
+ * chunkSize plaintext bytes (less for the final one) and a 16 byte MAC.
+ * @param key the key, of 16, 24 or 32 bytes
+ * @param keyLen the length of the key
+ * @param header additional data authenticated with every chunk
+ * @param in the plaintext
+ * @param out receives the ciphertext
+ * @param chunkSize the plaintext length of a chunk, at most STREAM_MAX_CHUNK_SIZE
+ * @throws WrappingException if chunkSize is out of range or encryption fails
+ * @throws StreamException on an I/O error
+ */
+void streamEncrypt(const unsigned char *key, size_t keyLen, const std::vector<unsigned char> &header, ByteSource &in,
+                   ByteSink &out, size_t chunkSize = STREAM_DEFAULT_CHUNK_SIZE);
+
+/**
+ * Decrypts a stream of streamEncrypt chunk by chunk, in constant memory. If the source can seek, decryption can
+ * start at any chunk.
+ */
+class StreamDecryptor {
+    public:
+        /**
+         * Reads the stream header and derives the stream key.
+         * @param key the key passed to streamEncrypt
+         * @param keyLen the length of the key
+         * @param header the header passed to streamEncrypt
+         * @param in the ciphertext, positioned at the stream header
+         * @throws UnwrappingException if the stream header is malformed
+         */
+        StreamDecryptor(const unsigned char *key, size_t keyLen, const std::vector<unsigned char> &header, ByteSource &in);
+
+        /**
+         * Returns the plaintext length of a chunk, so plaintext offset o lies in chunk o / chunkSize().
+         * @return the chunk size
+         */
+        size_t chunkSize() const;
+
+        /**
+         * Decrypts the next chunk.
+         * @param out receives the plaintext of the chunk
+         * @return false iff the final chunk was decrypted before; out is then empty
+         * @throws UnwrappingException if the chunk is not authentic or the stream is truncated
+         */
+        bool next(std::vector<unsigned char> &out);
+
+        /**
+         * Positions the stream at the start of chunk index.
+         * @param index the index of the chunk
+         * @throws StreamException if the source cannot seek
+         */
+        void seek(uint64_t index);
+
+        /**
+         * Decrypts all remaining chunks into out. Plaintext of a chunk is written only once it is authenticated, but
+         * earlier chunks have been written when a later one fails.
+         * @param out receives the plaintext
+         * @throws UnwrappingException if a chunk is not authentic or the stream is truncated
+         */
+        void decryptTo(ByteSink &out);
+
+    private:
+        ByteSource &in;
+        SecureByteBuffer streamKey;
+        std::vector<unsigned char> aad;
+        std::vector<unsigned char> buffer;
+        size_t chunkLen;
+        /* bytes of the next chunk already in buffer, read ahead to detect the final chunk */
+        size_t filled;
+        uint64_t index;
+        bool done;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_STREAM_AEAD_H
@@ -0,0 +1,337 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "wrapped_key_store.h"
+#include "exceptions.h"
+#include "secure_memzero.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::vector;
+
+/*
+ * Log layout: MAGIC, then records until one of body length 0. A record is
+ * body length (4) | tag (32, little endian) | header length (4) | header | ciphertext, all integers little endian.
+ */
+static const unsigned char MAGIC[] = {'P', 'K', 'W', 'L', 1, 0, 0, 0};
+static const size_t TAG_BYTES = MAX_TAG_LEN / 8;
+/* body length and header length */
+static const size_t RECORD_OVERHEAD = 4 + TAG_BYTES + 4;
+static const size_t INITIAL_CAPACITY = 64 * 1024;
+/* compaction runs once the garbage exceeds both this and the live records */
+static const size_t COMPACT_MIN_GARBAGE = 64 * 1024;
+
+static void putU32(unsigned char *p, size_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (unsigned char) (v >> (8 * i));
+    }
+}
+
+static size_t getU32(const unsigned char *p) {
+    size_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= size_t(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+static Tag getTag(const unsigned char *p) {
+    Tag tag;
+    for (size_t i = 0; i < TAG_BYTES; ++i) {
+        tag |= Tag(p[i]) << (8 * i);
+    }
+    return tag;
+}
+
+static void putTag(unsigned char *p, const Tag &tag) {
+    TagWords words = GGM_PPRF::toWords(tag);
+    for (size_t w = 0; w < words.size(); ++w) {
+        for (int i = 0; i < 8; ++i) {
+            p[8 * w + i] = (unsigned char) (words[w] >> (8 * i));
+        }
+    }
+}
+
+static bool writeAll(int fd, const unsigned char *buf, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t w = ::write(fd, buf + done, n - done);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        done += w;
+    }
+    return true;
+}
+
+WrappedKeyStore::WrappedKeyStore(PPRF_AEAD_PKW &pkw, const std::string &path)
+    : pkw(pkw), path(path), fd(-1), mapping(nullptr), capacity(0), end(0), garbage(0) {
+    open();
+}
+
+WrappedKeyStore::~WrappedKeyStore() {
+    close();
+}
+
+WrappedKeyStore::IndexKey WrappedKeyStore::toKey(const Tag &tag) {
+    TagWords words = GGM_PPRF::toWords(tag);
+    std::reverse(words.begin(), words.end());
+    return words;
+}
+
+Tag WrappedKeyStore::fromKey(const IndexKey &key) {
+    Tag tag;
+    for (uint64_t word: key) {
+        tag = (tag << 64) | Tag(word);
+    }
+    return tag;
+}
+
+void WrappedKeyStore::open() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        close();
+        throw ImportException();
+    }
+    capacity = st.st_size;
+    const bool fresh = capacity == 0;
+    if (fresh) {
+        capacity = INITIAL_CAPACITY;
+        if (::ftruncate(fd, capacity) != 0) {
+            close();
+            throw ImportException();
+        }
+    }
+    void *addr = capacity < sizeof(MAGIC) ? MAP_FAILED : mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close();
+        throw ImportException();
+    }
+    mapping = static_cast<unsigned char *>(addr);
+    if (fresh) {
+        std::copy(MAGIC, MAGIC + sizeof(MAGIC), mapping);
+    } else if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), mapping)) {
+        close();
+        throw ImportException();
+    }
+    scan();
+}
+
+void WrappedKeyStore::close() {
+    if (mapping) {
+        munmap(mapping, capacity);
+        mapping = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    index.clear();
+}
+
+void WrappedKeyStore::scan() {
+    index.clear();
+    garbage = 0;
+    size_t pos = sizeof(MAGIC);
+    while (capacity - pos >= 4) {
+        const size_t bodyLen = getU32(mapping + pos);
+        /* the end of the log, or a record torn by a crash */
+        if (bodyLen < RECORD_OVERHEAD - 4 || bodyLen > capacity - pos - 4 ||
+            getU32(mapping + pos + 4 + TAG_BYTES) > bodyLen - (RECORD_OVERHEAD - 4)) {
+            break;
+        }
+        Record record{pos, 4 + bodyLen};
+        Tag tag = getTag(mapping + pos + 4);
+        bool live;
+        try {
+            live = !pkw.isPunctured(tag);
+        } catch (IllegalTagException &e) {
+            live = false;
+        }
+        if (live) {
+            auto inserted = index.insert({toKey(tag), record});
+            if (!inserted.second) {
+                garbage += inserted.first->second.len;
+                inserted.first->second = record;
+            }
+        } else {
+            garbage += record.len;
+        }
+        pos += record.len;
+    }
+    end = pos;
+    /* appends must not leave the remains of a torn record behind them */
+    if (capacity - end >= 4 && getU32(mapping + end) != 0) {
+        std::fill(mapping + end, mapping + capacity, 0);
+    }
+}
+
+void WrappedKeyStore::reserve(size_t bytes) {
+    if (capacity - end > bytes) {
+        return;
+    }
+    size_t grown = std::max(std::max(capacity * 2, INITIAL_CAPACITY), end + bytes + 4);
+    void *addr = MAP_FAILED;
+    if (::ftruncate(fd, grown) == 0) {
+        addr = mmap(nullptr, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (addr == MAP_FAILED) {
+        throw ExportException();
+    }
+    munmap(mapping, capacity);
+    mapping = static_cast<unsigned char *>(addr);
+    capacity = grown;
+}
+
+void WrappedKeyStore::put(const Tag &tag, const vector<unsigned char> &header, const vector<unsigned char> &key) {
+    ciphertext c;
+    pkw.wrap(tag, header, key, c);
+    const size_t bodyLen = RECORD_OVERHEAD - 4 + header.size() + c.size();
+    if (bodyLen > UINT32_MAX) {
+        throw ExportException();
+    }
+    reserve(4 + bodyLen);
+    unsigned char *p = mapping + end;
+    putTag(p + 4, tag);
+    putU32(p + 4 + TAG_BYTES, header.size());
+    std::copy(header.begin(), header.end(), p + RECORD_OVERHEAD);
+    std::copy(c.begin(), c.end(), p + RECORD_OVERHEAD + header.size());
+    /* the length last: a record is visible to scan only once complete */
+    putU32(p, bodyLen);
+    Record record{end, 4 + bodyLen};
+    end += record.len;
+    auto inserted = index.insert({toKey(tag), record});
+    if (!inserted.second) {
+        garbage += inserted.first->second.len;
+        inserted.first->second = record;
+    }
+    compactIfWasteful();
+}
+
+PKWError WrappedKeyStore::unwrap(const Record &record, const Tag &tag, vector<unsigned char> &out) const {
+    const unsigned char *p = mapping + record.offset;
+    const size_t headerLen = getU32(p + 4 + TAG_BYTES);
+    const unsigned char *header = p + RECORD_OVERHEAD;
+    return pkw.tryUnwrap(tag, header, headerLen, header + headerLen, record.len - RECORD_OVERHEAD - headerLen, out);
+}
+
+bool WrappedKeyStore::get(const Tag &tag, vector<unsigned char> &out) {
+    auto it = index.find(toKey(tag));
+    if (it == index.end()) {
+        return false;
+    }
+    PKWError error = unwrap(it->second, tag, out);
+    if (error != PKWError::None) {
+        throwPKWError(error);
+    }
+    return true;
+}
+
+size_t WrappedKeyStore::getRange(const Tag &from, const Tag &to,
+                                 const std::function<void(const Tag &, const vector<unsigned char> &)> &visitor) {
+    const IndexKey first = toKey(from);
+    const IndexKey last = toKey(to);
+    if (last < first) {
+        return 0;
+    }
+    vector<unsigned char> key;
+    size_t count = 0;
+    for (auto it = index.lower_bound(first); it != index.end() && !(last < it->first); ++it) {
+        Tag tag = fromKey(it->first);
+        if (unwrap(it->second, tag, key) == PKWError::None) {
+            visitor(tag, key);
+            ++count;
+        }
+    }
+    secure_memzero(key.data(), key.size());
+    return count;
+}
+
+void WrappedKeyStore::punc(const Tag &tag) {
+    pkw.punc(tag);
+    auto it = index.find(toKey(tag));
+    if (it != index.end()) {
+        drop(it);
+        compactIfWasteful();
+    }
+}
+
+void WrappedKeyStore::drop(std::map<IndexKey, Record>::iterator it) {
+    garbage += it->second.len;
+    index.erase(it);
+}
+
+bool WrappedKeyStore::contains(const Tag &tag) const {
+    return index.count(toKey(tag)) != 0;
+}
+
+size_t WrappedKeyStore::size() const {
+    return index.size();
+}
+
+size_t WrappedKeyStore::logBytes() const {
+    return end - sizeof(MAGIC);
+}
+
+size_t WrappedKeyStore::garbageBytes() const {
+    return garbage;
+}
+
+void WrappedKeyStore::compactIfWasteful() {
+    if (garbage >= COMPACT_MIN_GARBAGE && garbage > logBytes() - garbage) {
+        compact();
+    }
+}
+
+void WrappedKeyStore::compact() {
+    const std::string tmp = path + ".compact";
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    bool ok = out >= 0 && writeAll(out, MAGIC, sizeof(MAGIC));
+    for (auto it = index.begin(); ok && it != index.end(); ++it) {
+        if (!pkw.isPunctured(fromKey(it->first))) {
+            ok = writeAll(out, mapping + it->second.offset, it->second.len);
+        }
+    }
+    ok = ok && ::fsync(out) == 0;
+    if (out >= 0) {
+        ok = ::close(out) == 0 && ok;
+    }
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        throw ExportException();
+    }
+    close();
+    open();
+}
+
+void WrappedKeyStore::sync() {
+    if (msync(mapping, capacity, MS_SYNC) != 0 || ::fsync(fd) != 0) {
+        throw ExportException();
+    }
+}
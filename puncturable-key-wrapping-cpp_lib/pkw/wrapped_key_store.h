@@ -0,0 +1,152 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_WRAPPED_KEY_STORE_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_WRAPPED_KEY_STORE_H
+
+#include "pprf_aead_pkw.h"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A store of keys wrapped with a PPRF_AEAD_PKW, one per tag. Records (tag, header, ciphertext) are appended to a
+ * memory-mapped log file; an in-memory index orders the live records by tag. Puncturing a tag through the store
+ * drops its record from the index, and the log is compacted, dropping the records of punctured and replaced tags,
+ * once they take up more space than the live ones.
+ * <br>
+ * Records are durable after sync(). Not thread-safe.
+ */
+class WrappedKeyStore {
+    public:
+        /**
+         * Opens the log at path, creating it if it does not exist, and indexes the records whose tags are not
+         * punctured in pkw.
+         * @param pkw the PKW the keys are wrapped with; must outlive the store
+         * @param path the path of the log
+         * @throws ImportException if the log cannot be opened or is not a log
+         */
+        WrappedKeyStore(PPRF_AEAD_PKW &pkw, const std::string &path);
+
+        ~WrappedKeyStore();
+
+        WrappedKeyStore(const WrappedKeyStore &) = delete;
+        WrappedKeyStore &operator=(const WrappedKeyStore &) = delete;
+
+        /**
+         * Wraps key under tag and header and appends the record, replacing an earlier record of tag.
+         * @throws IllegalTagException if the tag is punctured or its size exceeds the tag length
+         * @throws ExportException if the log cannot grow
+         */
+        void put(const Tag &tag, const std::vector<unsigned char> &header, const std::vector<unsigned char> &key);
+
+        /**
+         * Looks up the record of tag and unwraps it into out. Does not allocate once out has the capacity for the key.
+         * @param tag the tag
+         * @param out receives the key
+         * @return false if there is no record of tag
+         * @throws IllegalTagException if tag was punctured without the store
+         * @throws UnwrappingException if the record is not authentic
+         */
+        bool get(const Tag &tag, std::vector<unsigned char> &out);
+
+        /**
+         * Unwraps the records with tags in [from, to] in tag order, reusing one buffer for the keys. Records that fail
+         * to unwrap, e.g. whose tags were punctured without the store, are skipped.
+         * @param from the first tag
+         * @param to the last tag
+         * @param visitor called with every tag and its key; the key is only valid during the call
+         * @return the number of records unwrapped
+         */
+        size_t getRange(const Tag &from, const Tag &to,
+                        const std::function<void(const Tag &, const std::vector<unsigned char> &)> &visitor);
+
+        /**
+         * Punctures pkw on tag and drops its record.
+         * @throws IllegalTagException if the size of the tag exceeds the tag length
+         */
+        void punc(const Tag &tag);
+
+        /**
+         * Tells whether there is a live record of tag.
+         */
+        bool contains(const Tag &tag) const;
+
+        /**
+         * Returns the number of live records.
+         */
+        size_t size() const;
+
+        /**
+         * Returns the bytes of the log taken up by records, live or not.
+         */
+        size_t logBytes() const;
+
+        /**
+         * Returns the bytes of the log taken up by records which are no longer live.
+         */
+        size_t garbageBytes() const;
+
+        /**
+         * Rewrites the log with the live records only, in tag order, also dropping records whose tags were punctured
+         * without the store. The new log replaces the old one atomically.
+         * @throws ExportException if the new log cannot be written
+         */
+        void compact();
+
+        /**
+         * Flushes appended records to the file.
+         * @throws ExportException if flushing fails
+         */
+        void sync();
+
+    private:
+        /* the tag's words, most significant first, so that the order of the array is the order of the tags */
+        typedef TagWords IndexKey;
+
+        struct Record {
+            size_t offset;
+            size_t len;
+        };
+
+        PPRF_AEAD_PKW &pkw;
+        std::string path;
+        int fd;
+        unsigned char *mapping;
+        size_t capacity;
+        size_t end;
+        size_t garbage;
+        std::map<IndexKey, Record> index;
+
+        static IndexKey toKey(const Tag &tag);
+        static Tag fromKey(const IndexKey &key);
+
+        void open();
+        void close();
+        void reserve(size_t bytes);
+        void scan();
+        void drop(std::map<IndexKey, Record>::iterator it);
+        void compactIfWasteful();
+        PKWError unwrap(const Record &record, const Tag &tag, std::vector<unsigned char> &out) const;
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_WRAPPED_KEY_STORE_H
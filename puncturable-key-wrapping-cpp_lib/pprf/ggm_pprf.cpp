@@ -19,111 +19,301 @@
  **********************************************************************************************************************/
 
 #include "ggm_pprf.h"
+#include "metrics.h"
 #include "pprf/pprf_exceptions.h"
 #include "pprf_key_serializer.h"
+#include "static_ggm_pprf.h"
 #include <bitset>
-#include <cryptopp/hkdf.h>
-#include <cryptopp/sha.h>
-#include <deque>
 
-static const std::vector<unsigned char> RIGHT({'r'});
-static const std::vector<unsigned char> LEFT({'l'});
+/**
+ * Type-erased interface to a StaticGGM_PPRF instantiation.
+ */
+class AbstractGGM_PPRF {
+    public:
+        virtual ~AbstractGGM_PPRF() = default;
+        virtual std::unique_ptr<AbstractGGM_PPRF> clone() const = 0;
+        virtual SecureByteBuffer eval(const TagWords &tag) const = 0;
+        virtual void eval(const TagWords &tag, byte *out) const = 0;
+        virtual PPRFStatus tryEval(const TagWords &tag, byte *out) const = 0;
+        virtual PPRFStatus status(const TagWords &tag) const = 0;
+        virtual void punc(const TagWords &tag) = 0;
+        virtual void puncPrefix(const TagWords &tag, int prefixLen) = 0;
+        virtual PPRFKey delegate(const TagWords &tag, int prefixLen) const = 0;
+        virtual void merge(const TagWords &tag, int prefixLen, const PPRFKey &delegated) = 0;
+        virtual int getNumPuncs() const = 0;
+        virtual size_t getNumNodes() const = 0;
+        virtual int tagLen() const = 0;
+        virtual int keyLen() const = 0;
+        virtual int arity() const = 0;
+        virtual PPRFKey toKey() const = 0;
+        virtual MemoryUsage memoryUsage() const = 0;
+        virtual MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed) const = 0;
+};
 
-GGM_PPRF::GGM_PPRF(PPRFKey key) : key(std::move(key)) {
+template<size_t TagBits, size_t KeyBits>
+class GGM_PPRFModel : public AbstractGGM_PPRF {
+    public:
+        using PPRF = StaticGGM_PPRF<TagBits, KeyBits>;
+
+        GGM_PPRFModel(const PPRFKey &key, int frontierDepth) : pprf(key, frontierDepth) {}
+
+        std::unique_ptr<AbstractGGM_PPRF> clone() const override {
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel(*this));
+        }
+        SecureByteBuffer eval(const TagWords &tag) const override {
+            SecureByteBuffer res(pprf.keyLen() / 8);
+            eval(tag, res.data());
+            return res;
+        }
+        void eval(const TagWords &tag, byte *out) const override {
+            if (tryEval(tag, out) != PPRFStatus::Ok) {
+                throw TagException();
+            }
+        }
+        PPRFStatus tryEval(const TagWords &tag, byte *out) const override {
+            typename PPRF::TagType t;
+            if (!PPRF::Tags::fromWords(tag, t)) {
+                return PPRFStatus::TagTooLarge;
+            }
+            typename PPRF::Value value = GGMValue<KeyBits>::make(pprf.keyLen() / 8);
+            PPRFStatus status = pprf.tryEval(t, value);
+            if (status == PPRFStatus::Ok) {
+                std::copy(value.begin(), value.end(), out);
+            }
+            return status;
+        }
+        PPRFStatus status(const TagWords &tag) const override {
+            typename PPRF::TagType t;
+            if (!PPRF::Tags::fromWords(tag, t)) {
+                return PPRFStatus::TagTooLarge;
+            }
+            return pprf.status(t);
+        }
+        void punc(const TagWords &tag) override {
+            pprf.punc(toTag(tag));
+        }
+        void puncPrefix(const TagWords &tag, int prefixLen) override {
+            pprf.puncPrefix(toTag(tag), prefixLen);
+        }
+        PPRFKey delegate(const TagWords &tag, int prefixLen) const override {
+            return pprf.delegate(toTag(tag), prefixLen);
+        }
+        void merge(const TagWords &tag, int prefixLen, const PPRFKey &delegated) override {
+            pprf.merge(toTag(tag), prefixLen, delegated);
+        }
+        int getNumPuncs() const override {
+            return pprf.getNumPuncs();
+        }
+        size_t getNumNodes() const override {
+            return pprf.getNumNodes();
+        }
+        int tagLen() const override {
+            return pprf.tagLen();
+        }
+        int keyLen() const override {
+            return pprf.keyLen();
+        }
+        int arity() const override {
+            return pprf.arity();
+        }
+        PPRFKey toKey() const override {
+            return pprf.toKey();
+        }
+        MemoryUsage memoryUsage() const override {
+            return addOwnFootprint(pprf.memoryUsage());
+        }
+        MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed) const override {
+            MemoryProjection projection = pprf.projectMemoryUsage(k, order, seed);
+            projection.usage = addOwnFootprint(projection.usage);
+            return projection;
+        }
+
+    private:
+        PPRF pprf;
+
+        static typename PPRF::TagType toTag(const TagWords &words) {
+            typename PPRF::TagType tag;
+            if (!PPRF::Tags::fromWords(words, tag)) {
+                throw TagException();
+            }
+            return tag;
+        }
+
+        /* the model itself is a heap block owned by GGM_PPRF */
+        MemoryUsage addOwnFootprint(MemoryUsage usage) const {
+            usage.containerBytes += sizeof(*this) - sizeof(pprf);
+            usage.slackBytes += heapChunkSize(sizeof(*this)) - sizeof(*this);
+            return usage;
+        }
+};
+
+template<size_t KeyBits>
+static std::unique_ptr<AbstractGGM_PPRF> makeForTagLen(const PPRFKey &key, int frontierDepth) {
+    switch (key.tagLen) {
+        case 16:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<16, KeyBits>(key, frontierDepth));
+        case 32:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<32, KeyBits>(key, frontierDepth));
+        case 64:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<64, KeyBits>(key, frontierDepth));
+        case 128:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<128, KeyBits>(key, frontierDepth));
+        case 256:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<256, KeyBits>(key, frontierDepth));
+        default:
+            return std::unique_ptr<AbstractGGM_PPRF>(new GGM_PPRFModel<DYNAMIC_LEN, KeyBits>(key, frontierDepth));
+    }
 }
-SecureByteBuffer GGM_PPRF::eval(Tag tag) {
-    long nodeIndex = findMatchingPrefix(tag);
-    if (nodeIndex < 0 || tagTooLarge(tag)) {
-        throw TagException();
+
+static std::unique_ptr<AbstractGGM_PPRF> makeImpl(const PPRFKey &key, int frontierDepth) {
+    switch (key.keyLen) {
+        case 128:
+            return makeForTagLen<128>(key, frontierDepth);
+        case 256:
+            return makeForTagLen<256>(key, frontierDepth);
+        default:
+            return makeForTagLen<DYNAMIC_LEN>(key, frontierDepth);
     }
-    SecretRoot &node = key.nodes[nodeIndex];
-
-    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
-    SecureByteBuffer res(node.getValue());
-    SecureByteBuffer derived(res);
-    for (size_t i = node.getPrefix().size(); i < key.tagLen; i++) {
-        Tag mask;
-        mask.set(key.tagLen - i - 1, true);
-        const std::vector<unsigned char> &direction = (mask & tag).count() > 0 ? RIGHT : LEFT;
-        hkdf.DeriveKey(derived.data(), derived.size(), res.data(), res.size(), nullptr, 0, direction.data(), direction.size());
-        res = derived;
+}
+
+GGM_PPRF::GGM_PPRF(PPRFKey key) : impl(makeImpl(key, 0)) {
+    trackNodes(1);
+}
+GGM_PPRF::GGM_PPRF(PPRFKey key, int frontierDepth) : impl(makeImpl(key, frontierDepth)) {
+    trackNodes(1);
+}
+GGM_PPRF::GGM_PPRF(const GGM_PPRF &other) : impl(other.impl->clone()) {
+    trackNodes(1);
+}
+GGM_PPRF::GGM_PPRF(GGM_PPRF &&other) noexcept = default;
+GGM_PPRF &GGM_PPRF::operator=(const GGM_PPRF &rhs) {
+    if (this != &rhs) {
+        trackNodes(-1);
+        impl = rhs.impl->clone();
+        trackNodes(1);
     }
-    return res;
-}
-bool GGM_PPRF::tagTooLarge(Tag &tag) const {
-    return (tag >> key.tagLen).count() > 0;
-}
-
-long GGM_PPRF::findMatchingPrefix(Tag tag) {
-    std::string tagString = tag.to_string().substr(MAX_TAG_LEN - key.tagLen, MAX_TAG_LEN);
-    long min = 0;
-    long max = key.nodes.size();
-    while (max > min) {
-        long index = (max + min) / 2;
-        std::string pref = key.nodes[index].getPrefix();
-        if (pref == tagString.substr(0, pref.length())) {
-            return index;
-        } else if (pref < tagString) {
-            min = index + 1;
-        } else {
-            max = index;
-        }
+    return *this;
+}
+GGM_PPRF &GGM_PPRF::operator=(GGM_PPRF &&rhs) noexcept {
+    if (this != &rhs) {
+        trackNodes(-1);
+        impl = std::move(rhs.impl);
     }
-    return -1;
+    return *this;
+}
+GGM_PPRF::~GGM_PPRF() {
+    trackNodes(-1);
 }
 
-void GGM_PPRF::punc(std::bitset<MAX_TAG_LEN> tag) {
-    if ((tag >> key.tagLen).count() > 0) {
-        throw TagException();
+void GGM_PPRF::trackNodes(int64_t sign) {
+    if (impl) {
+        auto nodes = static_cast<int64_t>(impl->getNumNodes());
+        PKWMetrics::instance().addNodes(sign * nodes, sign * nodes * (impl->keyLen() / 8));
     }
-    long nodeIndex = findMatchingPrefix(tag);
-    if (nodeIndex < 0) {
-        return; /* already punctured */
+}
+
+SecureByteBuffer GGM_PPRF::eval(const Tag &tag) {
+    return impl->eval(toWords(tag));
+}
+
+void GGM_PPRF::eval(const Tag &tag, byte *out) {
+    impl->eval(toWords(tag), out);
+}
+
+PPRFStatus GGM_PPRF::tryEval(const Tag &tag, byte *out) {
+    return impl->tryEval(toWords(tag), out);
+}
+
+bool GGM_PPRF::isPunctured(const Tag &tag) {
+    PPRFStatus status = impl->status(toWords(tag));
+    if (status == PPRFStatus::TagTooLarge) {
+        throw TagException();
     }
-    SecretRoot &node = key.nodes[nodeIndex];
-    key.puncs += 1;
-    std::vector<SecretRoot> coPath;
-    evalAndGetCoPath(tag, node, coPath);
-    key.nodes.erase(key.nodes.begin() + nodeIndex);
-    key.nodes.insert(key.nodes.begin() + nodeIndex, coPath.begin(), coPath.end());
-}
-
-SecureByteBuffer GGM_PPRF::evalAndGetCoPath(Tag tag, const SecretRoot &node, std::vector<SecretRoot> &coPath) const {
-    const int keyLenByte = key.keyLen / 8;
-    CryptoPP::HKDF<CryptoPP::SHA256> hkdf;
-
-    std::deque<SecretRoot> left;
-    std::deque<SecretRoot> right;
-
-    SecureByteBuffer curr(node.getValue());
-    SecureByteBuffer derived_right(keyLenByte);
-    SecureByteBuffer derived_left(keyLenByte);
-    std::string pref = node.getPrefix();
-    for (size_t i = node.getPrefix().size(); i < key.tagLen; i++) {
-        Tag mask;
-        mask.set(key.tagLen - i - 1, true);
-        hkdf.DeriveKey(derived_right.data(), derived_right.size(), curr.data(), curr.size(), nullptr, 0, RIGHT.data(), RIGHT.size());
-        hkdf.DeriveKey(derived_left.data(), derived_left.size(), curr.data(), curr.size(), nullptr, 0, LEFT.data(), LEFT.size());
-        if ((mask & tag).count() > 0) {
-            left.emplace_back(pref + "0", derived_left);
-            curr = derived_right;
-            pref += "1";
-        } else {
-            right.emplace_front(pref + "1", derived_right);
-            curr = derived_left;
-            pref += "0";
-        }
+    return status == PPRFStatus::Punctured;
+}
+
+void GGM_PPRF::punc(const Tag &tag) {
+    auto before = static_cast<int64_t>(impl->getNumNodes());
+    impl->punc(toWords(tag));
+    auto delta = static_cast<int64_t>(impl->getNumNodes()) - before;
+    PKWMetrics::instance().addNodes(delta, delta * (impl->keyLen() / 8));
+}
+
+void GGM_PPRF::puncPrefix(const Tag &tag, int prefixLen) {
+    auto before = static_cast<int64_t>(impl->getNumNodes());
+    impl->puncPrefix(toWords(tag), prefixLen);
+    auto delta = static_cast<int64_t>(impl->getNumNodes()) - before;
+    PKWMetrics::instance().addNodes(delta, delta * (impl->keyLen() / 8));
+}
+
+PPRFKey GGM_PPRF::delegate(const Tag &tag, int prefixLen) const {
+    return impl->delegate(toWords(tag), prefixLen);
+}
+
+void GGM_PPRF::merge(const Tag &tag, int prefixLen, const PPRFKey &delegated) {
+    auto before = static_cast<int64_t>(impl->getNumNodes());
+    impl->merge(toWords(tag), prefixLen, delegated);
+    auto delta = static_cast<int64_t>(impl->getNumNodes()) - before;
+    PKWMetrics::instance().addNodes(delta, delta * (impl->keyLen() / 8));
+}
+
+TagWords GGM_PPRF::toWords(const Tag &tag) {
+    static const Tag WORD_MASK(~0ULL);
+    TagWords words{};
+    for (size_t w = 0; w < words.size(); ++w) {
+        words[w] = ((tag >> (64 * w)) & WORD_MASK).to_ullong();
     }
-    coPath.insert(coPath.end(), left.begin(), left.end());
-    coPath.insert(coPath.end(), right.begin(), right.end());
-    return curr;
+    return words;
+}
+MemoryUsage GGM_PPRF::memoryUsage() const {
+    MemoryUsage usage = impl->memoryUsage();
+    usage.containerBytes += sizeof(*this);
+    return usage;
 }
+
+MemoryProjection GGM_PPRF::projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed) const {
+    MemoryProjection projection = impl->projectMemoryUsage(k, order, seed);
+    projection.usage.containerBytes += sizeof(*this);
+    return projection;
+}
+
 int GGM_PPRF::getNumPuncs() {
-    return key.puncs;
+    return impl->getNumPuncs();
+}
+size_t GGM_PPRF::getNumNodes() {
+    return impl->getNumNodes();
 }
 int GGM_PPRF::tagLen() {
-    return key.tagLen;
+    return impl->tagLen();
+}
+int GGM_PPRF::keyLen() const {
+    return impl->keyLen();
+}
+int GGM_PPRF::arity() const {
+    return impl->arity();
 }
 SecureByteBuffer GGM_PPRF::serializeKey() {
-    return key.serialize();
-}
\ No newline at end of file
+    return impl->toKey().serialize();
+}
+
+GGM_PPRFSnapshot GGM_PPRF::snapshot() const {
+    return GGM_PPRFSnapshot(std::shared_ptr<const AbstractGGM_PPRF>(impl->clone()));
+}
+
+GGM_PPRFSnapshot::GGM_PPRFSnapshot(std::shared_ptr<const AbstractGGM_PPRF> impl) : impl(std::move(impl)) {}
+
+SecureByteBuffer GGM_PPRFSnapshot::eval(const Tag &tag) const {
+    return impl->eval(GGM_PPRF::toWords(tag));
+}
+int GGM_PPRFSnapshot::getNumPuncs() const {
+    return impl->getNumPuncs();
+}
+size_t GGM_PPRFSnapshot::getNumNodes() const {
+    return impl->getNumNodes();
+}
+int GGM_PPRFSnapshot::tagLen() const {
+    return impl->tagLen();
+}
+SecureByteBuffer GGM_PPRFSnapshot::serializeKey() const {
+    return impl->toKey().serialize();
+}
@@ -21,8 +21,12 @@
 #ifndef PUNCTURABLE_KEY_WRAPPING_CPP_GGM_PPRF_H
 #define PUNCTURABLE_KEY_WRAPPING_CPP_GGM_PPRF_H
 #include "ggm_pprf_key.h"
+#include "memory_usage.h"
 #include "secure_byte_buffer.h"
+#include <array>
 #include <bitset>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,12 +34,33 @@
 static const size_t MAX_TAG_LEN = 256;
 using Tag = std::bitset<MAX_TAG_LEN>;
 using byte = unsigned char;
+/**
+ * A tag as little-endian 64-bit words: bit i of the tag is bit i % 64 of word i / 64.
+ */
+using TagWords = std::array<uint64_t, MAX_TAG_LEN / 64>;
+
+class AbstractGGM_PPRF;
+
+/**
+ * Outcome of the PPRF operations that report errors without throwing.
+ */
+enum class PPRFStatus {
+    Ok,
+    /* the tag exceeds the key's tag length */
+    TagTooLarge,
+    /* the PPRF was punctured on the tag */
+    Punctured
+};
+class GGM_PPRFSnapshot;
 
 /**
  * Implements a Puncturable Pseudo-Random Function (PPRF) using the Goldreich, Goldwasser & Micali (GGM) construction.
  *
  * <div class="csl-entry">Goldreich, O., Goldwasser, S., &#38; Micali, S. (1986). How to construct random functions. <i>Journal of the ACM (JACM)</i>, <i>33</i>(4), 792–807. https://doi.org/10.1145/6490.6503</div>
 * <br>
+ * The tag and key lengths and the arity of the tree (recorded in the key) are runtime parameters. Common combinations
+ * of tag lengths (16, 32, 64, 128 and 256) and key lengths (128 and 256) are dispatched to a StaticGGM_PPRF
+ * instantiation, see static_ggm_pprf.h.
  */
 class GGM_PPRF {
     public:
@@ -44,7 +69,39 @@ class GGM_PPRF {
          * @param tag the tag on which the PPRF is to be punctured
          * @throws IllegalTagException if the size of the tag exceeds the key's tag length..
          */
-        void punc(Tag tag);
+        void punc(const Tag &tag);
+
+        /**
+         * Punctures the PPRF on all tags sharing the first prefixLen bits with tag, replacing the nodes of that subtree
+         * by at most prefixLen co-path nodes. Counts as one puncture.
+         * @param tag any tag of the subtree
+         * @param prefixLen the length of the common prefix
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         */
+        void puncPrefix(const Tag &tag, int prefixLen);
+
+        /**
+         * Exports a key for the subtree of all tags sharing the first prefixLen bits with tag, e.g. to let a worker
+         * wrap and unwrap within that slice of the tag space only. The key holds the nodes inside the subtree, or the
+         * subtree's root derived from the node above it; it evaluates like this key there and is punctured elsewhere.
+         * @param tag any tag of the subtree
+         * @param prefixLen the length of the common prefix
+         * @return a standalone key with this key's tag length and arity and no punctures
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         */
+        PPRFKey delegate(const Tag &tag, int prefixLen) const;
+
+        /**
+         * Takes over the punctures of a key obtained from delegate(tag, prefixLen): afterwards a tag of the subtree
+         * can be evaluated iff both keys could evaluate it, tags outside it are unaffected. Punctures made here since
+         * the delegation are kept. The delegated key's punctures are added to getNumPuncs, so merge each key once.
+         * @param tag any tag of the subtree
+         * @param prefixLen the length of the common prefix
+         * @param delegated the delegated key
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         * @throws InitializationException if the delegated key does not stem from this key's subtree
+         */
+        void merge(const Tag &tag, int prefixLen, const PPRFKey &delegated);
 
         /**
          * Evaluates the PPRF on input tag and returns the result of the evaluation.
@@ -52,35 +109,150 @@ class GGM_PPRF {
          * @return a SecureByteBuffer
          * @throws IllegalTagException if the PPRF was punctured on tag or the size of the tag exceeds the key's tag length.
          */
-        SecureByteBuffer eval(Tag tag);
+        SecureByteBuffer eval(const Tag &tag);
+
+        /**
+         * Evaluates the PPRF on input tag into a caller-supplied buffer. Does not allocate for the key lengths
+         * dispatched to a StaticGGM_PPRF with a fixed key length (128 and 256).
+         * @param tag the tag
+         * @param out receives keyLen() / 8 bytes
+         * @throws TagException if the PPRF was punctured on tag or the size of the tag exceeds the key's tag length.
+         */
+        void eval(const Tag &tag, byte *out);
+
+        /**
+         * Evaluates the PPRF on input tag into a caller-supplied buffer without throwing.
+         * @param tag the tag
+         * @param out receives keyLen() / 8 bytes if the result is PPRFStatus::Ok
+         * @return whether tag could be evaluated
+         */
+        PPRFStatus tryEval(const Tag &tag, byte *out);
+
+        /**
+         * Tells whether the PPRF was punctured on tag, from the node index alone (no derivation).
+         * @param tag the tag
+         * @return true iff tag was punctured
+         * @throws TagException if the size of the tag exceeds the key's tag length.
+         */
+        bool isPunctured(const Tag &tag);
         /**
          * Constructs a PPRF instance using the key.
          * @param key the key
+         * @throws InitializationException if the tag length exceeds MAX_TAG_LEN or the nodes do not fit the key
          */
         explicit GGM_PPRF(PPRFKey key);
+        /**
+         * Constructs a PPRF instance using the key, expanded to its 2^frontierDepth nodes at depth frontierDepth.
+         * Evaluations then look their node up in a table and derive only the levels below it, at the cost of the
+         * table's memory. The depth is not part of serialized keys; pass it again when deserializing.
+         * @param key the key
+         * @param frontierDepth the depth of the frontier, a multiple of log2(arity) of at most the tag length and 24
+         * @throws InitializationException if the tag length exceeds MAX_TAG_LEN, the nodes do not fit the key or
+         * frontierDepth is not supported
+         */
+        GGM_PPRF(PPRFKey key, int frontierDepth);
+        GGM_PPRF(const GGM_PPRF &other);
+        GGM_PPRF(GGM_PPRF &&other) noexcept;
+        GGM_PPRF &operator=(const GGM_PPRF &rhs);
+        GGM_PPRF &operator=(GGM_PPRF &&rhs) noexcept;
+        ~GGM_PPRF();
         /**
          * Getter for number of punctures performed on the PPRF.
          * @return number of punctures
          */
         int getNumPuncs();
+        /**
+         * Getter for the number of subtree roots the key currently consists of.
+         * @return number of nodes
+         */
+        size_t getNumNodes();
         /**
          * Getter the tag length of PPRF
          * @return tag length
          */
         int tagLen();
 
+        /**
+         * Getter the key length of PPRF
+         * @return key length in bits
+         */
+        int keyLen() const;
+
+        /**
+         * Getter for the arity of the GGM tree, see PPRFKey::checkArity
+         * @return the number of children per node
+         */
+        int arity() const;
+
         /**
          * Serializes the key.
          * @return a secureByteBuffer holding the serialized key.
          */
         SecureByteBuffer serializeKey();
 
+        /**
+         * Returns the memory held by the key, including allocator overhead, and the depths of its nodes.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+        /**
+         * Estimates nodes, memory and serialized size after k further punctures, without modifying the key.
+         * @param k the number of punctures
+         * @param order which tags are punctured
+         * @param seed seed for the tags drawn by PunctureOrder::Random
+         * @return the projection
+         */
+        MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed = 0) const;
+
+        /**
+         * Takes an immutable view of the current key in O(1). Nodes are shared with this instance until a later
+         * puncture replaces them, so the snapshot can be serialized (e.g. checkpointed) on another thread while
+         * punctures continue here. Nodes held only by the snapshot are zeroized when it is destroyed.
+         * @return the snapshot
+         */
+        GGM_PPRFSnapshot snapshot() const;
+
+        /**
+         * Converts a tag into its word representation.
+         * @param tag the tag
+         * @return the words of the tag, least significant first
+         */
+        static TagWords toWords(const Tag &tag);
+
     private:
-        PPRFKey key;
-        long findMatchingPrefix(Tag tag);
-        SecureByteBuffer evalAndGetCoPath(Tag tag, const SecretRoot &node, std::vector<SecretRoot> &coPath) const;
-        bool tagTooLarge(Tag &tag) const;
+        std::unique_ptr<AbstractGGM_PPRF> impl;
+        /* adds (sign = 1) or removes (sign = -1) the nodes of this instance to or from the metrics gauges */
+        void trackNodes(int64_t sign);
 };
 
+/**
+ * An immutable copy-on-write view of a GGM_PPRF key, see GGM_PPRF::snapshot. Safe to use concurrently with the
+ * GGM_PPRF it was taken from.
+ */
+class GGM_PPRFSnapshot {
+    public:
+        /**
+         * Evaluates the PPRF as of the snapshot on input tag.
+         * @param tag the tag
+         * @return a SecureByteBuffer
+         * @throws TagException if the PPRF was punctured on tag or the size of the tag exceeds the key's tag length.
+         */
+        SecureByteBuffer eval(const Tag &tag) const;
+        int getNumPuncs() const;
+        size_t getNumNodes() const;
+        int tagLen() const;
+
+        /**
+         * Serializes the key as of the snapshot, in the format of GGM_PPRF::serializeKey.
+         * @return a secureByteBuffer holding the serialized key.
+         */
+        SecureByteBuffer serializeKey() const;
+
+    private:
+        friend class GGM_PPRF;
+        explicit GGM_PPRFSnapshot(std::shared_ptr<const AbstractGGM_PPRF> impl);
+        std::shared_ptr<const AbstractGGM_PPRF> impl;
+};
 
-#endif//PUNCTURABLE_KEY_WRAPPING_CPP_GGM_PPRF_H
\ No newline at end of file
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_GGM_PPRF_H
@@ -21,12 +21,15 @@
 #include "ggm_pprf_key.h"
 #include "pprf_exceptions.h"
 #include "pprf_key_serializer.h"
+#include <algorithm>
+#include <cryptopp/osrng.h>
 
 
-PPRFKey::PPRFKey(int keyLen, int tagLen, int puncs, std::vector<SecretRoot> nodes) : keyLen(keyLen), tagLen(tagLen), puncs(puncs), nodes(std::move(nodes)) {
+PPRFKey::PPRFKey(int keyLen, int tagLen, int puncs, std::vector<SecretRoot> nodes, int arity) : keyLen(keyLen), tagLen(tagLen), puncs(puncs), arity(arity),
+                                                                                             nodes(std::move(nodes)) {
     std::sort(this->nodes.begin(), this->nodes.end(), [](auto &n1, auto &n2) -> bool { return n1.getPrefix() < n2.getPrefix(); });
 }
-PPRFKey::PPRFKey() {}
+PPRFKey::PPRFKey() : arity(GGM_BINARY) {}
 
 SecureByteBuffer PPRFKey::serialize() {
     return PPRFKeySerializer(*this).serialize();
@@ -34,9 +37,41 @@ SecureByteBuffer PPRFKey::serialize() {
 PPRFKey PPRFKey::fromSerialized(SecureByteBuffer &serialized) {
     return PPRFKeySerializer::deserialize(serialized);
 }
-PPRFKey::PPRFKey(int keyLen, int tagLen) : keyLen(keyLen), tagLen(tagLen), puncs(0) {
+PPRFKey::PPRFKey(int keyLen, int tagLen, int arity) : keyLen(keyLen), tagLen(tagLen), puncs(0), arity(arity) {
     if (!(keyLen > 0 && tagLen > 0)) {
         throw InitializationException();
     }
+    checkArity(keyLen, tagLen, arity);
     nodes.emplace_back("", SecureByteBuffer(keyLen / 8));
-}
\ No newline at end of file
+}
+
+int PPRFKey::checkArity(int keyLen, int tagLen, int arity) {
+    int bits;
+    switch (arity) {
+        case 2:
+            return 1;
+        case 4:
+            bits = 2;
+            break;
+        case 16:
+            bits = 4;
+            break;
+        case 256:
+            bits = 8;
+            break;
+        default:
+            throw InitializationException();
+    }
+    if ((keyLen != 128 && keyLen != 256) || tagLen % bits != 0) {
+        throw InitializationException();
+    }
+    return bits;
+}
+
+PPRFKey PPRFKey::generate(int keyLen, int tagLen, int arity) {
+    PPRFKey key(keyLen, tagLen, arity);
+    SecureByteBuffer root(keyLen / 8);
+    CryptoPP::OS_GenerateRandomBlock(true, root.data(), root.size());
+    key.nodes[0] = SecretRoot("", root);
+    return key;
+}
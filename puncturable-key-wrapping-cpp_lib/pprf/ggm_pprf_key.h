@@ -23,6 +23,9 @@
 
 #include "secret_root.h"
 #include <vector>
+
+/** arity of the binary GGM tree, the default */
+static const int GGM_BINARY = 2;
 /*
  * This class maintains an ordering on the nodes. The vector containing the nodes should always be ordered lexicographically.
  */
@@ -32,8 +35,30 @@ class PPRFKey {
          * Creates a fresh instance of a PPRFKey.
          * @param keyLen the size of the key space in number of bits
          * @param tagLen the size of the tag space in number of bits
+         * @param arity the number of children per node of the GGM tree, see checkArity
+         * @throws InitializationException if the parameters are not supported
          */
-        PPRFKey(int keyLen, int tagLen);
+        PPRFKey(int keyLen, int tagLen, int arity = GGM_BINARY);
+
+        /**
+         * Creates a fresh PPRFKey whose root is drawn from the operating system's random number generator.
+         * @param keyLen the size of the key space in number of bits
+         * @param tagLen the size of the tag space in number of bits
+         * @param arity the number of children per node of the GGM tree, see checkArity
+         * @return the key
+         */
+        static PPRFKey generate(int keyLen, int tagLen, int arity = GGM_BINARY);
+
+        /**
+         * Checks the arity of a GGM tree. Binary trees take any key length; 4-, 16- and 256-ary trees expand nodes
+         * with AES and need 128 or 256 bit keys. Every level consumes log2(arity) tag bits, which must divide tagLen.
+         * @param keyLen the size of the key space in number of bits
+         * @param tagLen the size of the tag space in number of bits
+         * @param arity the number of children per node
+         * @return the number of tag bits per level
+         * @throws InitializationException if the combination is not supported
+         */
+        static int checkArity(int keyLen, int tagLen, int arity);
 
         /**
          * Constructs a PPRFKey from a serialized byte string
@@ -48,8 +73,9 @@ class PPRFKey {
          * @param tagLen the size of the tag space in number of bits
          * @param puncs the number of punctures already performed
          * @param nodes a vector of SecretRoots, defining their respective subtrees
+         * @param arity the number of children per node of the GGM tree
          */
-        PPRFKey(int keyLen, int tagLen, int puncs, std::vector<SecretRoot> nodes);
+        PPRFKey(int keyLen, int tagLen, int puncs, std::vector<SecretRoot> nodes, int arity = GGM_BINARY);
         /**
          * A default constructor, creating an empty key. Used for deserialization.
          */
@@ -66,6 +92,10 @@ class PPRFKey {
          * the number of punctures performed on the PPRF using this key
          */
         int puncs;
+        /**
+         * the number of children per node of the GGM tree
+         */
+        int arity;
         /* Invariant: nodes are ordered lexicographically */
         std::vector<SecretRoot> nodes;
 
@@ -19,43 +19,218 @@
  **********************************************************************************************************************/
 
 #include "pprf_key_serializer.h"
+#include "metrics.h"
 #include "pprf/pprf_exceptions.h"
 #include "secret_root.h"
-#include <arpa/inet.h>
-
-SecureByteBuffer PPRFKeySerializer::serialize() {
-    SecureByteBuffer buffer = SecureByteBuffer();
-    std::vector<unsigned char> &underlyingBuffer = buffer.vec;
-    writeInteger(underlyingBuffer, keyToSerialize.tagLen);
-    writeInteger(underlyingBuffer, keyToSerialize.keyLen);
-    writeInteger(underlyingBuffer, keyToSerialize.puncs);
-    writeInteger(underlyingBuffer, keyToSerialize.nodes.size());
-    for (auto &node: keyToSerialize.nodes) {
-        writeNode(underlyingBuffer, node);
+#include "tracing.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+static const unsigned char MAGIC[] = {'P', 'P', 'K'};
+static const unsigned char VERSION_BINARY = 2;
+static const unsigned char VERSION_ARITY = 3;
+/* the header of version 2; version 3 appends the arity */
+const size_t PPRFKeySerializer::HEADER_LEN = sizeof(MAGIC) + 1 + 4 + 4 + 8 + 8 + 4 + 4;
+static const size_t ARITY_BYTES = 4;
+/* prefix length field of a node */
+static const size_t PREFIX_LEN_BYTES = 2;
+
+PPRFKeySerializer::PPRFKeySerializer(PPRFKey keyToSerialize, size_t blockNodes) : keyToSerialize(std::move(keyToSerialize)), blockNodes(blockNodes) {
+    if (blockNodes == 0 || blockNodes > UINT32_MAX) {
+        throw std::invalid_argument("block size out of range");
+    }
+}
+
+SecureByteBuffer PPRFKeySerializer::serialize(unsigned threads) {
+    MetricsTimer timer(MetricOp::Serialize);
+    PKW_TRACE_SPAN(TraceOp::Serialize, keyToSerialize.tagLen, keyToSerialize.nodes.size());
+    const std::vector<SecretRoot> &nodes = keyToSerialize.nodes;
+    const size_t keyBytes = keyToSerialize.keyLen / 8;
+    const size_t numBlocks = blockCount(nodes.size(), blockNodes);
+    if (numBlocks > UINT32_MAX) {
+        throw InitializationException();
+    }
+    /* block offsets first, so the output can be allocated once and the blocks filled independently */
+    const size_t header = headerLen(keyToSerialize.arity);
+    std::vector<size_t> offsets(numBlocks + 1);
+    offsets[0] = header + numBlocks * sizeof(uint64_t);
+    for (size_t block = 0; block < numBlocks; ++block) {
+        size_t size = 0;
+        const size_t last = std::min(nodes.size(), (block + 1) * blockNodes);
+        for (size_t i = block * blockNodes; i < last; ++i) {
+            if (nodes[i].getPrefix().size() > UINT16_MAX || nodes[i].getValue().size() != keyBytes) {
+                throw InitializationException();
+            }
+            size += PREFIX_LEN_BYTES + nodes[i].getPrefix().size() + keyBytes;
+        }
+        offsets[block + 1] = offsets[block] + size;
     }
+
+    SecureByteBuffer buffer(offsets[numBlocks]);
+    unsigned char *out = buffer.data();
+    std::copy(std::begin(MAGIC), std::end(MAGIC), out);
+    out[3] = keyToSerialize.arity == GGM_BINARY ? VERSION_BINARY : VERSION_ARITY;
+    writeUInt(out + 4, keyToSerialize.tagLen, 4);
+    writeUInt(out + 8, keyToSerialize.keyLen, 4);
+    writeUInt(out + 12, keyToSerialize.puncs, 8);
+    writeUInt(out + 20, nodes.size(), 8);
+    writeUInt(out + 28, blockNodes, 4);
+    writeUInt(out + 32, numBlocks, 4);
+    if (header > HEADER_LEN) {
+        writeUInt(out + HEADER_LEN, keyToSerialize.arity, ARITY_BYTES);
+    }
+    for (size_t block = 0; block < numBlocks; ++block) {
+        writeUInt(out + header + block * sizeof(uint64_t), offsets[block], 8);
+    }
+    forEachBlock(numBlocks, threads, [&](size_t block) {
+        unsigned char *p = out + offsets[block];
+        const size_t last = std::min(nodes.size(), (block + 1) * blockNodes);
+        for (size_t i = block * blockNodes; i < last; ++i) {
+            const std::string &prefix = nodes[i].getPrefix();
+            writeUInt(p, prefix.size(), PREFIX_LEN_BYTES);
+            p += PREFIX_LEN_BYTES;
+            std::memcpy(p, prefix.data(), prefix.size());
+            p += prefix.size();
+            std::memcpy(p, nodes[i].getValue().data(), keyBytes);
+            p += keyBytes;
+        }
+    });
     return buffer;
 }
 
-PPRFKey PPRFKeySerializer::deserialize(SecureByteBuffer &serialized) {
+size_t PPRFKeySerializer::serializedSize(int keyLen, const std::vector<size_t> &depthHistogram, int arity) {
+    size_t numNodes = 0;
+    size_t size = 0;
+    for (size_t prefixLen = 0; prefixLen < depthHistogram.size(); ++prefixLen) {
+        numNodes += depthHistogram[prefixLen];
+        size += depthHistogram[prefixLen] * (PREFIX_LEN_BYTES + prefixLen + keyLen / 8);
+    }
+    return headerLen(arity) + blockCount(numNodes, PPRF_KEY_BLOCK_NODES) * sizeof(uint64_t) + size;
+}
+
+size_t PPRFKeySerializer::headerLen(int arity) {
+    return arity == GGM_BINARY ? HEADER_LEN : HEADER_LEN + ARITY_BYTES;
+}
+
+PPRFKey PPRFKeySerializer::deserialize(const SecureByteBuffer &serialized, unsigned threads) {
+    MetricsTimer timer(MetricOp::Deserialize);
+    PKW_TRACE_SPAN(TraceOp::Deserialize, 0, 0);
+    if (isBlocked(serialized)) {
+        return deserializeBlocked(serialized, threads);
+    }
+    return deserializeLegacy(serialized);
+}
+
+bool PPRFKeySerializer::isBlocked(const SecureByteBuffer &serialized) {
+    /* the previous format starts with the tag length as a 64 bit integer, i.e. with a zero byte */
+    return serialized.size() > sizeof(MAGIC) && std::equal(std::begin(MAGIC), std::end(MAGIC), serialized.data()) &&
+           (serialized.data()[3] == VERSION_BINARY || serialized.data()[3] == VERSION_ARITY);
+}
+
+PPRFKey PPRFKeySerializer::deserializeBlocked(const SecureByteBuffer &serialized, unsigned threads) {
+    const uint64_t tagLen = readUInt(serialized, 4, 4);
+    const uint64_t keyLen = readUInt(serialized, 8, 4);
+    const uint64_t puncs = readUInt(serialized, 12, 8);
+    const uint64_t numNodes = readUInt(serialized, 20, 8);
+    const uint64_t blockNodes = readUInt(serialized, 28, 4);
+    const uint64_t numBlocks = readUInt(serialized, 32, 4);
+    const bool hasArity = serialized.data()[3] == VERSION_ARITY;
+    const uint64_t arity = hasArity ? readUInt(serialized, HEADER_LEN, ARITY_BYTES) : GGM_BINARY;
+    if (arity > INT_MAX || tagLen == 0 || tagLen > INT_MAX || keyLen == 0 || keyLen > INT_MAX || puncs > INT_MAX || blockNodes == 0) {
+        throw PPRFDeserializationError();
+    }
+    const size_t keyBytes = keyLen / 8;
+    const size_t tableEnd = (hasArity ? HEADER_LEN + ARITY_BYTES : HEADER_LEN) + numBlocks * sizeof(uint64_t);
+    /* bound the node count by the input before allocating */
+    if (tableEnd > serialized.size() || numNodes > (serialized.size() - tableEnd) / (PREFIX_LEN_BYTES + keyBytes) ||
+        numBlocks != blockCount(numNodes, blockNodes)) {
+        throw PPRFDeserializationError();
+    }
+    std::vector<size_t> offsets(numBlocks + 1);
+    for (size_t block = 0; block < numBlocks; ++block) {
+        offsets[block] = readUInt(serialized, tableEnd - (numBlocks - block) * sizeof(uint64_t), 8);
+        if (offsets[block] < (block == 0 ? tableEnd : offsets[block - 1]) || offsets[block] > serialized.size()) {
+            throw PPRFDeserializationError();
+        }
+    }
+    offsets[numBlocks] = serialized.size();
+    if (numBlocks > 0 && offsets[0] != tableEnd) {
+        throw PPRFDeserializationError();
+    }
+
+    std::vector<SecretRoot> nodes(numNodes);
+    forEachBlock(numBlocks, threads, [&](size_t block) {
+        const unsigned char *data = serialized.data();
+        size_t offset = offsets[block];
+        const size_t end = offsets[block + 1];
+        const size_t first = block * blockNodes;
+        const size_t last = std::min<size_t>(numNodes, first + blockNodes);
+        for (size_t i = first; i < last; ++i) {
+            if (end - offset < PREFIX_LEN_BYTES) {
+                throw PPRFDeserializationError();
+            }
+            const size_t prefixLen = readUInt(serialized, offset, PREFIX_LEN_BYTES);
+            offset += PREFIX_LEN_BYTES;
+            if (end - offset < prefixLen + keyBytes) {
+                throw PPRFDeserializationError();
+            }
+            /* filled in place: copying a SecureByteBuffer allocates */
+            SecretRoot &node = nodes[i];
+            node.prefix.assign(reinterpret_cast<const char *>(data + offset), prefixLen);
+            offset += prefixLen;
+            node.value.vec.assign(data + offset, data + offset + keyBytes);
+            offset += keyBytes;
+            if (i > first && !(nodes[i - 1].prefix < node.prefix)) {
+                throw PPRFDeserializationError();
+            }
+        }
+        if (offset != end) {
+            throw PPRFDeserializationError();
+        }
+    });
+    for (size_t block = 1; block < numBlocks; ++block) {
+        if (!(nodes[block * blockNodes - 1].prefix < nodes[block * blockNodes].prefix)) {
+            throw PPRFDeserializationError();
+        }
+    }
+    /* nodes are already ordered, so the sorting constructor is not needed */
+    PPRFKey key;
+    key.tagLen = (int) tagLen;
+    key.keyLen = (int) keyLen;
+    key.puncs = (int) puncs;
+    key.arity = (int) arity;
+    key.nodes.swap(nodes);
+    return key;
+}
+
+PPRFKey PPRFKeySerializer::deserializeLegacy(const SecureByteBuffer &serialized) {
     size_t offset = 0;
-    int tagLen = getInt(serialized, offset);
+    int tagLen = (int) readUInt(serialized, offset, 8);
     offset += sizeof(uint64_t);
-    int keyLen = getInt(serialized, offset);
+    int keyLen = (int) readUInt(serialized, offset, 8);
     offset += sizeof(uint64_t);
-    int puncs = getInt(serialized, offset);
+    int puncs = (int) readUInt(serialized, offset, 8);
     offset += sizeof(uint64_t);
-    size_t numNodes = getSize(serialized, offset);
+    size_t numNodes = readUInt(serialized, offset, 8);
     offset += sizeof(uint64_t);
+    const size_t keyBytes = keyLen / 8;
     std::vector<SecretRoot> nodes;
-    for (int i = 0; i < numNodes; ++i) {
-        size_t stringSize = getSize(serialized, offset);
-        offset += sizeof(size_t);
-        std::string prefix = getString(serialized, offset, stringSize);
-        offset += stringSize;
-        int keyBytes = keyLen / 8;
-        SecureByteBuffer value = copyValue(serialized, offset, keyBytes);
-        offset += keyBytes;
-        nodes.emplace_back(prefix, value);
+    for (size_t i = 0; i < numNodes; ++i) {
+        size_t stringSize = readUInt(serialized, offset, 8);
+        offset += sizeof(uint64_t);
+        if (stringSize > serialized.size() - offset || keyBytes > serialized.size() - offset - stringSize) {
+            throw PPRFDeserializationError();
+        }
+        const unsigned char *data = serialized.data() + offset;
+        std::vector<unsigned char> value(data + stringSize, data + stringSize + keyBytes);
+        nodes.emplace_back(std::string(data, data + stringSize), SecureByteBuffer(value));
+        offset += stringSize + keyBytes;
     }
     if (offset != serialized.size()) {
         throw PPRFDeserializationError();
@@ -63,56 +238,67 @@ PPRFKey PPRFKeySerializer::deserialize(SecureByteBuffer &serialized) {
     return {keyLen, tagLen, puncs, nodes};
 }
 
-
-void PPRFKeySerializer::writeNode(std::vector<unsigned char> &buffer, const SecretRoot &node) {
-    writeInteger(buffer, node.getPrefix().size());
-    copy(buffer, (unsigned char *) node.getPrefix().c_str(), node.getPrefix().size());
-    copy(buffer, node.getValue().data(), node.getValue().size());
-}
-void PPRFKeySerializer::copy(std::vector<unsigned char> &buffer, const unsigned char *toCopy, size_t size) {
-    for (int i = 0; i < size; ++i) {
-        buffer.push_back(toCopy[i] & 0xFF);
+void PPRFKeySerializer::forEachBlock(size_t numBlocks, unsigned threads, const std::function<void(size_t)> &f) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
-}
-
-void PPRFKeySerializer::writeInteger(std::vector<unsigned char> &underlyingBuffer, uint64_t t1) {
-    uint64_t t2 = htonll(t1);
-    for (int i = 0; i < sizeof(uint64_t); ++i) {
-        unsigned char byte = (t2 >> (8 * i)) & 0xFF;
-        underlyingBuffer.push_back(byte);
+    const size_t workers = std::min<size_t>(threads, numBlocks);
+    if (workers <= 1) {
+        for (size_t block = 0; block < numBlocks; ++block) {
+            f(block);
+        }
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(workers);
+    auto work = [&](size_t worker) {
+        try {
+            for (size_t block = next++; block < numBlocks; block = next++) {
+                f(block);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+            next = numBlocks;
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker) {
+        try {
+            pool.emplace_back(work, worker);
+        } catch (const std::system_error &) {
+            break; /* continue with the threads we got */
+        }
+    }
+    work(0);
+    for (std::thread &thread: pool) {
+        thread.join();
+    }
+    for (std::exception_ptr &error: errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 }
 
-
-int PPRFKeySerializer::getInt(SecureByteBuffer b, size_t offset) {
-    uint64_t ret = getUInt64(b, offset);
-    return ntohll(ret);
+size_t PPRFKeySerializer::blockCount(size_t numNodes, size_t blockNodes) {
+    return numNodes / blockNodes + (numNodes % blockNodes != 0);
 }
-size_t PPRFKeySerializer::getSize(SecureByteBuffer b, size_t offset) {
-    uint64_t ret = getUInt64(b, offset);
-    return ntohll(ret);
+
+void PPRFKeySerializer::writeUInt(unsigned char *out, uint64_t value, size_t len) {
+    for (size_t i = len; i-- > 0;) {
+        out[i] = value & 0xFF;
+        value >>= 8;
+    }
 }
-size_t PPRFKeySerializer::getUInt64(SecureByteBuffer &b, size_t offset) {
-    if (b.size() < offset + sizeof(uint64_t)) {
+
+uint64_t PPRFKeySerializer::readUInt(const SecureByteBuffer &b, size_t offset, size_t len) {
+    if (offset > b.size() || b.size() - offset < len) {
         throw PPRFDeserializationError();
     }
     uint64_t ret = 0;
-    for (int i = 0; i < sizeof(uint64_t); i++) {
-        uint64_t byte = b.data()[offset + i];
-        ret = ret | (byte << (i * 8));
+    for (size_t i = 0; i < len; ++i) {
+        ret = (ret << 8) | b.data()[offset + i];
     }
     return ret;
 }
-std::string PPRFKeySerializer::getString(SecureByteBuffer b, size_t offset, size_t length) {
-    if (b.size() < offset + length) {
-        throw PPRFDeserializationError();
-    }
-    return {b.vec.begin() + offset, b.vec.begin() + offset + length};
-}
-SecureByteBuffer PPRFKeySerializer::copyValue(SecureByteBuffer from, size_t offset, size_t length) {
-    if (from.size() < offset + length) {
-        throw PPRFDeserializationError();
-    }
-    std::vector<unsigned char> res(from.vec.begin() + offset, from.vec.begin() + offset + length);
-    return SecureByteBuffer(res);
-}
\ No newline at end of file
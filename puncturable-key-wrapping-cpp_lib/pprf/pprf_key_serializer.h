@@ -25,23 +25,66 @@
 #include "ggm_pprf_key.h"
 #include "secret_root.h"
 #include "secure_byte_buffer.h"
+#include <cstdint>
+#include <functional>
+
+/** the number of nodes per block of a serialized key */
+constexpr size_t PPRF_KEY_BLOCK_NODES = 16384;
+
+/**
+ * Serializes PPRFKeys.
+ *
+ * Format (integers big-endian):
+ * magic "PPK" | version u8 | tagLen u32 | keyLen u32 | puncs u64 | numNodes u64 | blockNodes u32 | numBlocks u32 |
+ * [arity u32, version 3 only] | block offsets u64 * numBlocks | blocks.
+ * Keys of binary trees are written as version 2, other arities as version 3.
+ * A block holds blockNodes nodes (the last one the remainder), each encoded as prefixLen u16 | prefix | value.
+ * The offset table allows blocks to be encoded and decoded on several threads; the block size is fixed by the
+ * serializer, so the output does not depend on the number of threads.
+ * Keys in the previous, unblocked format are still read.
+ */
 class PPRFKeySerializer {
     public:
-        explicit PPRFKeySerializer(PPRFKey keyToSerialize) : keyToSerialize(std::move(keyToSerialize)) {}
-        SecureByteBuffer serialize();
-        static PPRFKey deserialize(SecureByteBuffer &serialized);
+        /**
+         * @param keyToSerialize the key
+         * @param blockNodes the number of nodes per block
+         */
+        explicit PPRFKeySerializer(PPRFKey keyToSerialize, size_t blockNodes = PPRF_KEY_BLOCK_NODES);
+        /**
+         * Serializes the key.
+         * @param threads the maximum number of threads to use, 0 for the number of hardware threads
+         * @return the serialized key
+         */
+        SecureByteBuffer serialize(unsigned threads = 0);
+        /**
+         * Deserializes a key in the blocked or the previous format.
+         * @param serialized the serialized key
+         * @param threads the maximum number of threads to use, 0 for the number of hardware threads
+         * @return the key
+         */
+        static PPRFKey deserialize(const SecureByteBuffer &serialized, unsigned threads = 0);
+        /**
+         * Returns the size of a serialized key without serializing it.
+         * @param keyLen the key length in bits
+         * @param depthHistogram the number of nodes per prefix length
+         * @param arity the arity of the tree
+         * @return the size in bytes
+         */
+        static size_t serializedSize(int keyLen, const std::vector<size_t> &depthHistogram, int arity = GGM_BINARY);
 
     private:
         PPRFKey keyToSerialize;
-        static int getInt(SecureByteBuffer b, size_t offset);
-        static size_t getSize(SecureByteBuffer buffer, size_t offset);
-        static std::string getString(SecureByteBuffer buffer, size_t offset, size_t length);
-        static SecureByteBuffer copyValue(SecureByteBuffer from, size_t offset, size_t length);
-        static void writeInteger(std::vector<unsigned char> &underlyingBuffer, uint64_t key);
-        void writeNode(std::vector<unsigned char> &buffer, const SecretRoot &node);
-        static void copy(std::vector<unsigned char> &buffer, const unsigned char *toCopy, size_t size);
-        static size_t getUInt64(SecureByteBuffer &b, size_t offset);
+        size_t blockNodes;
+        static const size_t HEADER_LEN;
+        static size_t headerLen(int arity);
+        static bool isBlocked(const SecureByteBuffer &serialized);
+        static PPRFKey deserializeBlocked(const SecureByteBuffer &serialized, unsigned threads);
+        static PPRFKey deserializeLegacy(const SecureByteBuffer &serialized);
+        static void forEachBlock(size_t numBlocks, unsigned threads, const std::function<void(size_t)> &f);
+        static size_t blockCount(size_t numNodes, size_t blockNodes);
+        static void writeUInt(unsigned char *out, uint64_t value, size_t len);
+        static uint64_t readUInt(const SecureByteBuffer &b, size_t offset, size_t len);
 };
 
 
-#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PPRF_KEY_SERIALIZER_H
\ No newline at end of file
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_PPRF_KEY_SERIALIZER_H
@@ -23,9 +23,9 @@
 SecretRoot::SecretRoot() = default;
 SecretRoot::SecretRoot(std::string prefix, SecureByteBuffer value) : prefix(std::move(prefix)),
                                                                      value(std::move(value)) {}
-std::string SecretRoot::getPrefix() const {
+const std::string &SecretRoot::getPrefix() const {
     return prefix;
 }
-SecureByteBuffer SecretRoot::getValue() const {
+const SecureByteBuffer &SecretRoot::getValue() const {
     return value;
 }
\ No newline at end of file
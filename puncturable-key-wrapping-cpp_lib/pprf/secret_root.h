@@ -49,16 +49,17 @@ class SecretRoot {
          * Getter for the prefix
          * @return the prefix
          */
-        std::string getPrefix() const;
+        const std::string &getPrefix() const;
 
         /**
          * Getter for the value
          * @return the value
          */
-        SecureByteBuffer getValue() const;
+        const SecureByteBuffer &getValue() const;
 
 
     private:
+        friend class PPRFKeySerializer;
         std::string prefix;
         SecureByteBuffer value;
 };
@@ -0,0 +1,1251 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_GGM_PPRF_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_GGM_PPRF_H
+#include "ggm_pprf.h"
+#include "ggm_pprf_key.h"
+#include "memory_usage.h"
+#include "metrics.h"
+#include "pprf_exceptions.h"
+#include "pprf_key_serializer.h"
+#include "secret_root.h"
+#include "secure_array.h"
+#include "secure_byte_buffer.h"
+#include "secure_memzero.h"
+#include "thread_crypto.h"
+#include "tracing.h"
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
+#include <cryptopp/sha.h>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Template argument of StaticGGM_PPRF for a length that is only known at runtime.
+ */
+static const size_t DYNAMIC_LEN = 0;
+
+/* info strings of the HKDF-based length-doubling PRG */
+static const unsigned char GGM_RIGHT = 'r';
+static const unsigned char GGM_LEFT = 'l';
+
+/**
+ * A length in bits which is either a compile-time constant or, for DYNAMIC_LEN, stored at runtime.
+ */
+template<size_t Bits>
+class GGMLength {
+    public:
+        explicit GGMLength(int) {}
+        static constexpr int value() { return Bits; }
+};
+
+template<>
+class GGMLength<DYNAMIC_LEN> {
+    public:
+        explicit GGMLength(int bits) : bits(bits) {}
+        int value() const { return bits; }
+
+    private:
+        int bits;
+};
+
+/**
+ * Word-based tag representation. Tags of at most 64 bits are a single plain integer, longer (and runtime-sized) tags
+ * are arrays of little-endian 64-bit words: bit i of the tag is bit i % 64 of word i / 64.
+ */
+template<size_t TagBits, bool SingleWord = (TagBits != DYNAMIC_LEN && TagBits <= 64)>
+struct GGMTag {
+        static const size_t WORDS = TagBits == DYNAMIC_LEN ? MAX_TAG_LEN / 64 : (TagBits + 63) / 64;
+        using Type = std::array<uint64_t, WORDS>;
+
+        static bool bit(const Type &t, int i) { return (t[i >> 6] >> (i & 63)) & 1u; }
+        static void setBit(Type &t, int i) { t[i >> 6] |= uint64_t(1) << (i & 63); }
+        /* the bits i to i + n - 1, for n dividing 64 and i a multiple of n */
+        static unsigned digit(const Type &t, int i, int n) { return (t[i >> 6] >> (i & 63)) & ((uint64_t(1) << n) - 1); }
+        static void setDigit(Type &t, int i, unsigned d) { t[i >> 6] |= uint64_t(d) << (i & 63); }
+        /* the bits i to i + n - 1 for any n < 64, possibly across two words */
+        static uint64_t field(const Type &t, int i, int n) {
+            uint64_t v = t[i >> 6] >> (i & 63);
+            if ((i & 63) + n > 64) {
+                v |= t[(i >> 6) + 1] << (64 - (i & 63));
+            }
+            return v & ((uint64_t(1) << n) - 1);
+        }
+        static void setField(Type &t, int i, uint64_t v) {
+            t[i >> 6] |= v << (i & 63);
+            if ((i & 63) != 0 && (i >> 6) + 1 < (int) WORDS) {
+                t[(i >> 6) + 1] |= v >> (64 - (i & 63));
+            }
+        }
+        static Type orLow(Type t, uint64_t low) {
+            t[0] |= low;
+            return t;
+        }
+        /* t with the bits below position n set to value */
+        static Type fillLow(Type t, int n, bool value) {
+            for (size_t w = 0; w < WORDS && 64 * (int) w < n; ++w) {
+                int bits = n - 64 * (int) w;
+                uint64_t mask = bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+                t[w] = value ? t[w] | mask : t[w] & ~mask;
+            }
+            return t;
+        }
+
+        /* true iff no bit at position len or above is set */
+        static bool fits(const Type &t, int len) {
+            for (size_t w = len / 64; w < WORDS; ++w) {
+                uint64_t mask = w == size_t(len / 64) ? ~uint64_t(0) << (len % 64) : ~uint64_t(0);
+                if (t[w] & mask) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool less(const Type &a, const Type &b) {
+            for (size_t w = WORDS; w-- > 0;) {
+                if (a[w] != b[w]) {
+                    return a[w] < b[w];
+                }
+            }
+            return false;
+        }
+
+        /* true iff a and b agree on all bits at position from or above */
+        static bool samePrefix(const Type &a, const Type &b, int from) {
+            for (size_t w = from / 64; w < WORDS; ++w) {
+                uint64_t mask = w == size_t(from / 64) ? ~uint64_t(0) << (from % 64) : ~uint64_t(0);
+                if ((a[w] ^ b[w]) & mask) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool fromWords(const TagWords &words, Type &out) {
+            std::copy(words.begin(), words.begin() + WORDS, out.begin());
+            return std::all_of(words.begin() + WORDS, words.end(), [](uint64_t w) { return w == 0; });
+        }
+};
+
+template<size_t TagBits>
+struct GGMTag<TagBits, true> {
+        using Type = uint64_t;
+
+        static bool bit(Type t, int i) { return (t >> i) & 1u; }
+        static void setBit(Type &t, int i) { t |= uint64_t(1) << i; }
+        static unsigned digit(Type t, int i, int n) { return (t >> i) & ((uint64_t(1) << n) - 1); }
+        static void setDigit(Type &t, int i, unsigned d) { t |= uint64_t(d) << i; }
+        static uint64_t field(Type t, int i, int n) { return (t >> i) & ((uint64_t(1) << n) - 1); }
+        static void setField(Type &t, int i, uint64_t v) { t |= v << i; }
+        static Type orLow(Type t, uint64_t low) { return t | low; }
+        static Type fillLow(Type t, int n, bool value) {
+            uint64_t mask = n >= 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+            return value ? t | mask : t & ~mask;
+        }
+        static bool fits(Type t, int len) { return len >= 64 || (t >> len) == 0; }
+        static bool less(Type a, Type b) { return a < b; }
+        static bool samePrefix(Type a, Type b, int from) { return from >= 64 || ((a ^ b) >> from) == 0; }
+
+        static bool fromWords(const TagWords &words, Type &out) {
+            out = words[0];
+            return std::all_of(words.begin() + 1, words.end(), [](uint64_t w) { return w == 0; });
+        }
+};
+
+/**
+ * Storage of node values: inline SecureArrays for fixed key lengths, SecureByteBuffers otherwise.
+ */
+template<size_t KeyBits>
+struct GGMValue {
+        using Type = SecureArray<KeyBits / 8>;
+        static Type make(int) { return Type(); }
+        /* bytes allocated on the heap per value */
+        static size_t heapBytes(int) { return 0; }
+};
+
+template<>
+struct GGMValue<DYNAMIC_LEN> {
+        using Type = SecureByteBuffer;
+        static Type make(int keyBytes) { return SecureByteBuffer(keyBytes); }
+        static size_t heapBytes(int keyBytes) { return keyBytes; }
+};
+
+/**
+ * The GGM PPRF of GGM_PPRF, specialized for tag and key lengths known at compile time.
+ * The depth of the tree is a constant, node values live inline in SecureArrays and tags are plain 64-bit words, so
+ * finding a node and walking down the tree are shifts and integer comparisons instead of bitset and string operations.
+ * <br>
+ * Either parameter may be DYNAMIC_LEN, in which case the length is taken from the key at runtime. GGM_PPRF dispatches
+ * to the common instantiations and uses these as the fallback.
+ * <br>
+ * Nodes are kept in chunks that copies of an instance share; a chunk is copied before it is modified while shared
+ * (copy-on-write). Copying an instance is O(1), and a puncture after a copy copies at most the chunk it modifies.
+ * Copies may be used on different threads.
+ * <br>
+ * The tree may have an arity of 4, 16 or 256 instead of 2 (see PPRFKey::checkArity). Every level then consumes
+ * log2(arity) tag bits, and a node's children are consecutive blocks of the AES-CTR keystream under the node's value,
+ * so one child is derived with a few AES blocks and all children with one keystream call. Evaluations take
+ * tagLen / log2(arity) steps; a puncture leaves arity - 1 siblings per level.
+ * <br>
+ * With a frontier depth d > 0, the key is expanded at construction to its nodes at depth d, the 2^d slots of a table
+ * indexed by the first d tag bits. An evaluation then finds its slot in O(1) and derives only the tagLen - d levels
+ * below it. A puncture inside a slot moves the slot's node to the chunks and erases the slot, so the frontier and the
+ * chunks together always hold a set of disjoint subtrees.
+ * @tparam TagBits the size of the tag space in number of bits
+ * @tparam KeyBits the size of the key space in number of bits
+ */
+template<size_t TagBits, size_t KeyBits>
+class StaticGGM_PPRF {
+        static_assert(TagBits <= MAX_TAG_LEN, "tag length exceeds MAX_TAG_LEN");
+        static_assert(KeyBits % 8 == 0, "key length must be a multiple of 8");
+
+    public:
+        using Tags = GGMTag<TagBits>;
+        using TagType = typename Tags::Type;
+        using Value = typename GGMValue<KeyBits>::Type;
+
+        /**
+         * Root of a subtree: the smallest tag below it and the length of the prefix shared by all tags below it.
+         */
+        struct Node {
+                TagType start;
+                int prefixLen;
+                Value value;
+        };
+
+        /** the largest supported frontier depth */
+        static const int MAX_FRONTIER_DEPTH = 24;
+
+        /**
+         * Constructs a PPRF instance using the key.
+         * @param key the key
+         * @param frontierDepth the depth d of the pre-expanded frontier, 0 for none; the frontier takes 2^d values
+         * @throws InitializationException if the key's parameters do not match the template parameters, or
+         * frontierDepth exceeds the tag length or MAX_FRONTIER_DEPTH or is not a multiple of log2(arity)
+         */
+        explicit StaticGGM_PPRF(const PPRFKey &key, int frontierDepth = 0);
+
+        /**
+         * Punctures the PPRF on tag. If tag was already punctured on, no exception is thrown.
+         * @param tag the tag on which the PPRF is to be punctured
+         * @throws TagException if the size of the tag exceeds the key's tag length.
+         */
+        void punc(const TagType &tag);
+
+        /**
+         * Punctures the PPRF on all tags whose first prefixLen bits equal those of tag, i.e. removes a whole subtree.
+         * Counts as a single puncture. Tags of the subtree that were already punctured are not an error.
+         * @param tag any tag of the subtree
+         * @param prefixLen the depth of the subtree's root, at most the tag length and a multiple of log2(arity)
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         */
+        void puncPrefix(const TagType &tag, int prefixLen);
+
+        /**
+         * Returns a key for the subtree of all tags whose first prefixLen bits equal those of tag: the nodes inside
+         * the subtree, or the subtree's root derived from the node covering it. The key has this key's tag length and
+         * arity and no punctures; it evaluates like this key inside the subtree and is punctured everywhere else.
+         * @param tag any tag of the subtree
+         * @param prefixLen the depth of the subtree's root, at most the tag length and a multiple of log2(arity)
+         * @return the delegated key
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         */
+        PPRFKey delegate(const TagType &tag, int prefixLen) const;
+
+        /**
+         * Takes over the punctures of a key delegated for the subtree of tag and prefixLen (see delegate): afterwards
+         * a tag of the subtree can be evaluated iff both keys could evaluate it. Tags outside the subtree are not
+         * affected. The delegated key's punctures are added to the count, so each delegated key should be merged once.
+         * @param tag any tag of the subtree
+         * @param prefixLen the depth of the subtree's root
+         * @param delegated the delegated key, possibly punctured since
+         * @throws TagException if the size of the tag exceeds the key's tag length or prefixLen is out of range.
+         * @throws InitializationException if the delegated key's parameters differ, it has nodes outside the subtree or
+         * its nodes do not belong to this key's tree
+         */
+        void merge(const TagType &tag, int prefixLen, const PPRFKey &delegated);
+
+        /**
+         * Evaluates the PPRF on input tag and returns the result of the evaluation.
+         * @param tag the tag
+         * @return the value
+         * @throws TagException if the PPRF was punctured on tag or the size of the tag exceeds the key's tag length.
+         */
+        Value eval(const TagType &tag) const;
+
+        /**
+         * Evaluates the PPRF on input tag without throwing.
+         * @param tag the tag
+         * @param out receives the value if the result is PPRFStatus::Ok; must have the key's size
+         * @return whether tag could be evaluated
+         */
+        PPRFStatus tryEval(const TagType &tag, Value &out) const;
+
+        /**
+         * Looks tag up in the node index, without any derivation.
+         * @param tag the tag
+         * @return PPRFStatus::Ok if tag can be evaluated, why not otherwise
+         */
+        PPRFStatus status(const TagType &tag) const;
+
+        int getNumPuncs() const { return puncs; }
+        size_t getNumNodes() const { return storage->numNodes + (frontier ? frontier->numLive : 0); }
+        int tagLen() const { return tagBits.value(); }
+        int keyLen() const { return keyBits.value(); }
+        int arity() const { return 1 << levelBits; }
+        int getFrontierDepth() const { return frontierDepth; }
+
+        /**
+         * Converts the state back into the generic key representation, e.g. for serialization.
+         * @return the key
+         */
+        PPRFKey toKey() const;
+
+        /**
+         * Returns the memory currently held by this instance and the depths of its nodes.
+         * @return the breakdown
+         */
+        MemoryUsage memoryUsage() const;
+
+        /**
+         * Estimates nodes, memory and serialized size after k further punctures, without modifying this instance.
+         * The node count is exact for the given tags; random tags are drawn from a generator seeded with seed.
+         * @param k the number of punctures
+         * @param order which tags are punctured
+         * @param seed seed for PunctureOrder::Random
+         * @return the projection
+         */
+        MemoryProjection projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed = 0) const;
+
+    private:
+        GGMLength<TagBits> tagBits;
+        GGMLength<KeyBits> keyBits;
+        int puncs;
+        /* tag bits per level of the tree, log2 of the arity */
+        int levelBits;
+
+        static const size_t CHUNK_NODES = 128;
+        using Chunk = std::vector<Node>;
+        struct Storage {
+                /* Invariant: chunks are non-empty and nodes are ordered by start across all chunks, which for disjoint
+                 * subtrees is the lexicographic order of prefixes */
+                std::vector<std::shared_ptr<Chunk>> chunks;
+                /* the start of the first node of each chunk */
+                std::vector<TagType> firsts;
+                size_t numNodes = 0;
+        };
+        std::shared_ptr<Storage> storage;
+
+        static const size_t FRONTIER_CHUNK_SLOTS = 4096;
+        struct FrontierChunk {
+                std::vector<Value> values;
+                /* Invariant: the values of erased slots are zeroized */
+                std::vector<bool> live;
+        };
+        /* Invariant: every node of the chunks lies inside an erased slot */
+        struct Frontier {
+                std::vector<std::shared_ptr<FrontierChunk>> chunks;
+                size_t numLive = 0;
+        };
+        /* depth of the frontier, 0 if there is none */
+        int frontierDepth;
+        /* null if frontierDepth is 0; shared copy-on-write like the chunks */
+        std::shared_ptr<Frontier> frontier;
+
+        struct Position {
+                size_t chunk;
+                size_t index;
+        };
+
+        const Node *findNode(const TagType &tag, Position &pos) const;
+        Storage &mutableStorage();
+        Chunk &mutableChunk(size_t chunk);
+        void rebalance(size_t chunk);
+
+        uint64_t slotOf(const TagType &tag) const { return Tags::field(tag, tagLen() - frontierDepth, frontierDepth); }
+        TagType slotStart(uint64_t slot) const {
+            TagType start{};
+            Tags::setField(start, tagLen() - frontierDepth, slot);
+            return start;
+        }
+        bool slotLive(uint64_t slot) const { return frontier->chunks[slot / FRONTIER_CHUNK_SLOTS]->live[slot % FRONTIER_CHUNK_SLOTS]; }
+        const Value &slotValue(uint64_t slot) const { return frontier->chunks[slot / FRONTIER_CHUNK_SLOTS]->values[slot % FRONTIER_CHUNK_SLOTS]; }
+        Node slotNode(uint64_t slot) const { return Node{slotStart(slot), frontierDepth, slotValue(slot)}; }
+        FrontierChunk &mutableFrontierChunk(size_t chunk);
+        void expandFrontier(std::vector<Node> &nodes);
+        /* zeroizes a live slot */
+        void eraseSlot(uint64_t slot);
+        /* moves the node of tag's slot to the chunks if the slot is live, before a puncture or merge below it */
+        void demoteSlot(const TagType &tag);
+        /* the node covering tag, which for a live slot is copied to slot, or null if tag is punctured */
+        const Node *findCovering(const TagType &tag, Position &pos, Node &slot) const;
+
+        template<typename F>
+        void forEachNode(F f) const {
+            if (frontier) {
+                forEachNodeIn(TagType{}, Tags::fillLow(TagType{}, tagLen(), true), f);
+                return;
+            }
+            for (const std::shared_ptr<Chunk> &chunk: storage->chunks) {
+                for (const Node &node: *chunk) {
+                    f(node);
+                }
+            }
+        }
+        /* calls f on the nodes starting in [lo, hi], in order, live slots included */
+        template<typename F>
+        void forEachNodeIn(const TagType &lo, const TagType &hi, F f) const {
+            if (!frontier) {
+                forEachStoredIn(lo, hi, f);
+                return;
+            }
+            const uint64_t last = slotOf(hi);
+            for (uint64_t s = slotOf(lo); s <= last; ++s) {
+                const TagType start = slotStart(s);
+                if (slotLive(s)) {
+                    if (!Tags::less(start, lo)) {
+                        f(slotNode(s));
+                    }
+                    continue;
+                }
+                const TagType end = Tags::fillLow(start, tagLen() - frontierDepth, true);
+                forEachStoredIn(Tags::less(start, lo) ? lo : start, Tags::less(hi, end) ? hi : end, f);
+            }
+        }
+        /* calls f on the nodes of the chunks starting in [lo, hi], in order */
+        template<typename F>
+        void forEachStoredIn(const TagType &lo, const TagType &hi, F f) const {
+            auto first = std::upper_bound(storage->firsts.begin(), storage->firsts.end(), lo, [](const TagType &t, const TagType &f) { return Tags::less(t, f); });
+            for (size_t c = first == storage->firsts.begin() ? 0 : first - storage->firsts.begin() - 1;
+                 c < storage->chunks.size() && !Tags::less(hi, storage->firsts[c]); ++c) {
+                const Chunk &chunk = *storage->chunks[c];
+                auto it = std::lower_bound(chunk.begin(), chunk.end(), lo, [](const Node &n, const TagType &t) { return Tags::less(n.start, t); });
+                for (; it != chunk.end() && !Tags::less(hi, it->start); ++it) {
+                    f(*it);
+                }
+            }
+        }
+        void checkPrefix(const TagType &tag, int prefixLen) const;
+        /* removes the nodes starting in [lo, hi], returns their number */
+        size_t eraseRange(const TagType &lo, const TagType &hi);
+        /* inserts sorted nodes which start after every node before them and before every node after them */
+        void insertNodes(std::vector<Node> nodes);
+        /* the last tag below node */
+        TagType endOf(const Node &node) const { return Tags::fillLow(node.start, tagLen() - node.prefixLen, true); }
+        /* the node at depth toLen on the path of tag, derived from node above it */
+        Value deriveDown(const Node &node, const TagType &tag, int toLen) const;
+        std::vector<Node> intersect(const std::vector<Node> &a, const std::vector<Node> &b) const;
+        SecretRoot toRoot(const Node &node) const;
+        Value evalAndGetCoPath(const TagType &tag, const Node &node, std::vector<Node> &coPath, int untilLen) const;
+        void deriveChild(const Value &parent, unsigned index, Value &child) const;
+        void deriveChildren(const Value &parent, std::vector<Value> &children) const;
+        /* PRG invocations of deriveChildren */
+        int expansionCost() const { return levelBits == 1 ? 2 : 1; }
+        Value makeValue() const { return GGMValue<KeyBits>::make(keyLen() / 8); }
+        MemoryUsage memoryUsageFor(size_t numNodes, const std::vector<size_t> &chunkCapacities) const;
+        void addFrontierUsage(MemoryUsage &usage, size_t numLive) const;
+        std::vector<size_t> depthHistogram() const;
+        std::vector<TagType> projectedTags(size_t k, PunctureOrder order, uint64_t seed) const;
+};
+
+template<size_t TagBits, size_t KeyBits>
+StaticGGM_PPRF<TagBits, KeyBits>::StaticGGM_PPRF(const PPRFKey &key, int frontierDepth)
+    : tagBits(key.tagLen), keyBits(key.keyLen), puncs(key.puncs), levelBits(1), frontierDepth(frontierDepth) {
+    if (key.tagLen != tagLen() || key.keyLen != keyLen() || tagLen() <= 0 || tagLen() > (int) MAX_TAG_LEN || keyLen() <= 0) {
+        throw InitializationException();
+    }
+    levelBits = PPRFKey::checkArity(keyLen(), tagLen(), key.arity);
+    if (frontierDepth < 0 || frontierDepth > tagLen() || frontierDepth > MAX_FRONTIER_DEPTH || frontierDepth % levelBits != 0) {
+        throw InitializationException();
+    }
+    std::vector<Node> nodes;
+    nodes.reserve(key.nodes.size());
+    for (const SecretRoot &root: key.nodes) {
+        const std::string &prefix = root.getPrefix();
+        const SecureByteBuffer &value = root.getValue();
+        if (prefix.size() > (size_t) tagLen() || prefix.size() % levelBits != 0 || value.size() != (size_t) keyLen() / 8) {
+            throw InitializationException();
+        }
+        Node node{TagType(), (int) prefix.size(), makeValue()};
+        for (size_t i = 0; i < prefix.size(); ++i) {
+            if (prefix[i] == '1') {
+                Tags::setBit(node.start, tagLen() - 1 - (int) i);
+            }
+        }
+        std::copy(value.begin(), value.end(), node.value.begin());
+        nodes.push_back(std::move(node));
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node &n1, const Node &n2) { return Tags::less(n1.start, n2.start); });
+    if (frontierDepth > 0) {
+        expandFrontier(nodes);
+    }
+    storage = std::make_shared<Storage>();
+    storage->numNodes = nodes.size();
+    for (size_t from = 0; from < nodes.size(); from += CHUNK_NODES) {
+        auto to = nodes.begin() + std::min(from + CHUNK_NODES, nodes.size());
+        storage->chunks.push_back(std::make_shared<Chunk>(std::make_move_iterator(nodes.begin() + from), std::make_move_iterator(to)));
+        storage->firsts.push_back(storage->chunks.back()->front().start);
+    }
+}
+
+/**
+ * Moves the nodes at or above the frontier into their slots, expanding the ones above it level by level; the deeper
+ * nodes stay in nodes, inside slots that remain erased.
+ */
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::expandFrontier(std::vector<Node> &nodes) {
+    const uint64_t numSlots = uint64_t(1) << frontierDepth;
+    frontier = std::make_shared<Frontier>();
+    for (uint64_t first = 0; first < numSlots; first += FRONTIER_CHUNK_SLOTS) {
+        const size_t size = std::min(first + FRONTIER_CHUNK_SLOTS, numSlots) - first;
+        frontier->chunks.push_back(std::make_shared<FrontierChunk>(FrontierChunk{std::vector<Value>(size, makeValue()), std::vector<bool>(size, false)}));
+    }
+    std::vector<Node> deeper;
+    std::vector<Value> children(arity(), makeValue());
+    size_t invocations = 0;
+    for (Node &node: nodes) {
+        if (node.prefixLen > frontierDepth) {
+            deeper.push_back(std::move(node));
+            continue;
+        }
+        std::vector<Value> level;
+        level.push_back(std::move(node.value));
+        for (int len = node.prefixLen; len < frontierDepth; len += levelBits) {
+            std::vector<Value> next;
+            next.reserve(level.size() * arity());
+            for (const Value &value: level) {
+                deriveChildren(value, children);
+                next.insert(next.end(), children.begin(), children.end());
+            }
+            invocations += level.size() * expansionCost();
+            level.swap(next);
+        }
+        const uint64_t base = slotOf(node.start);
+        for (uint64_t j = 0; j < level.size(); ++j) {
+            FrontierChunk &chunk = *frontier->chunks[(base + j) / FRONTIER_CHUNK_SLOTS];
+            chunk.values[(base + j) % FRONTIER_CHUNK_SLOTS] = level[j];
+            chunk.live[(base + j) % FRONTIER_CHUNK_SLOTS] = true;
+        }
+        frontier->numLive += level.size();
+    }
+    PKWMetrics::instance().count(MetricCounter::PRGInvocations, invocations);
+    nodes.swap(deeper);
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::FrontierChunk &StaticGGM_PPRF<TagBits, KeyBits>::mutableFrontierChunk(size_t chunk) {
+    if (frontier.use_count() != 1) {
+        frontier = std::make_shared<Frontier>(*frontier);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    std::shared_ptr<FrontierChunk> &ptr = frontier->chunks[chunk];
+    if (ptr.use_count() != 1) {
+        ptr = std::make_shared<FrontierChunk>(*ptr);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *ptr;
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::eraseSlot(uint64_t slot) {
+    PKW_TRACE_SPAN(TraceOp::Zeroize, 0, getNumNodes());
+    FrontierChunk &chunk = mutableFrontierChunk(slot / FRONTIER_CHUNK_SLOTS);
+    Value &value = chunk.values[slot % FRONTIER_CHUNK_SLOTS];
+    secure_memzero(value.data(), value.size());
+    chunk.live[slot % FRONTIER_CHUNK_SLOTS] = false;
+    frontier->numLive -= 1;
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::demoteSlot(const TagType &tag) {
+    if (!frontier || !slotLive(slotOf(tag))) {
+        return;
+    }
+    const uint64_t slot = slotOf(tag);
+    std::vector<Node> node;
+    node.push_back(slotNode(slot));
+    eraseSlot(slot);
+    insertNodes(std::move(node));
+}
+
+template<size_t TagBits, size_t KeyBits>
+const typename StaticGGM_PPRF<TagBits, KeyBits>::Node *
+StaticGGM_PPRF<TagBits, KeyBits>::findCovering(const TagType &tag, Position &pos, Node &slot) const {
+    if (frontier && slotLive(slotOf(tag))) {
+        slot = slotNode(slotOf(tag));
+        return &slot;
+    }
+    return findNode(tag, pos);
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::Value StaticGGM_PPRF<TagBits, KeyBits>::eval(const TagType &tag) const {
+    Value out = makeValue();
+    if (tryEval(tag, out) != PPRFStatus::Ok) {
+        throw TagException();
+    }
+    return out;
+}
+
+template<size_t TagBits, size_t KeyBits>
+PPRFStatus StaticGGM_PPRF<TagBits, KeyBits>::status(const TagType &tag) const {
+    if (!Tags::fits(tag, tagLen())) {
+        return PPRFStatus::TagTooLarge;
+    }
+    if (frontier && slotLive(slotOf(tag))) {
+        return PPRFStatus::Ok;
+    }
+    Position pos{};
+    return findNode(tag, pos) == nullptr ? PPRFStatus::Punctured : PPRFStatus::Ok;
+}
+
+template<size_t TagBits, size_t KeyBits>
+PPRFStatus StaticGGM_PPRF<TagBits, KeyBits>::tryEval(const TagType &tag, Value &out) const {
+    MetricsTimer timer(MetricOp::Eval);
+    PKW_TRACE_SPAN(TraceOp::Eval, tagLen(), getNumNodes());
+    if (!Tags::fits(tag, tagLen())) {
+        return PPRFStatus::TagTooLarge;
+    }
+    int prefixLen;
+    if (frontier && slotLive(slotOf(tag))) {
+        out = slotValue(slotOf(tag));
+        prefixLen = frontierDepth;
+    } else {
+        Position pos{};
+        const Node *found = findNode(tag, pos);
+        if (found == nullptr) {
+            return PPRFStatus::Punctured;
+        }
+        out = found->value;
+        prefixLen = found->prefixLen;
+    }
+
+    Value second = makeValue();
+    Value *res = &out;
+    Value *derived = &second;
+    const int levels = (tagLen() - prefixLen) / levelBits;
+    {
+        PKW_TRACE_SPAN(TraceOp::Derivation, levels, getNumNodes());
+        for (int i = tagLen() - prefixLen - levelBits; i >= 0; i -= levelBits) {
+            deriveChild(*res, Tags::digit(tag, i, levelBits), *derived);
+            std::swap(res, derived);
+        }
+    }
+    if (res != &out) {
+        out = *res;
+    }
+    PKWMetrics::instance().count(MetricCounter::Evals);
+    PKWMetrics::instance().count(MetricCounter::PRGInvocations, levels);
+    return PPRFStatus::Ok;
+}
+
+template<size_t TagBits, size_t KeyBits>
+const typename StaticGGM_PPRF<TagBits, KeyBits>::Node *
+StaticGGM_PPRF<TagBits, KeyBits>::findNode(const TagType &tag, Position &pos) const {
+    PKW_TRACE_SPAN(TraceOp::NodeSearch, 0, getNumNodes());
+    const Storage &s = *storage;
+    auto first = std::upper_bound(s.firsts.begin(), s.firsts.end(), tag, [](const TagType &t, const TagType &f) { return Tags::less(t, f); });
+    if (first == s.firsts.begin()) {
+        return nullptr;
+    }
+    pos.chunk = first - s.firsts.begin() - 1;
+    const Chunk &chunk = *s.chunks[pos.chunk];
+    auto it = std::upper_bound(chunk.begin(), chunk.end(), tag, [](const TagType &t, const Node &n) { return Tags::less(t, n.start); });
+    --it; /* the chunk's first node starts at or before tag */
+    if (!Tags::samePrefix(tag, it->start, tagLen() - it->prefixLen)) {
+        return nullptr;
+    }
+    pos.index = it - chunk.begin();
+    return &*it;
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::Storage &StaticGGM_PPRF<TagBits, KeyBits>::mutableStorage() {
+    if (storage.use_count() != 1) {
+        storage = std::make_shared<Storage>(*storage);
+    } else {
+        /* pairs with the release of the last other owner, whose reads must happen before our writes */
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *storage;
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::Chunk &StaticGGM_PPRF<TagBits, KeyBits>::mutableChunk(size_t chunk) {
+    std::shared_ptr<Chunk> &ptr = mutableStorage().chunks[chunk];
+    if (ptr.use_count() != 1) {
+        ptr = std::make_shared<Chunk>(*ptr);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *ptr;
+}
+
+/**
+ * Restores the invariants after the nodes of chunk changed: drops it if empty, splits it if it grew beyond twice
+ * CHUNK_NODES. Requires that chunk is not shared.
+ */
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::rebalance(size_t chunk) {
+    Storage &s = *storage;
+    Chunk &nodes = *s.chunks[chunk];
+    if (nodes.empty()) {
+        s.chunks.erase(s.chunks.begin() + chunk);
+        s.firsts.erase(s.firsts.begin() + chunk);
+        return;
+    }
+    s.firsts[chunk] = nodes.front().start;
+    if (nodes.size() <= 2 * CHUNK_NODES) {
+        return;
+    }
+    std::vector<std::shared_ptr<Chunk>> pieces;
+    std::vector<TagType> firsts;
+    for (size_t from = CHUNK_NODES; from < nodes.size(); from += CHUNK_NODES) {
+        auto to = nodes.begin() + std::min(from + CHUNK_NODES, nodes.size());
+        pieces.push_back(std::make_shared<Chunk>(std::make_move_iterator(nodes.begin() + from), std::make_move_iterator(to)));
+        firsts.push_back(pieces.back()->front().start);
+    }
+    nodes.erase(nodes.begin() + CHUNK_NODES, nodes.end());
+    s.chunks.insert(s.chunks.begin() + chunk + 1, pieces.begin(), pieces.end());
+    s.firsts.insert(s.firsts.begin() + chunk + 1, firsts.begin(), firsts.end());
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::punc(const TagType &tag) {
+    MetricsTimer timer(MetricOp::Punc);
+    PKW_TRACE_SPAN(TraceOp::Punc, tagLen(), getNumNodes());
+    if (!Tags::fits(tag, tagLen())) {
+        throw TagException();
+    }
+    demoteSlot(tag);
+    Position pos{};
+    const Node *node = findNode(tag, pos);
+    if (node == nullptr) {
+        return; /* already punctured */
+    }
+    puncs += 1;
+    PKWMetrics::instance().count(MetricCounter::Punctures);
+    std::vector<Node> coPath;
+    evalAndGetCoPath(tag, *node, coPath, tagLen());
+    PKW_TRACE_SPAN(TraceOp::Splice, static_cast<int>(coPath.size()), getNumNodes());
+    Chunk &chunk = mutableChunk(pos.chunk);
+    auto at = chunk.erase(chunk.begin() + pos.index);
+    chunk.insert(at, std::make_move_iterator(coPath.begin()), std::make_move_iterator(coPath.end()));
+    storage->numNodes = storage->numNodes + coPath.size() - 1;
+    rebalance(pos.chunk);
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::puncPrefix(const TagType &tag, int prefixLen) {
+    MetricsTimer timer(MetricOp::Punc);
+    PKW_TRACE_SPAN(TraceOp::Punc, tagLen() - prefixLen, getNumNodes());
+    checkPrefix(tag, prefixLen);
+    const TagType lo = Tags::fillLow(tag, tagLen() - prefixLen, false);
+    const TagType hi = Tags::fillLow(tag, tagLen() - prefixLen, true);
+    if (prefixLen > frontierDepth) {
+        demoteSlot(lo);
+    }
+    Position pos{};
+    const Node *node = findNode(lo, pos);
+    if (node != nullptr && node->prefixLen < prefixLen) {
+        /* a single node covers the subtree: replace it by the co-path of the subtree's root */
+        puncs += 1;
+        PKWMetrics::instance().count(MetricCounter::Punctures);
+        std::vector<Node> coPath;
+        evalAndGetCoPath(lo, *node, coPath, prefixLen);
+        PKW_TRACE_SPAN(TraceOp::Splice, static_cast<int>(coPath.size()), getNumNodes());
+        Chunk &chunk = mutableChunk(pos.chunk);
+        auto at = chunk.erase(chunk.begin() + pos.index);
+        chunk.insert(at, std::make_move_iterator(coPath.begin()), std::make_move_iterator(coPath.end()));
+        storage->numNodes = storage->numNodes + coPath.size() - 1;
+        rebalance(pos.chunk);
+        return;
+    }
+    /* otherwise every node starting in [lo, hi] lies inside the subtree */
+    if (eraseRange(lo, hi) > 0) {
+        puncs += 1;
+        PKWMetrics::instance().count(MetricCounter::Punctures);
+    }
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::checkPrefix(const TagType &tag, int prefixLen) const {
+    if (!Tags::fits(tag, tagLen()) || prefixLen < 0 || prefixLen > tagLen() || prefixLen % levelBits != 0) {
+        throw TagException();
+    }
+}
+
+/**
+ * Erases the live slots starting in [lo, hi]. The nodes of the chunks starting in [lo, hi] are contiguous; removes
+ * them chunk by chunk.
+ */
+template<size_t TagBits, size_t KeyBits>
+size_t StaticGGM_PPRF<TagBits, KeyBits>::eraseRange(const TagType &lo, const TagType &hi) {
+    size_t removed = 0;
+    if (frontier) {
+        for (uint64_t s = slotOf(lo), last = slotOf(hi); s <= last; ++s) {
+            if (slotLive(s) && !Tags::less(slotStart(s), lo)) {
+                eraseSlot(s);
+                removed += 1;
+            }
+        }
+    }
+    auto byStart = [](const Node &n, const TagType &t) { return Tags::less(n.start, t); };
+    auto beforeStart = [](const TagType &t, const Node &n) { return Tags::less(t, n.start); };
+    auto first = std::upper_bound(storage->firsts.begin(), storage->firsts.end(), lo, [](const TagType &t, const TagType &f) { return Tags::less(t, f); });
+    size_t c = first == storage->firsts.begin() ? 0 : first - storage->firsts.begin() - 1;
+    while (c < storage->chunks.size() && !Tags::less(hi, storage->firsts[c])) {
+        const Chunk &current = *storage->chunks[c];
+        size_t begin = std::lower_bound(current.begin(), current.end(), lo, byStart) - current.begin();
+        size_t end = std::upper_bound(current.begin(), current.end(), hi, beforeStart) - current.begin();
+        if (begin == end) {
+            ++c;
+            continue;
+        }
+        Chunk &chunk = mutableChunk(c);
+        chunk.erase(chunk.begin() + begin, chunk.begin() + end);
+        storage->numNodes -= end - begin;
+        removed += end - begin;
+        const size_t numChunks = storage->chunks.size();
+        rebalance(c);
+        if (storage->chunks.size() == numChunks) {
+            ++c;
+        }
+    }
+    return removed;
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::insertNodes(std::vector<Node> nodes) {
+    if (nodes.empty()) {
+        return;
+    }
+    Storage &s = mutableStorage();
+    if (s.chunks.empty()) {
+        s.chunks.push_back(std::make_shared<Chunk>());
+        s.firsts.push_back(nodes.front().start);
+    }
+    const TagType &at = nodes.front().start;
+    auto first = std::upper_bound(s.firsts.begin(), s.firsts.end(), at, [](const TagType &t, const TagType &f) { return Tags::less(t, f); });
+    size_t c = first == s.firsts.begin() ? 0 : first - s.firsts.begin() - 1;
+    const size_t count = nodes.size();
+    Chunk &chunk = mutableChunk(c);
+    auto pos = std::lower_bound(chunk.begin(), chunk.end(), at, [](const Node &n, const TagType &t) { return Tags::less(n.start, t); });
+    chunk.insert(pos, std::make_move_iterator(nodes.begin()), std::make_move_iterator(nodes.end()));
+    storage->numNodes += count;
+    rebalance(c);
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::Value
+StaticGGM_PPRF<TagBits, KeyBits>::deriveDown(const Node &node, const TagType &tag, int toLen) const {
+    Value value(node.value);
+    Value child = makeValue();
+    for (int i = tagLen() - node.prefixLen - levelBits; i >= tagLen() - toLen; i -= levelBits) {
+        deriveChild(value, Tags::digit(tag, i, levelBits), child);
+        std::swap(value, child);
+    }
+    PKWMetrics::instance().count(MetricCounter::PRGInvocations, (toLen - node.prefixLen) / levelBits);
+    return value;
+}
+
+template<size_t TagBits, size_t KeyBits>
+PPRFKey StaticGGM_PPRF<TagBits, KeyBits>::delegate(const TagType &tag, int prefixLen) const {
+    checkPrefix(tag, prefixLen);
+    const TagType lo = Tags::fillLow(tag, tagLen() - prefixLen, false);
+    const TagType hi = Tags::fillLow(tag, tagLen() - prefixLen, true);
+    std::vector<SecretRoot> roots;
+    Position pos{};
+    Node slot{TagType(), 0, makeValue()};
+    const Node *node = findCovering(lo, pos, slot);
+    if (node != nullptr && node->prefixLen < prefixLen) {
+        roots.push_back(toRoot(Node{lo, prefixLen, deriveDown(*node, lo, prefixLen)}));
+    } else {
+        forEachNodeIn(lo, hi, [&](const Node &n) { roots.push_back(toRoot(n)); });
+    }
+    return {keyLen(), tagLen(), 0, roots, arity()};
+}
+
+/**
+ * Both inputs are sorted sets of disjoint subtrees; two subtrees either are disjoint or one contains the other, so the
+ * intersection consists of the deeper node of every overlapping pair. The deeper node is checked against the shallower
+ * one by derivation, once per shallower node.
+ */
+template<size_t TagBits, size_t KeyBits>
+std::vector<typename StaticGGM_PPRF<TagBits, KeyBits>::Node>
+StaticGGM_PPRF<TagBits, KeyBits>::intersect(const std::vector<Node> &a, const std::vector<Node> &b) const {
+    std::vector<Node> out;
+    const Node *verified = nullptr;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (Tags::less(endOf(a[i]), b[j].start)) {
+            ++i;
+            continue;
+        }
+        if (Tags::less(endOf(b[j]), a[i].start)) {
+            ++j;
+            continue;
+        }
+        const bool aDeeper = a[i].prefixLen >= b[j].prefixLen;
+        const Node &deeper = aDeeper ? a[i] : b[j];
+        const Node &shallower = aDeeper ? b[j] : a[i];
+        if (verified != &shallower) {
+            if (deriveDown(shallower, deeper.start, deeper.prefixLen) != deeper.value) {
+                throw InitializationException();
+            }
+            verified = &shallower;
+        }
+        out.push_back(deeper);
+        if (a[i].prefixLen == b[j].prefixLen) {
+            ++i;
+            ++j;
+        } else if (aDeeper) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    return out;
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::merge(const TagType &tag, int prefixLen, const PPRFKey &delegated) {
+    checkPrefix(tag, prefixLen);
+    if (delegated.tagLen != tagLen() || delegated.keyLen != keyLen() || delegated.arity != arity()) {
+        throw InitializationException();
+    }
+    const TagType lo = Tags::fillLow(tag, tagLen() - prefixLen, false);
+    const TagType hi = Tags::fillLow(tag, tagLen() - prefixLen, true);
+    const StaticGGM_PPRF other(delegated);
+    std::vector<Node> theirs;
+    other.forEachNode([&](const Node &n) {
+        if (n.prefixLen < prefixLen || !Tags::samePrefix(n.start, lo, tagLen() - prefixLen)) {
+            throw InitializationException();
+        }
+        theirs.push_back(n);
+    });
+    if (prefixLen > frontierDepth) {
+        demoteSlot(lo);
+    }
+    std::vector<Node> ours;
+    std::vector<Node> coPath;
+    Position pos{};
+    const Node *node = findNode(lo, pos);
+    const bool covered = node != nullptr && node->prefixLen < prefixLen;
+    if (covered) {
+        /* split the covering node into the co-path of the subtree's root and the root itself */
+        ours.push_back(Node{lo, prefixLen, evalAndGetCoPath(lo, *node, coPath, prefixLen)});
+    } else {
+        forEachNodeIn(lo, hi, [&](const Node &n) { ours.push_back(n); });
+    }
+    std::vector<Node> merged = intersect(ours, theirs);
+    PKW_TRACE_SPAN(TraceOp::Splice, static_cast<int>(merged.size()), getNumNodes());
+    if (covered) {
+        Chunk &chunk = mutableChunk(pos.chunk);
+        chunk.erase(chunk.begin() + pos.index);
+        storage->numNodes -= 1;
+        rebalance(pos.chunk);
+        insertNodes(std::move(coPath));
+    } else {
+        eraseRange(lo, hi);
+    }
+    insertNodes(std::move(merged));
+    puncs += delegated.puncs;
+}
+
+template<size_t TagBits, size_t KeyBits>
+typename StaticGGM_PPRF<TagBits, KeyBits>::Value
+StaticGGM_PPRF<TagBits, KeyBits>::evalAndGetCoPath(const TagType &tag, const Node &node, std::vector<Node> &coPath, int untilLen) const {
+    const int depth = tagLen();
+    const int levels = (untilLen - node.prefixLen) / levelBits;
+    PKW_TRACE_SPAN(TraceOp::CoPath, levels, getNumNodes());
+    coPath.reserve(coPath.size() + levels * (arity() - 1));
+    std::vector<Node> right;
+
+    Value curr(node.value);
+    std::vector<Value> children(arity(), makeValue());
+    TagType start = node.start;
+    for (int i = depth - node.prefixLen - levelBits; i >= depth - untilLen; i -= levelBits) {
+        deriveChildren(curr, children);
+        const unsigned onPath = Tags::digit(tag, i, levelBits);
+        for (unsigned j = 0; j < onPath; ++j) {
+            TagType sibling = start;
+            Tags::setDigit(sibling, i, j);
+            coPath.push_back(Node{sibling, depth - i, children[j]});
+        }
+        /* descending, reversed with the levels below */
+        for (unsigned j = arity() - 1; j > onPath; --j) {
+            TagType sibling = start;
+            Tags::setDigit(sibling, i, j);
+            right.push_back(Node{sibling, depth - i, children[j]});
+        }
+        Tags::setDigit(start, i, onPath);
+        curr = children[onPath];
+    }
+    PKWMetrics::instance().count(MetricCounter::PRGInvocations, expansionCost() * levels);
+    /* right siblings were collected bottom-up, i.e. in descending order */
+    coPath.insert(coPath.end(), std::make_move_iterator(right.rbegin()), std::make_move_iterator(right.rend()));
+    return curr;
+}
+
+/**
+ * Counter block of the AES-CTR keystream of k-ary trees: the tag bits per level, then the block index.
+ */
+inline void ggmCounterBlock(int levelBits, uint64_t index, unsigned char *block) {
+    std::fill(block, block + CryptoPP::AES::BLOCKSIZE, 0);
+    block[0] = static_cast<unsigned char>(levelBits);
+    for (int i = CryptoPP::AES::BLOCKSIZE - 1; i >= CryptoPP::AES::BLOCKSIZE - 8; --i) {
+        block[i] = index & 0xFF;
+        index >>= 8;
+    }
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::deriveChild(const Value &parent, unsigned index, Value &child) const {
+    if (levelBits == 1) {
+        threadHKDF(child.data(), child.size(), parent.data(), parent.size(), index ? &GGM_RIGHT : &GGM_LEFT, 1);
+        return;
+    }
+    /* the child's part of the keystream, block by block */
+    CryptoPP::AES::Encryption aes(parent.data(), parent.size());
+    const size_t blocks = child.size() / CryptoPP::AES::BLOCKSIZE;
+    for (size_t b = 0; b < blocks; ++b) {
+        unsigned char *out = child.data() + b * CryptoPP::AES::BLOCKSIZE;
+        ggmCounterBlock(levelBits, index * blocks + b, out);
+        aes.ProcessBlock(out);
+    }
+}
+
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::deriveChildren(const Value &parent, std::vector<Value> &children) const {
+    if (levelBits == 1) {
+        deriveChild(parent, 0, children[0]);
+        deriveChild(parent, 1, children[1]);
+        return;
+    }
+    const size_t keyBytes = parent.size();
+    SecureByteBuffer stream(children.size() * keyBytes);
+    unsigned char iv[CryptoPP::AES::BLOCKSIZE];
+    ggmCounterBlock(levelBits, 0, iv);
+    CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption ctr;
+    ctr.SetKeyWithIV(parent.data(), parent.size(), iv, sizeof(iv));
+    ctr.GenerateBlock(stream.data(), stream.size());
+    for (size_t j = 0; j < children.size(); ++j) {
+        std::copy(stream.data() + j * keyBytes, stream.data() + (j + 1) * keyBytes, children[j].data());
+    }
+}
+
+template<size_t TagBits, size_t KeyBits>
+PPRFKey StaticGGM_PPRF<TagBits, KeyBits>::toKey() const {
+    std::vector<SecretRoot> roots;
+    roots.reserve(getNumNodes());
+    forEachNode([&](const Node &node) { roots.push_back(toRoot(node)); });
+    return {keyLen(), tagLen(), puncs, roots, arity()};
+}
+
+template<size_t TagBits, size_t KeyBits>
+SecretRoot StaticGGM_PPRF<TagBits, KeyBits>::toRoot(const Node &node) const {
+    std::string prefix(node.prefixLen, '0');
+    for (int i = 0; i < node.prefixLen; ++i) {
+        if (Tags::bit(node.start, tagLen() - 1 - i)) {
+            prefix[i] = '1';
+        }
+    }
+    SecureByteBuffer value(node.value.size());
+    std::copy(node.value.begin(), node.value.end(), value.begin());
+    return {prefix, value};
+}
+
+template<size_t TagBits, size_t KeyBits>
+MemoryUsage StaticGGM_PPRF<TagBits, KeyBits>::memoryUsageFor(size_t numNodes, const std::vector<size_t> &chunkCapacities) const {
+    const size_t keyBytes = keyLen() / 8;
+    const size_t valueHeap = GGMValue<KeyBits>::heapBytes(keyLen() / 8);
+    const size_t inlineSecret = valueHeap == 0 ? keyBytes : 0;
+    const size_t numChunks = chunkCapacities.size();
+    /* a make_shared block: two reference counts, a vtable pointer and the chunk's vector */
+    const size_t chunkBlock = 2 * sizeof(int) + sizeof(void *) + sizeof(Chunk);
+    MemoryUsage usage;
+    usage.secretBytes = numNodes * keyBytes;
+    usage.indexBytes = numNodes * (sizeof(TagType) + sizeof(int)) + numChunks * sizeof(TagType);
+    usage.containerBytes = sizeof(*this) + sizeof(Storage) + numChunks * (sizeof(std::shared_ptr<Chunk>) + chunkBlock) +
+                           numNodes * (sizeof(Node) - sizeof(TagType) - sizeof(int) - inlineSecret);
+    usage.slackBytes = heapChunkSize(sizeof(Storage)) - sizeof(Storage) + numChunks * (heapChunkSize(chunkBlock) - chunkBlock);
+    size_t chunkHeap = 0;
+    for (size_t capacity: chunkCapacities) {
+        chunkHeap += capacity > 0 ? heapChunkSize(capacity * sizeof(Node)) : 0;
+    }
+    usage.slackBytes += chunkHeap - numNodes * sizeof(Node);
+    if (valueHeap > 0) {
+        usage.slackBytes += numNodes * (heapChunkSize(valueHeap) - valueHeap);
+    }
+    return usage;
+}
+
+template<size_t TagBits, size_t KeyBits>
+std::vector<size_t> StaticGGM_PPRF<TagBits, KeyBits>::depthHistogram() const {
+    std::vector<size_t> histogram(tagLen() + 1, 0);
+    forEachNode([&](const Node &node) { histogram[node.prefixLen] += 1; });
+    return histogram;
+}
+
+template<size_t TagBits, size_t KeyBits>
+MemoryUsage StaticGGM_PPRF<TagBits, KeyBits>::memoryUsage() const {
+    std::vector<size_t> capacities;
+    for (const std::shared_ptr<Chunk> &chunk: storage->chunks) {
+        capacities.push_back(chunk->capacity());
+    }
+    MemoryUsage usage = memoryUsageFor(storage->numNodes, capacities);
+    addFrontierUsage(usage, frontier ? frontier->numLive : 0);
+    usage.depthHistogram = depthHistogram();
+    return usage;
+}
+
+/**
+ * Adds the frontier table with numLive live slots; erased slots keep their zeroized values, which count as slack.
+ */
+template<size_t TagBits, size_t KeyBits>
+void StaticGGM_PPRF<TagBits, KeyBits>::addFrontierUsage(MemoryUsage &usage, size_t numLive) const {
+    if (!frontier) {
+        return;
+    }
+    const size_t numSlots = size_t(1) << frontierDepth;
+    const size_t numChunks = frontier->chunks.size();
+    const size_t keyBytes = keyLen() / 8;
+    const size_t valueHeap = GGMValue<KeyBits>::heapBytes(keyLen() / 8);
+    const size_t inlineSecret = valueHeap == 0 ? keyBytes : 0;
+    const size_t chunkBlock = 2 * sizeof(int) + sizeof(void *) + sizeof(FrontierChunk);
+    usage.secretBytes += numLive * keyBytes;
+    usage.indexBytes += (numSlots + 7) / 8;
+    usage.containerBytes += sizeof(Frontier) + numChunks * (sizeof(std::shared_ptr<FrontierChunk>) + chunkBlock) + numSlots * (sizeof(Value) - inlineSecret);
+    usage.slackBytes += (numSlots - numLive) * keyBytes + numChunks * (heapChunkSize(chunkBlock) - chunkBlock);
+    if (valueHeap > 0) {
+        usage.slackBytes += numSlots * (heapChunkSize(valueHeap) - valueHeap);
+    }
+}
+
+template<size_t TagBits, size_t KeyBits>
+std::vector<typename StaticGGM_PPRF<TagBits, KeyBits>::TagType>
+StaticGGM_PPRF<TagBits, KeyBits>::projectedTags(size_t k, PunctureOrder order, uint64_t seed) const {
+    std::vector<TagType> tags;
+    tags.reserve(k);
+    if (order == PunctureOrder::Random) {
+        std::mt19937_64 rng(seed);
+        for (size_t i = 0; i < k; ++i) {
+            TagWords words{};
+            for (int w = 0; w * 64 < tagLen(); ++w) {
+                int bits = std::min(64, tagLen() - w * 64);
+                words[w] = bits == 64 ? rng() : rng() & ((uint64_t(1) << bits) - 1);
+            }
+            TagType tag{};
+            Tags::fromWords(words, tag);
+            tags.push_back(tag);
+        }
+    } else {
+        /* the smallest unpunctured tags are the leading tags of the leftmost subtrees */
+        forEachNode([&](const Node &node) {
+            int height = tagLen() - node.prefixLen;
+            for (uint64_t j = 0; tags.size() < k && (height >= 64 || j < (uint64_t(1) << height)); ++j) {
+                tags.push_back(Tags::orLow(node.start, j));
+            }
+        });
+    }
+    return tags;
+}
+
+template<size_t TagBits, size_t KeyBits>
+MemoryProjection StaticGGM_PPRF<TagBits, KeyBits>::projectMemoryUsage(size_t k, PunctureOrder order, uint64_t seed) const {
+    std::vector<TagType> tags = projectedTags(k, order, seed);
+    std::sort(tags.begin(), tags.end(), [](const TagType &a, const TagType &b) { return Tags::less(a, b); });
+    tags.erase(std::unique(tags.begin(), tags.end(), [](const TagType &a, const TagType &b) { return !Tags::less(a, b) && !Tags::less(b, a); }),
+               tags.end());
+
+    /*
+     * Puncturing the tags below a node replaces it by the siblings hanging off the union of their paths. With u[l] the
+     * number of distinct prefixes of l levels among the tags (relative to the node), arity * u[l] - u[l + 1] siblings
+     * hang at relative level l + 1. Consecutive sorted tags sharing c leading levels add one distinct prefix for every
+     * l > c.
+     */
+    std::vector<size_t> histogram = depthHistogram();
+    size_t slotsLeft = frontier ? frontier->numLive : 0;
+    Node slot{TagType(), 0, makeValue()};
+    size_t begin = 0;
+    while (begin < tags.size()) {
+        Position pos{};
+        const Node *found = findCovering(tags[begin], pos, slot);
+        size_t end = begin + 1;
+        if (found == nullptr) {
+            begin = end; /* already punctured */
+            continue;
+        }
+        if (found == &slot) {
+            slotsLeft -= 1; /* the punctures below move it to the chunks */
+        }
+        const Node &node = *found;
+        const int height = tagLen() - node.prefixLen;
+        while (end < tags.size() && Tags::samePrefix(tags[end], node.start, height)) {
+            ++end;
+        }
+        const int levels = height / levelBits;
+        std::vector<size_t> newPrefixes(levels + 1, 0);
+        for (size_t t = begin + 1; t < end; ++t) {
+            int common = 0;
+            while (common < levels && Tags::digit(tags[t - 1], height - levelBits * (common + 1), levelBits) ==
+                                              Tags::digit(tags[t], height - levelBits * (common + 1), levelBits)) {
+                ++common;
+            }
+            newPrefixes[common + 1] += 1;
+        }
+        size_t prefixes = 1;
+        histogram[node.prefixLen] -= 1;
+        for (int l = 0; l < levels; ++l) {
+            size_t next = prefixes + newPrefixes[l + 1];
+            histogram[node.prefixLen + (l + 1) * levelBits] += arity() * prefixes - next;
+            prefixes = next;
+        }
+        begin = end;
+    }
+
+    MemoryProjection projection;
+    for (size_t count: histogram) {
+        projection.numNodes += count;
+    }
+    /* chunks split when they reach 2 * CHUNK_NODES, so they are roughly CHUNK_NODES full */
+    const size_t stored = projection.numNodes - slotsLeft;
+    std::vector<size_t> capacities((stored + CHUNK_NODES - 1) / CHUNK_NODES, 2 * CHUNK_NODES);
+    projection.usage = memoryUsageFor(stored, capacities);
+    addFrontierUsage(projection.usage, slotsLeft);
+    projection.serializedBytes = PPRFKeySerializer::serializedSize(keyLen(), histogram, arity());
+    projection.usage.depthHistogram = std::move(histogram);
+    return projection;
+}
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_STATIC_GGM_PPRF_H
@@ -0,0 +1,60 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_SECURE_ARRAY_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_SECURE_ARRAY_H
+#include "secure_memzero.h"
+#include <array>
+#include <cstddef>
+
+/**
+ * A fixed-size byte array which erases the memory it occupies before it is destructed.
+ * Counterpart of SecureByteBuffer for sizes known at compile time; it lives inline and never touches the heap.
+ * @tparam N the number of bytes
+ */
+template<size_t N>
+class SecureArray {
+    public:
+        SecureArray() : arr() {}
+        SecureArray(const SecureArray &other) = default;
+        SecureArray &operator=(const SecureArray &rhs) = default;
+        ~SecureArray() {
+            secure_memzero(arr.data(), N);
+        }
+
+        unsigned char *data() { return arr.data(); }
+        const unsigned char *data() const { return arr.data(); }
+        static constexpr size_t size() { return N; }
+
+        using iterator = typename std::array<unsigned char, N>::iterator;
+        using const_iterator = typename std::array<unsigned char, N>::const_iterator;
+
+        iterator begin() { return arr.begin(); }
+        iterator end() { return arr.end(); }
+        const_iterator begin() const { return arr.begin(); }
+        const_iterator end() const { return arr.end(); }
+
+        bool operator==(const SecureArray &rhs) const { return arr == rhs.arr; }
+        bool operator!=(const SecureArray &rhs) const { return arr != rhs.arr; }
+
+    private:
+        std::array<unsigned char, N> arr;
+};
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_SECURE_ARRAY_H
@@ -20,6 +20,7 @@
 
 #ifndef PUNCTURABLE_KEY_WRAPPING_CPP_SECURE_BYTE_BUFFER_H
 #define PUNCTURABLE_KEY_WRAPPING_CPP_SECURE_BYTE_BUFFER_H
+#include <cstddef>
 #include <vector>
 
 /**
@@ -54,6 +55,10 @@ class SecureByteBuffer {
         unsigned char *data();
         const unsigned char *data() const;
         size_t size() const;
+        /**
+         * Exchanges the memory of both buffers without copying.
+         */
+        void swap(SecureByteBuffer &other) noexcept { vec.swap(other.vec); }
 
         using container = std::vector<unsigned char>;
         using iterator = typename container::iterator;
@@ -0,0 +1,112 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_THREAD_CRYPTO_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_THREAD_CRYPTO_H
+#include "secure_memzero.h"
+#include <algorithm>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/hmac.h>
+#include <cryptopp/sha.h>
+#include <cstddef>
+
+/* the key every borrowed object is rekeyed with when it is returned */
+static const unsigned char THREAD_CRYPTO_ZERO_KEY[32] = {};
+
+/**
+ * Erases the key state of hmac by rekeying it in place.
+ */
+inline void scrubKey(CryptoPP::HMAC<CryptoPP::SHA256> &hmac) {
+    hmac.SetKey(THREAD_CRYPTO_ZERO_KEY, sizeof(THREAD_CRYPTO_ZERO_KEY));
+}
+
+/**
+ * Erases the key state, i.e. the AES key schedule and the GHASH tables, of an AES-GCM object by rekeying it in place.
+ */
+template<class Cipher>
+inline void scrubKey(Cipher &cipher) {
+    cipher.SetKeyWithIV(THREAD_CRYPTO_ZERO_KEY, 16, THREAD_CRYPTO_ZERO_KEY, 12);
+}
+
+/**
+ * Borrows the calling thread's instance of a Crypto++ object that is rekeyed in place. Its buffers are allocated by
+ * the first borrow of a thread, instead of on every construction, which keeps the eval, wrap and unwrap paths free
+ * of heap allocations. The instance is scrubbed when the borrow ends, so no key state outlives the borrower.
+ * <br>
+ * A thread may hold only one borrow of each type at a time.
+ * @tparam T HMAC<SHA256>, GCM<AES>::Encryption or GCM<AES>::Decryption
+ */
+template<class T>
+class ThreadLocalCrypto {
+    public:
+        ThreadLocalCrypto() : object(instance()) {}
+        ~ThreadLocalCrypto() {
+            scrubKey(object);
+        }
+
+        ThreadLocalCrypto(const ThreadLocalCrypto &) = delete;
+        ThreadLocalCrypto &operator=(const ThreadLocalCrypto &) = delete;
+
+        T &operator*() { return object; }
+        T *operator->() { return &object; }
+
+    private:
+        T &object;
+
+        static T &instance() {
+            thread_local T t;
+            return t;
+        }
+};
+
+/**
+ * HKDF with SHA-256 and an empty salt (RFC 5869), on the thread's HMAC object; equals
+ * CryptoPP::HKDF<SHA256>::DeriveKey with a null salt, which constructs and allocates a new HMAC on every call.
+ * @param derived receives derivedLen bytes, at most 255 * 32
+ */
+inline void threadHKDF(unsigned char *derived, size_t derivedLen, const unsigned char *secret, size_t secretLen,
+                       const unsigned char *info, size_t infoLen) {
+    const size_t hashLen = CryptoPP::SHA256::DIGESTSIZE;
+    ThreadLocalCrypto<CryptoPP::HMAC<CryptoPP::SHA256>> hmac;
+    unsigned char prk[CryptoPP::SHA256::DIGESTSIZE];
+    unsigned char t[CryptoPP::SHA256::DIGESTSIZE];
+    /* extract; the empty salt is a string of hashLen zeros */
+    hmac->SetKey(THREAD_CRYPTO_ZERO_KEY, hashLen);
+    hmac->Update(secret, secretLen);
+    hmac->Final(prk);
+    /* expand */
+    size_t done = 0;
+    for (unsigned char counter = 1; done < derivedLen; ++counter) {
+        hmac->SetKey(prk, hashLen);
+        if (counter > 1) {
+            hmac->Update(t, hashLen);
+        }
+        hmac->Update(info, infoLen);
+        hmac->Update(&counter, 1);
+        hmac->Final(t);
+        const size_t n = std::min(hashLen, derivedLen - done);
+        std::copy(t, t + n, derived + done);
+        done += n;
+    }
+    secure_memzero(prk, sizeof(prk));
+    secure_memzero(t, sizeof(t));
+}
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_THREAD_CRYPTO_H
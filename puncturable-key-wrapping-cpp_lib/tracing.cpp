@@ -0,0 +1,96 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#include "tracing.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+
+static std::atomic<TraceSink *> installedSink{nullptr};
+
+void setTraceSink(TraceSink *sink) {
+    installedSink.store(sink, std::memory_order_release);
+}
+
+TraceSink *traceSink() {
+    return installedSink.load(std::memory_order_acquire);
+}
+
+const char *traceOpName(TraceOp op) {
+    switch (op) {
+        case TraceOp::Eval:
+            return "eval";
+        case TraceOp::Punc:
+            return "punc";
+        case TraceOp::NodeSearch:
+            return "node_search";
+        case TraceOp::Derivation:
+            return "derivation";
+        case TraceOp::CoPath:
+            return "co_path";
+        case TraceOp::Splice:
+            return "splice";
+        case TraceOp::Serialize:
+            return "serialize";
+        case TraceOp::Deserialize:
+            return "deserialize";
+        case TraceOp::Wrap:
+            return "wrap";
+        case TraceOp::Unwrap:
+            return "unwrap";
+        case TraceOp::AEAD:
+            return "aead";
+        case TraceOp::Zeroize:
+            return "zeroize";
+    }
+    return "unknown";
+}
+
+ChromeTraceSink::ChromeTraceSink(const std::string &path) : out(path, std::ofstream::out), start(std::chrono::steady_clock::now()) {
+    out << "{\"traceEvents\":[\n";
+}
+
+ChromeTraceSink::~ChromeTraceSink() {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "\n]}\n";
+    out.close();
+}
+
+void ChromeTraceSink::begin(TraceOp op, int depth, size_t nodes) {
+    write('B', op, depth, nodes);
+}
+
+void ChromeTraceSink::end(TraceOp op, int depth, size_t nodes) {
+    write('E', op, depth, nodes);
+}
+
+void ChromeTraceSink::write(char phase, TraceOp op, int depth, size_t nodes) {
+    double ts = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    size_t tid = std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000000;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!first) {
+        out << ",\n";
+    }
+    first = false;
+    out << "{\"name\":\"" << traceOpName(op) << "\",\"ph\":\"" << phase << "\",\"ts\":" << std::fixed << ts
+        << ",\"pid\":" << getpid() << ",\"tid\":" << tid
+        << ",\"args\":{\"depth\":" << depth << ",\"nodes\":" << nodes << "}}";
+}
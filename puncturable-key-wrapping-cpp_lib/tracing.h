@@ -0,0 +1,139 @@
+/***********************************************************************************************************************
+ * Copyright 2022 Younis Khalil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *
+ **********************************************************************************************************************/
+
+#ifndef PUNCTURABLE_KEY_WRAPPING_CPP_TRACING_H
+#define PUNCTURABLE_KEY_WRAPPING_CPP_TRACING_H
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+/*
+ * Tracing hooks around derivations, punctures, serialization and AEAD calls.
+ *
+ * The hooks (PKW_TRACE_SPAN) are only compiled in if PKW_TRACING is defined (CMake option PKW_TRACING=ON); otherwise they
+ * expand to nothing and their arguments are not evaluated. When compiled in, spans are reported to the sink installed
+ * with setTraceSink, and cost a single atomic load while no sink is installed.
+ */
+
+enum class TraceOp {
+    Eval,
+    Punc,
+    /* binary search for the node covering a tag */
+    NodeSearch,
+    /* walk from a node down to a leaf */
+    Derivation,
+    /* derivation of the co-path of a punctured tag */
+    CoPath,
+    /* replacing a node by its co-path in the node array, including zeroization of the replaced node */
+    Splice,
+    Serialize,
+    Deserialize,
+    Wrap,
+    Unwrap,
+    /* the authenticated encryption or decryption after the wrapping key was derived */
+    AEAD,
+    Zeroize
+};
+
+/**
+ * Returns a printable name of the operation.
+ */
+const char *traceOpName(TraceOp op);
+
+/**
+ * Receives the spans. Implementations must be thread-safe; begin and end of one span are reported on the same thread.
+ */
+class TraceSink {
+    public:
+        virtual ~TraceSink() = default;
+        /**
+         * @param op the operation
+         * @param depth the number of tree levels the operation covers (e.g. derivation steps), 0 if not applicable
+         * @param nodes the number of nodes of the key when the span started
+         */
+        virtual void begin(TraceOp op, int depth, size_t nodes) = 0;
+        virtual void end(TraceOp op, int depth, size_t nodes) = 0;
+};
+
+/**
+ * Installs the process-wide sink; nullptr removes it. The caller keeps ownership and must keep the sink alive until it
+ * was removed and no span is running anymore.
+ */
+void setTraceSink(TraceSink *sink);
+TraceSink *traceSink();
+
+/**
+ * Reports begin and end of its own lifetime to the installed sink.
+ */
+class TraceSpan {
+    public:
+        TraceSpan(TraceOp op, int depth, size_t nodes) : sink(traceSink()), op(op), depth(depth), nodes(nodes) {
+            if (sink) {
+                sink->begin(op, depth, nodes);
+            }
+        }
+        ~TraceSpan() {
+            if (sink) {
+                sink->end(op, depth, nodes);
+            }
+        }
+        TraceSpan(const TraceSpan &) = delete;
+        TraceSpan &operator=(const TraceSpan &) = delete;
+
+    private:
+        TraceSink *sink;
+        TraceOp op;
+        int depth;
+        size_t nodes;
+};
+
+#define PKW_TRACE_CONCAT_(a, b) a##b
+#define PKW_TRACE_CONCAT(a, b) PKW_TRACE_CONCAT_(a, b)
+#ifdef PKW_TRACING
+#define PKW_TRACE_SPAN(op, depth, nodes) TraceSpan PKW_TRACE_CONCAT(pkwTraceSpan, __LINE__)((op), (depth), (nodes))
+#else
+#define PKW_TRACE_SPAN(op, depth, nodes) \
+    do {                                 \
+    } while (0)
+#endif
+
+/**
+ * A sink writing spans as Chrome trace-event JSON ("B"/"E" duration events), to be loaded into chrome://tracing or
+ * Perfetto. The file is completed when the sink is destructed.
+ */
+class ChromeTraceSink : public TraceSink {
+    public:
+        explicit ChromeTraceSink(const std::string &path);
+        ~ChromeTraceSink() override;
+        void begin(TraceOp op, int depth, size_t nodes) override;
+        void end(TraceOp op, int depth, size_t nodes) override;
+
+    private:
+        std::mutex mutex;
+        std::ofstream out;
+        bool first = true;
+        std::chrono::steady_clock::time_point start;
+        void write(char phase, TraceOp op, int depth, size_t nodes);
+};
+
+#endif//PUNCTURABLE_KEY_WRAPPING_CPP_TRACING_H
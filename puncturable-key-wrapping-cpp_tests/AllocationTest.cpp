@@ -0,0 +1,163 @@
+#include "metrics.h"
+#include "pkw/pprf_aead_pkw.h"
+#include "pkw/wrapped_key_store.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+#include <pprf/ggm_pprf.h>
+#include <vector>
+
+/*
+ * Counts every heap allocation of the executable: the global operator new is replaced, and malloc, calloc, realloc and
+ * the aligned allocators are interposed, since Crypto++ allocates its buffers with malloc. The interposed functions
+ * forward to glibc's implementations.
+ */
+static std::atomic<size_t> allocations(0);
+
+extern "C" {
+void *__libc_malloc(size_t n);
+void *__libc_calloc(size_t count, size_t n);
+void *__libc_realloc(void *p, size_t n);
+void *__libc_memalign(size_t alignment, size_t n);
+
+void *malloc(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(n);
+}
+void *calloc(size_t count, size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, n);
+}
+void *realloc(void *p, size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+void *memalign(size_t alignment, size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, n);
+}
+void *aligned_alloc(size_t alignment, size_t n) {
+    return memalign(alignment, n);
+}
+int posix_memalign(void **p, size_t alignment, size_t n) {
+    *p = memalign(alignment, n);
+    return *p == nullptr ? ENOMEM : 0;
+}
+}
+
+void *operator new(size_t n) {
+    void *p = std::malloc(n == 0 ? 1 : n);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void *operator new[](size_t n) {
+    return operator new(n);
+}
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static const int ROUNDS = 1000;
+
+class AllocationTest : public ::testing::TestWithParam<int> {
+    protected:
+        void SetUp() override {
+            PKWMetrics::instance().setEnabled(true);
+        }
+        void TearDown() override {
+            PKWMetrics::instance().setEnabled(false);
+        }
+};
+
+TEST_P(AllocationTest, TestEvalDoesNotAllocate) {
+    GGM_PPRF pprf(PPRFKey::generate(GetParam(), 32));
+    for (uint32_t i = 0; i < 100; ++i) {
+        pprf.punc(Tag(i * 0x2000000u + 1));
+    }
+    unsigned char out[32];
+    pprf.eval(Tag(0), out);
+    size_t before = allocations.load();
+    for (uint32_t i = 0; i < ROUNDS; ++i) {
+        pprf.eval(Tag(i * 0x400000u), out);
+    }
+    ASSERT_EQ(allocations.load() - before, 0u);
+}
+
+TEST_P(AllocationTest, TestWrapUnwrapDoNotAllocate) {
+    PPRF_AEAD_PKW pkw(PPRFKey::generate(GetParam(), 32).serialize());
+    for (uint32_t i = 0; i < 100; ++i) {
+        pkw.punc(Tag(i * 0x2000000u + 1));
+    }
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    ciphertext c;
+    std::vector<unsigned char> unwrapped;
+    pkw.wrap(Tag(0), header, key, c);
+    pkw.unwrap(Tag(0), header, c, unwrapped);
+    size_t before = allocations.load();
+    for (uint32_t i = 0; i < ROUNDS; ++i) {
+        pkw.wrap(Tag(i * 0x400000u), header, key, c);
+        pkw.unwrap(Tag(i * 0x400000u), header, c, unwrapped);
+    }
+    size_t allocated = allocations.load() - before;
+    ASSERT_EQ(allocated, 0u);
+    ASSERT_EQ(unwrapped, key);
+}
+
+TEST_P(AllocationTest, TestFailedTryUnwrapDoesNotAllocate) {
+    PPRF_AEAD_PKW pkw(PPRFKey::generate(GetParam(), 32).serialize());
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    ciphertext c;
+    std::vector<unsigned char> unwrapped;
+    pkw.wrap(Tag(7), header, key, c);
+    pkw.punc(Tag(7));
+    pkw.tryUnwrap(Tag(7), header, c, unwrapped);
+    size_t before = allocations.load();
+    size_t punctured = 0;
+    for (uint32_t i = 0; i < ROUNDS; ++i) {
+        punctured += pkw.tryUnwrap(Tag(7), header, c, unwrapped) == PKWError::Punctured;
+        punctured += pkw.isPunctured(Tag(7));
+    }
+    size_t allocated = allocations.load() - before;
+    ASSERT_EQ(allocated, 0u);
+    ASSERT_EQ(punctured, 2u * ROUNDS);
+}
+
+TEST_P(AllocationTest, TestStoreGetDoesNotAllocate) {
+    const std::string path = "allocation_test_store.log";
+    std::remove(path.c_str());
+    PPRF_AEAD_PKW pkw(PPRFKey::generate(GetParam(), 32).serialize());
+    std::vector<unsigned char> key(32, 'k');
+    std::vector<unsigned char> unwrapped;
+    {
+        WrappedKeyStore store(pkw, path);
+        for (uint32_t i = 0; i < 100; ++i) {
+            store.put(Tag(i), std::vector<unsigned char>(16, 'h'), key);
+        }
+        store.get(Tag(0), unwrapped);
+        size_t before = allocations.load();
+        for (uint32_t i = 0; i < ROUNDS; ++i) {
+            store.get(Tag(i % 100), unwrapped);
+        }
+        ASSERT_EQ(allocations.load() - before, 0u);
+        ASSERT_EQ(unwrapped, key);
+    }
+    std::remove(path.c_str());
+}
+
+INSTANTIATE_TEST_SUITE_P(KeyLengths, AllocationTest, ::testing::Values(128, 256));
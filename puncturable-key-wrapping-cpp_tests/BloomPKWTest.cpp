@@ -0,0 +1,121 @@
+#include "pkw/bloom_pkw.h"
+#include "pkw/exceptions.h"
+#include "pkw/helpers/password_encrypt.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+class BloomPKWTest : public ::testing::Test {
+    public:
+        BloomPKWTest() : pkw(BloomPKW::parametersFor(1000, 0.001)), head(4, 'h'), key(16, 'k') {}
+
+        BloomPKW pkw;
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST_F(BloomPKWTest, TestWrapThenUnwrap) {
+    Tag tag(12345);
+    auto wrapped = pkw.wrap(tag, head, key);
+    ASSERT_EQ(pkw.unwrap(tag, head, wrapped), key);
+    ASSERT_NE(wrapped, pkw.wrap(tag, head, key)) << "every wrap uses a fresh data key";
+    ASSERT_THROW(pkw.unwrap(Tag(12346), head, wrapped), UnwrappingException);
+    std::vector<unsigned char> otherHead(4, 'x');
+    ASSERT_THROW(pkw.unwrap(tag, otherHead, wrapped), UnwrappingException);
+    wrapped.back() ^= 1;
+    ASSERT_THROW(pkw.unwrap(tag, head, wrapped), UnwrappingException);
+    std::vector<unsigned char> truncated(4);
+    ASSERT_THROW(pkw.unwrap(tag, head, truncated), UnwrappingException);
+}
+
+TEST_F(BloomPKWTest, TestPuncThenUnwrap) {
+    Tag tag = Tag(7) << 200;
+    auto wrapped = pkw.wrap(tag, head, key);
+    pkw.punc(tag);
+    pkw.punc(tag);
+    ASSERT_EQ(pkw.getNumPuncs(), 1);
+    ASSERT_TRUE(pkw.isPunctured(tag));
+    ASSERT_THROW(pkw.unwrap(tag, head, wrapped), IllegalTagException);
+    ASSERT_THROW(pkw.wrap(tag, head, key), IllegalTagException);
+}
+
+TEST_F(BloomPKWTest, TestUnwrapAfterOtherPunctures) {
+    std::vector<std::vector<unsigned char>> wrapped;
+    for (int t = 0; t < 100; ++t) {
+        wrapped.push_back(pkw.wrap(Tag(t), head, key));
+    }
+    for (int t = 100; t < 1000; ++t) {
+        pkw.punc(Tag(t));
+    }
+    /* tags sharing a slot with punctured ones still unwrap from their remaining slots */
+    int falsePunctures = 0;
+    for (int t = 0; t < 100; ++t) {
+        if (pkw.isPunctured(Tag(t))) {
+            ++falsePunctures;
+            continue;
+        }
+        ASSERT_EQ(pkw.unwrap(Tag(t), head, wrapped[t]), key);
+    }
+    ASSERT_LE(falsePunctures, 2);
+}
+
+TEST_F(BloomPKWTest, TestFixedSizeSerialization) {
+    SecureByteBuffer fresh = pkw.serializeKey();
+    Tag tag(3);
+    auto wrapped = pkw.wrap(tag, head, key);
+    for (int t = 100; t < 600; ++t) {
+        pkw.punc(Tag(t));
+    }
+    SecureByteBuffer serialized = pkw.serializeKey();
+    ASSERT_EQ(serialized.size(), fresh.size());
+
+    auto restored = BloomPKWFactory().fromSerialized(serialized);
+    ASSERT_EQ(restored->getNumPuncs(), pkw.getNumPuncs());
+    ASSERT_EQ(restored->unwrap(tag, head, wrapped), key);
+    auto punctured = pkw.wrap(tag, head, key);
+    restored->punc(tag);
+    ASSERT_THROW(restored->unwrap(tag, head, punctured), IllegalTagException);
+
+    SecureByteBuffer encrypted = pkw.serializeAndEncryptKey("password");
+    SecureByteBuffer decrypted = decryptExport(encrypted, "password");
+    ASSERT_EQ(BloomPKWFactory().fromSerialized(decrypted)->unwrap(tag, head, wrapped), key);
+
+    SecureByteBuffer truncated(serialized.size() - 1);
+    std::copy(serialized.begin(), serialized.end() - 1, truncated.begin());
+    ASSERT_THROW(BloomPKWFactory().fromSerialized(truncated), DeserializationError);
+}
+
+TEST(BloomPKW, TestParameters) {
+    BloomParameters p = BloomPKW::parametersFor(1000, 0.01);
+    ASSERT_NEAR(p.numSlots, 9586, 1);
+    ASSERT_EQ(p.numHashes, 7);
+    ASSERT_LE(BloomPKW::expectedFalsePunctureRate(p, 1000), 0.011);
+    ASSERT_THROW(BloomPKW::parametersFor(0, 0.01), std::invalid_argument);
+    ASSERT_THROW(BloomPKW::parametersFor(10, 1.0), std::invalid_argument);
+    ASSERT_THROW(BloomPKW(0, 3), std::invalid_argument);
+    ASSERT_THROW(BloomPKW(16, BloomPKW::MAX_HASHES + 1), std::invalid_argument);
+}
+
+TEST(BloomPKW, TestFalsePunctureRate) {
+    BloomParameters p = BloomPKW::parametersFor(2000, 0.05);
+    BloomPKW pkw(p);
+    ASSERT_EQ(pkw.falsePunctureRate(), 0.0);
+    for (int t = 0; t < 2000; ++t) {
+        pkw.punc(Tag(t));
+    }
+    ASSERT_NEAR(pkw.falsePunctureRate(), 0.05, 0.02);
+    int falsePunctures = 0;
+    for (int t = 2000; t < 12000; ++t) {
+        falsePunctures += pkw.isPunctured(Tag(t));
+    }
+    ASSERT_NEAR(falsePunctures / 10000.0, pkw.falsePunctureRate(), 0.015);
+}
+
+TEST(BloomPKW, TestTeardown) {
+    BloomPKW pkw(64, 2);
+    std::vector<unsigned char> head(4, 'h');
+    std::vector<unsigned char> key(16, 'k');
+    pkw.secureTeardown();
+    ASSERT_EQ(pkw.numErased(), 64u);
+    ASSERT_THROW(pkw.wrap(Tag(1), head, key), IllegalTagException);
+}
@@ -0,0 +1,174 @@
+#include "pkw/exceptions.h"
+#include "pkwd_client.h"
+#include "pkwd_server.h"
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class DaemonTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            char tmpl[] = "/tmp/pkwd_test.XXXXXX";
+            ASSERT_NE(::mkdtemp(tmpl), nullptr);
+            dir = tmpl;
+            config.socketPath = dir + "/pkwd.sock";
+            config.keyPath = dir + "/pkwd.key";
+            config.tagLen = 32;
+        }
+
+        void TearDown() override {
+            stopServer();
+            std::remove(config.keyPath.c_str());
+            ::rmdir(dir.c_str());
+        }
+
+        void startServer() {
+            server.reset(new PKWDServer(config));
+            thread = std::thread([this]() { server->run(); });
+        }
+
+        void stopServer() {
+            if (server) {
+                server->stop();
+                thread.join();
+                server.reset();
+            }
+        }
+
+    public:
+        DaemonTest() : head(4, 'h'), key(16, 'k') {}
+
+        std::string dir;
+        PKWDConfig config;
+        std::unique_ptr<PKWDServer> server;
+        std::thread thread;
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST_F(DaemonTest, TestWrapUnwrapPunc) {
+    startServer();
+    PKWDClient client(config.socketPath);
+    std::vector<unsigned char> c = client.wrap(7, head, key);
+    ASSERT_EQ(client.unwrap(7, head, c), key);
+    ASSERT_THROW(client.unwrap(8, head, c), UnwrappingException);
+    ASSERT_THROW(client.wrap(Tag(1) << 32, head, key), IllegalTagException);
+    client.punc(7);
+    client.punc(7);
+    ASSERT_EQ(client.getNumPuncs(), 1);
+    ASSERT_THROW(client.unwrap(7, head, c), IllegalTagException);
+    ASSERT_THROW(client.punc(Tag(1) << 32), IllegalTagException);
+    ASSERT_EQ(server->getNumCommits(), 2) << "One commit creating the key, one for the first puncture";
+}
+
+TEST_F(DaemonTest, TestPuncturesPersist) {
+    config.password = "myPassword";
+    startServer();
+    std::vector<unsigned char> c1;
+    std::vector<unsigned char> c2;
+    {
+        PKWDClient client(config.socketPath);
+        c1 = client.wrap(1, head, key);
+        c2 = client.wrap(2, head, key);
+        client.punc(1);
+    }
+    stopServer();
+    startServer();
+    PKWDClient client(config.socketPath);
+    ASSERT_EQ(client.getNumPuncs(), 1);
+    ASSERT_THROW(client.unwrap(1, head, c1), IllegalTagException);
+    ASSERT_EQ(client.unwrap(2, head, c2), key);
+    stopServer();
+    config.password = "wrongPassword";
+    ASSERT_THROW(startServer(), ImportException);
+}
+
+TEST_F(DaemonTest, TestPipelinedRequestsAreBatched) {
+    startServer();
+    const int clients = 4;
+    const int rounds = 20;
+    const int depth = 16;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < clients; ++t) {
+        threads.emplace_back([&, t]() {
+            PKWDClient client(config.socketPath);
+            for (int r = 0; r < rounds; ++r) {
+                std::vector<PKWDRequest> requests;
+                for (int i = 0; i < depth; ++i) {
+                    requests.push_back({PKWDOp::Wrap, 0, Tag(t * 1000 + i), head, key});
+                }
+                requests.push_back({PKWDOp::Punc, 0, Tag(100000 + t * rounds + r), {}, {}});
+                std::vector<PKWDResponse> responses = client.pipeline(requests);
+                for (int i = 0; i < depth; ++i) {
+                    EXPECT_EQ(responses[i].status, PKWError::None);
+                }
+                EXPECT_EQ(responses[depth].status, PKWError::None);
+            }
+        });
+    }
+    for (std::thread &t: threads) {
+        t.join();
+    }
+    PKWDClient client(config.socketPath);
+    ASSERT_EQ(client.getNumPuncs(), clients * rounds);
+    ASSERT_LE(server->getNumBatches(), size_t(clients * rounds + 1)) << "A round is evaluated in one batch";
+    ASSERT_LE(server->getNumCommits(), size_t(clients * rounds + 1));
+}
+
+TEST_F(DaemonTest, TestMalformedFrameClosesConnection) {
+    startServer();
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", config.socketPath.c_str());
+    ASSERT_EQ(::connect(fd, (sockaddr *) &addr, sizeof(addr)), 0);
+    unsigned char frame[] = {3, 0, 0, 0, 9, 9, 9};
+    ASSERT_EQ(::write(fd, frame, sizeof(frame)), (ssize_t) sizeof(frame));
+    unsigned char b;
+    ASSERT_EQ(::read(fd, &b, 1), 0) << "The daemon hangs up";
+    ::close(fd);
+
+    PKWDClient client(config.socketPath);
+    ASSERT_EQ(client.unwrap(3, head, client.wrap(3, head, key)), key);
+}
+
+TEST_F(DaemonTest, TestUnreadResponsesCloseConnection) {
+    config.maxPendingOutput = 4096;
+    startServer();
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", config.socketPath.c_str());
+    ASSERT_EQ(::connect(fd, (sockaddr *) &addr, sizeof(addr)), 0);
+    std::vector<unsigned char> frames;
+    const int requests = 4096;
+    const std::vector<unsigned char> longKey(1024, 'k');
+    for (int i = 0; i < requests; ++i) {
+        encodeRequest({PKWDOp::Wrap, uint32_t(i), Tag(i), head, longKey}, frames);
+    }
+    /* the requests are sent without reading a response; the daemon hangs up before all are sent */
+    size_t sent = 0;
+    while (sent < frames.size()) {
+        ssize_t w = ::send(fd, frames.data() + sent, frames.size() - sent, MSG_NOSIGNAL);
+        if (w <= 0) {
+            break;
+        }
+        sent += w;
+    }
+    std::vector<unsigned char> buf(64 * 1024);
+    size_t received = 0;
+    ssize_t r;
+    while ((r = ::read(fd, buf.data(), buf.size())) > 0) {
+        received += r;
+    }
+    ::close(fd);
+    ASSERT_LT(received, requests * longKey.size()) << "The daemon hangs up";
+
+    PKWDClient client(config.socketPath);
+    ASSERT_EQ(client.unwrap(3, head, client.wrap(3, head, key)), key);
+}
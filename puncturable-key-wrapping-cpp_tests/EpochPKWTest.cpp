@@ -0,0 +1,105 @@
+#include "pkw/epoch_pkw.h"
+#include "pkw/exceptions.h"
+#include <gtest/gtest.h>
+#include <pprf/ggm_pprf.h>
+#include <pprf/pprf_exceptions.h>
+#include <thread>
+#include <vector>
+
+class EpochPKWTest : public ::testing::Test {
+    protected:
+    public:
+        EpochPKWTest() : pkw(16, 32, 3), head(4, 'h'), key(16, 'k') {}
+
+        EpochPKW pkw;
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST(GGMPPRFPrefixTest, TestPuncPrefix) {
+    GGM_PPRF pprf(PPRFKey(128, 10));
+    pprf.punc(0x0F3);
+    pprf.puncPrefix(0x0C0, 4);/* tags 0x0C0 to 0x0FF */
+    ASSERT_THROW(pprf.eval(0x0C0), TagException);
+    ASSERT_THROW(pprf.eval(0x0FF), TagException);
+    ASSERT_NO_THROW(pprf.eval(0x0BF));
+    ASSERT_NO_THROW(pprf.eval(0x100));
+    ASSERT_EQ(pprf.getNumNodes(), 4u) << "siblings of the subtree on the way down";
+    ASSERT_EQ(pprf.getNumPuncs(), 2);
+    pprf.puncPrefix(0, 1);
+    ASSERT_EQ(pprf.getNumNodes(), 1u);
+    ASSERT_NO_THROW(pprf.eval(0x3FF));
+    pprf.puncPrefix(0x3FF, 10);
+    ASSERT_THROW(pprf.eval(0x3FF), TagException);
+    ASSERT_THROW(pprf.puncPrefix(0, 11), TagException);
+}
+
+TEST(GGMPPRFPrefixTest, TestPuncPrefixAcrossChunks) {
+    GGM_PPRF pprf(PPRFKey(128, 32));
+    for (uint32_t i = 0; i < 300; ++i) {
+        pprf.punc(Tag(0x10000000u + i * 0x1000u));
+    }
+    GGM_PPRFSnapshot snapshot = pprf.snapshot();
+    pprf.puncPrefix(Tag(0x10000000u), 4);
+    ASSERT_EQ(pprf.getNumNodes(), 4u);
+    ASSERT_THROW(pprf.eval(Tag(0x1FFFFFFFu)), TagException);
+    ASSERT_EQ(pprf.eval(Tag(0x20000000u)), snapshot.eval(Tag(0x20000000u)));
+    ASSERT_NO_THROW(snapshot.eval(Tag(0x1FFFFFFFu)));
+}
+
+TEST_F(EpochPKWTest, TestWrapUnwrapWithinWindow) {
+    auto c0 = pkw.wrap({0, 7}, head, key);
+    pkw.advanceTo(2);
+    auto c2 = pkw.wrap({2, 7}, head, key);
+    ASSERT_NE(c0, c2);
+    ASSERT_EQ(pkw.unwrap({0, 7}, head, c0), key);
+    ASSERT_THROW(pkw.wrap({3, 0}, head, key), IllegalTagException) << "future epoch";
+    ASSERT_THROW(pkw.wrap({2, uint64_t(1) << 32}, head, key), IllegalTagException);
+    pkw.punc({2, 7});
+    ASSERT_THROW(pkw.unwrap({2, 7}, head, c2), IllegalTagException);
+    pkw.advanceTo(3);
+    ASSERT_EQ(pkw.oldestLiveEpoch(), 1u);
+    ASSERT_THROW(pkw.unwrap({0, 7}, head, c0), IllegalTagException);
+}
+
+TEST_F(EpochPKWTest, TestKeySizeFollowsLiveEpochs) {
+    for (uint64_t epoch = 0; epoch < 200; ++epoch) {
+        pkw.advanceTo(epoch);
+        for (uint64_t counter = 0; counter < 10; ++counter) {
+            pkw.punc({epoch, counter * 1000});
+        }
+    }
+    /* co-paths of the punctures in the 3 live epochs, plus the nodes bounding the expired range */
+    ASSERT_LE(pkw.getNumNodes(), 3u * 10 * 32 + 2 * 16);
+    pkw.expireThrough(198);
+    ASSERT_LE(pkw.getNumNodes(), 10u * 32 + 2 * 16);
+    ASSERT_THROW(pkw.expireThrough(199), IllegalTagException);
+}
+
+TEST_F(EpochPKWTest, TestExportImportKey) {
+    pkw.advanceTo(4);
+    auto c = pkw.wrap({4, 9}, head, key);
+    pkw.punc({3, 1});
+    SecureByteBuffer serialized = pkw.serializeKey();
+    EpochPKWFactory factory;
+    auto restored = factory.fromSerialized(serialized);
+    ASSERT_EQ(restored->unwrap({4, 9}, head, c), key);
+    ASSERT_EQ(restored->getNumPuncs(), pkw.getNumPuncs());
+    ASSERT_THROW(restored->wrap({3, 1}, head, key), IllegalTagException) << "punctured";
+    ASSERT_THROW(restored->wrap({1, 9}, head, key), IllegalTagException) << "expired";
+    SecureByteBuffer truncated(10);
+    ASSERT_THROW(factory.fromSerialized(truncated), DeserializationError);
+}
+
+TEST_F(EpochPKWTest, TestScheduler) {
+    pkw.startScheduler(std::chrono::milliseconds(2));
+    ASSERT_THROW(pkw.startScheduler(std::chrono::milliseconds(2)), PuncturableKeyWrappingException);
+    while (pkw.currentEpoch() < 5) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pkw.stopScheduler();
+    uint64_t epoch = pkw.currentEpoch();
+    ASSERT_GE(pkw.oldestLiveEpoch(), epoch - 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(pkw.currentEpoch(), epoch);
+}
@@ -1,10 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <array>
 #include <gmock/gmock-matchers.h>
 #include <pprf/ggm_pprf.h>
 #include <pprf/pprf_exceptions.h>
 #include <pprf/pprf_key_serializer.h>
 #include <pprf/secret_root.h>
+#include <pprf/static_ggm_pprf.h>
+#include <set>
+#include <thread>
 
 static const int TEST_KEY_LEN = 128;
 class GGMPPRFTest : public ::testing::Test {
@@ -138,6 +142,536 @@ TEST(Serialization, TestSerializeDeserialize) {
     ASSERT_EQ(pprf2.nodes[1].getValue(), keyvalbuff) << "Nodes should be deserialized in same order with same values";
 }
 
+static PPRFKey puncturedKey() {
+    GGM_PPRF pprf(PPRFKey::generate(TEST_KEY_LEN, 16));
+    for (uint64_t i = 0; i < 40; ++i) {
+        pprf.punc(i * 1543 % 65536);
+    }
+    return PPRFKeySerializer::deserialize(pprf.serializeKey());
+}
+
+TEST(Serialization, TestBlockedOutputIndependentOfThreads) {
+    PPRFKey key = puncturedKey();
+    ASSERT_GT(key.nodes.size(), 400u);
+    /* small blocks for many blocks per key */
+    PPRFKeySerializer serializer(key, 7);
+    SecureByteBuffer sequential = serializer.serialize(1);
+    ASSERT_EQ(serializer.serialize(2), sequential);
+    ASSERT_EQ(serializer.serialize(8), sequential);
+    for (unsigned threads: {1u, 3u, 8u}) {
+        PPRFKey restored = PPRFKeySerializer::deserialize(sequential, threads);
+        ASSERT_EQ(restored.tagLen, 16);
+        ASSERT_EQ(restored.puncs, 40);
+        ASSERT_EQ(restored.nodes.size(), key.nodes.size());
+        for (size_t i = 0; i < key.nodes.size(); ++i) {
+            ASSERT_EQ(restored.nodes[i].getPrefix(), key.nodes[i].getPrefix()) << i;
+            ASSERT_EQ(restored.nodes[i].getValue(), key.nodes[i].getValue()) << i;
+        }
+    }
+    GGM_PPRF pprf(key);
+    ASSERT_EQ(GGM_PPRF(PPRFKeySerializer::deserialize(sequential)).eval(1), pprf.eval(1));
+}
+
+TEST(Serialization, TestRejectsCorruptBlocks) {
+    SecureByteBuffer serialized = PPRFKeySerializer(puncturedKey(), 7).serialize();
+    SecureByteBuffer truncated(serialized.size() - 1);
+    std::copy(serialized.begin(), serialized.end() - 1, truncated.begin());
+    ASSERT_THROW(PPRFKeySerializer::deserialize(truncated, 4), PPRFDeserializationError);
+    /* second entry of the offset table */
+    SecureByteBuffer shifted = serialized;
+    shifted.data()[36 + 8 + 7] ^= 1;
+    ASSERT_THROW(PPRFKeySerializer::deserialize(shifted, 4), PPRFDeserializationError);
+    SecureByteBuffer huge = serialized;
+    huge.data()[20] = 0x7F;
+    ASSERT_THROW(PPRFKeySerializer::deserialize(huge, 4), PPRFDeserializationError);
+}
+
+static void writeLegacyInt(std::vector<unsigned char> &out, uint64_t value) {
+    for (int i = 7; i >= 0; --i) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+TEST(Serialization, TestReadsLegacyFormat) {
+    /* tagLen | keyLen | puncs | numNodes | (prefixLen | prefix | value)*, unordered nodes allowed */
+    std::vector<unsigned char> legacy;
+    writeLegacyInt(legacy, 10);
+    writeLegacyInt(legacy, 64);
+    writeLegacyInt(legacy, 3);
+    writeLegacyInt(legacy, 2);
+    writeLegacyInt(legacy, 3);
+    legacy.insert(legacy.end(), {'1', '0', '0', 1, 2, 3, 4, 5, 6, 7, 8});
+    writeLegacyInt(legacy, 1);
+    legacy.insert(legacy.end(), {'0', 0, 0, 0, 0, 0, 0, 0, 0});
+    SecureByteBuffer serialized(legacy);
+    PPRFKey key = PPRFKeySerializer::deserialize(serialized);
+    ASSERT_EQ(key.tagLen, 10);
+    ASSERT_EQ(key.keyLen, 64);
+    ASSERT_EQ(key.puncs, 3);
+    ASSERT_EQ(key.nodes.size(), 2u);
+    ASSERT_EQ(key.nodes[0].getPrefix(), "0");
+    ASSERT_EQ(key.nodes[1].getPrefix(), "100");
+    ASSERT_EQ(key.nodes[1].getValue().data()[7], 8);
+    SecureByteBuffer reserialized = key.serialize();
+    PPRFKey roundTrip = PPRFKeySerializer::deserialize(reserialized);
+    ASSERT_EQ(roundTrip.nodes[1].getValue(), key.nodes[1].getValue());
+}
+
+class KaryGGMTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(KaryGGMTest, TestPuncturePreservesOtherValues) {
+    GGM_PPRF pprf(PPRFKey::generate(TEST_KEY_LEN, 32, GetParam()));
+    ASSERT_EQ(pprf.arity(), GetParam());
+    std::vector<SecureByteBuffer> before;
+    for (uint32_t i = 0; i < 64; ++i) {
+        before.push_back(pprf.eval(Tag(i * 0x4000001u)));
+    }
+    pprf.punc(Tag(0x4000001u));
+    int levelBits = 0;
+    while ((1 << levelBits) < GetParam()) {
+        ++levelBits;
+    }
+    ASSERT_EQ(pprf.getNumNodes(), (size_t) (32 / levelBits) * (GetParam() - 1));
+    pprf.punc(Tag(5 * 0x4000001u));
+    for (uint32_t i = 0; i < 64; ++i) {
+        if (i == 1 || i == 5) {
+            ASSERT_THROW(pprf.eval(Tag(i * 0x4000001u)), TagException);
+        } else {
+            ASSERT_EQ(pprf.eval(Tag(i * 0x4000001u)), before[i]) << i;
+        }
+    }
+}
+
+TEST_P(KaryGGMTest, TestSerializationKeepsArity) {
+    GGM_PPRF pprf(PPRFKey::generate(TEST_KEY_LEN, 64, GetParam()));
+    pprf.punc(Tag(1234));
+    SecureByteBuffer serialized = pprf.serializeKey();
+    GGM_PPRF restored(PPRFKey::fromSerialized(serialized));
+    ASSERT_EQ(restored.arity(), GetParam());
+    ASSERT_EQ(restored.eval(Tag(1235)), pprf.eval(Tag(1235)));
+    ASSERT_THROW(restored.eval(Tag(1234)), TagException);
+    ASSERT_EQ(pprf.projectMemoryUsage(0, PunctureOrder::Sequential).serializedBytes, serialized.size());
+}
+
+TEST_P(KaryGGMTest, TestProjectionMatchesPunctures) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16, GetParam()));
+    pprf.punc(Tag(300));
+    MemoryProjection projection = pprf.projectMemoryUsage(100, PunctureOrder::Sequential);
+    for (int i = 0, done = 0; done < 100; ++i) {
+        if (i != 300) {
+            pprf.punc(Tag(i));
+            ++done;
+        }
+    }
+    ASSERT_EQ(projection.numNodes, pprf.getNumNodes());
+    ASSERT_EQ(projection.usage.depthHistogram, pprf.memoryUsage().depthHistogram);
+    ASSERT_EQ(projection.serializedBytes, pprf.serializeKey().size());
+}
+
+TEST_P(KaryGGMTest, TestPuncPrefixOnLevels) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16, GetParam()));
+    ASSERT_THROW(pprf.puncPrefix(Tag(0), 16 - 1), TagException);
+    pprf.puncPrefix(Tag(0x8000), 8);
+    ASSERT_THROW(pprf.eval(Tag(0x80FF)), TagException);
+    ASSERT_NO_THROW(pprf.eval(Tag(0x8100)));
+}
+
+INSTANTIATE_TEST_SUITE_P(Arities, KaryGGMTest, ::testing::Values(4, 16, 256));
+
+TEST(KaryGGM, TestBinaryMatchesDefault) {
+    SecureByteBuffer root(TEST_KEY_LEN / 8, 7);
+    GGM_PPRF binary(PPRFKey(TEST_KEY_LEN, 16, 0, {SecretRoot("", root)}, GGM_BINARY));
+    GGM_PPRF quaternary(PPRFKey(TEST_KEY_LEN, 16, 0, {SecretRoot("", root)}, 4));
+    GGM_PPRF plain(PPRFKey(TEST_KEY_LEN, 16, 0, {SecretRoot("", root)}));
+    ASSERT_EQ(binary.eval(Tag(77)), plain.eval(Tag(77)));
+    ASSERT_NE(quaternary.eval(Tag(77)), plain.eval(Tag(77))) << "different trees from the same root";
+}
+
+TEST(KaryGGM, TestRejectsUnsupportedParameters) {
+    ASSERT_THROW(PPRFKey(TEST_KEY_LEN, 16, 3), InitializationException);
+    ASSERT_THROW(PPRFKey(TEST_KEY_LEN, 10, 16), InitializationException) << "tag length not a multiple of 4";
+    ASSERT_THROW(PPRFKey(64, 16, 4), InitializationException) << "not an AES key length";
+    ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 16, 0, {SecretRoot("1", SecureByteBuffer(TEST_KEY_LEN / 8))}, 4)), InitializationException)
+            << "prefix not on a level";
+}
+
 TEST(BadInitialization, TestZeroTagLength) {
     ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 0)), InitializationException);
-}
\ No newline at end of file
+}
+template<size_t N>
+static SecureByteBuffer toBuffer(const SecureArray<N> &value) {
+    SecureByteBuffer buffer(N);
+    std::copy(value.begin(), value.end(), buffer.begin());
+    return buffer;
+}
+
+TEST(StaticGGM_PPRF, TestMatchesRuntimeDispatch) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16));
+    pprf.punc(7);
+    StaticGGM_PPRF<16, TEST_KEY_LEN> fixed(PPRFKey(TEST_KEY_LEN, 16));
+    fixed.punc(7);
+    for (uint64_t i = 0; i < 100; ++i) {
+        if (i == 7) {
+            ASSERT_THROW(fixed.eval(i), TagException);
+            continue;
+        }
+        ASSERT_EQ(toBuffer(fixed.eval(i)), pprf.eval(i)) << "tag " << i;
+    }
+    ASSERT_THROW(fixed.eval(1 << 16), TagException);
+}
+
+/* values of the binary tree under the root 00 01 .. 0f, recorded from the implementation before StaticGGM_PPRF */
+TEST(StaticGGM_PPRF, TestKnownAnswers) {
+    struct KnownAnswer {
+            int tagLen;
+            std::array<uint64_t, 2> words;
+            const char *value;
+    };
+    const KnownAnswer answers[] = {
+            {16, {0, 0}, "\x34\x4d\x72\x4c\xd7\x27\xa6\xd4\xa7\x0c\x59\xf0\x8b\xc4\x5a\x94"},
+            {16, {0xB4E1, 0}, "\xc6\x0a\x5a\xec\xa8\x5c\x77\xe5\xc9\xbe\xfe\xdb\xb0\xd3\xce\x50"},
+            {20, {0xA00FF, 0}, "\xbd\xe2\x3c\x07\x9b\x61\x35\x9b\xd1\xe4\xa3\x10\x54\x80\x5c\x62"},
+            {64, {~uint64_t(0), 0}, "\xde\x19\x92\x9d\x6e\x1e\xea\x55\xfa\xdc\x0e\xe2\xea\x75\x89\x8c"},
+            {64, {0x0123456789ABCDEF, 0}, "\xf4\x0d\xa6\x37\x69\x48\x4c\xc5\x13\xd2\x92\x79\x2a\x84\xf2\xf3"},
+            {128, {1, uint64_t(1) << 63}, "\x6e\xe7\x1f\x4c\x2c\x09\x1e\x37\x68\x7c\x07\xb6\x48\xf7\x69\x25"},
+    };
+    SecureByteBuffer root(TEST_KEY_LEN / 8);
+    for (size_t i = 0; i < root.size(); ++i) {
+        root.data()[i] = (unsigned char) i;
+    }
+    for (const KnownAnswer &answer: answers) {
+        SecureByteBuffer expected(TEST_KEY_LEN / 8);
+        std::copy(answer.value, answer.value + expected.size(), expected.data());
+        Tag tag = (Tag(answer.words[1]) << 64) | Tag(answer.words[0]);
+        PPRFKey key(TEST_KEY_LEN, answer.tagLen, 0, {SecretRoot("", root)});
+
+        GGM_PPRF pprf(key);
+        ASSERT_EQ(pprf.eval(tag), expected) << answer.tagLen;
+        pprf.punc(tag ^ Tag(1));
+        ASSERT_EQ(pprf.eval(tag), expected) << "derived from the co-path, " << answer.tagLen;
+
+        StaticGGM_PPRF<DYNAMIC_LEN, DYNAMIC_LEN> dynamic(key);
+        GGMTag<DYNAMIC_LEN>::Type words{};
+        words[0] = answer.words[0];
+        words[1] = answer.words[1];
+        ASSERT_EQ(dynamic.eval(words), expected) << answer.tagLen;
+    }
+}
+
+TEST(StaticGGM_PPRF, TestMatchesDynamicTagLength) {
+    PPRFKey key(TEST_KEY_LEN, 10, 0, {SecretRoot("0101", SecureByteBuffer(TEST_KEY_LEN / 8)), SecretRoot("001", SecureByteBuffer(TEST_KEY_LEN / 8))});
+    StaticGGM_PPRF<DYNAMIC_LEN, DYNAMIC_LEN> dynamic(key);
+    GGM_PPRF pprf(key);
+    ASSERT_EQ(dynamic.eval({356}), pprf.eval(356));
+    ASSERT_THROW(dynamic.eval({0}), TagException) << "no node covers prefix 000";
+}
+
+TEST(StaticGGM_PPRF, TestMultiWordTags) {
+    StaticGGM_PPRF<256, TEST_KEY_LEN> fixed(PPRFKey(TEST_KEY_LEN, 256));
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 256));
+    Tag high = (Tag(1) << 255) | Tag(5);
+    TagWords words = GGM_PPRF::toWords(high);
+    ASSERT_EQ(words[0], 5u);
+    ASSERT_EQ(words[3], uint64_t(1) << 63);
+    fixed.punc(words);
+    pprf.punc(high);
+    ASSERT_THROW(fixed.eval(words), TagException);
+    words[3] = 0;
+    ASSERT_EQ(toBuffer(fixed.eval(words)), pprf.eval(Tag(5)));
+    PPRFKey roundTrip = fixed.toKey();
+    ASSERT_EQ(roundTrip.nodes.size(), 256u);
+    ASSERT_EQ(roundTrip.serialize(), pprf.serializeKey());
+}
+
+TEST_F(GGMPPRFTest, TestMemoryUsage) {
+    pprf.punc(3);
+    pprf.punc(700);
+    MemoryUsage usage = pprf.memoryUsage();
+    ASSERT_EQ(usage.secretBytes, pprf.getNumNodes() * TEST_KEY_LEN / 8);
+    ASSERT_EQ(usage.depthHistogram.size(), 11u);
+    size_t nodes = 0;
+    for (size_t count: usage.depthHistogram) {
+        nodes += count;
+    }
+    ASSERT_EQ(nodes, pprf.getNumNodes());
+    ASSERT_EQ(usage.depthHistogram[0], 0u);
+    ASSERT_EQ(usage.depthHistogram[1], 0u) << "both halves are punctured";
+    ASSERT_EQ(usage.depthHistogram[10], 2u) << "siblings of tags 3 and 700";
+    ASSERT_GT(usage.total(), usage.secretBytes + usage.indexBytes);
+}
+
+TEST_F(GGMPPRFTest, TestProjectionMatchesPunctures) {
+    pprf.punc(1);
+    pprf.punc(513);
+    MemoryProjection projection = pprf.projectMemoryUsage(100, PunctureOrder::Sequential);
+    /* the smallest unpunctured tags, 0 and 2 to 100 */
+    for (int i = 0; i <= 100; ++i) {
+        pprf.punc(i);
+    }
+    ASSERT_EQ(projection.numNodes, pprf.getNumNodes());
+    ASSERT_EQ(projection.usage.depthHistogram, pprf.memoryUsage().depthHistogram);
+    ASSERT_EQ(projection.usage.secretBytes, pprf.memoryUsage().secretBytes);
+    ASSERT_EQ(projection.serializedBytes, pprf.serializeKey().size());
+}
+
+TEST(GGMPPRFMemoryTest, TestRandomProjection) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 64));
+    ASSERT_EQ(pprf.projectMemoryUsage(1, PunctureOrder::Random).numNodes, 64u);
+    MemoryProjection projection = pprf.projectMemoryUsage(100, PunctureOrder::Random, 42);
+    ASSERT_GT(projection.numNodes, 100u * (64 - 8));
+    ASSERT_LE(projection.numNodes, 100u * 64);
+    ASSERT_EQ(pprf.getNumNodes(), 1u) << "projection must not modify the key";
+}
+
+TEST_F(GGMPPRFTest, TestSnapshotUnaffectedByPunctures) {
+    pprf.punc(5);
+    SecureByteBuffer before = pprf.serializeKey();
+    SecureByteBuffer value = pprf.eval(700);
+    GGM_PPRFSnapshot snapshot = pprf.snapshot();
+    pprf.punc(700);
+    pprf.punc(6);
+    ASSERT_THROW(pprf.eval(700), TagException);
+    ASSERT_EQ(snapshot.eval(700), value);
+    ASSERT_THROW(snapshot.eval(5), TagException);
+    ASSERT_EQ(snapshot.getNumPuncs(), 1);
+    ASSERT_EQ(snapshot.serializeKey(), before);
+    ASSERT_EQ(pprf.getNumPuncs(), 3);
+}
+
+TEST(GGMPPRFSnapshotTest, TestConcurrentSerialization) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 32));
+    /* enough nodes for several chunks */
+    for (uint32_t i = 0; i < 64; ++i) {
+        pprf.punc(Tag(i * 0x3000000u + 7));
+    }
+    SecureByteBuffer before = pprf.serializeKey();
+    GGM_PPRFSnapshot snapshot = pprf.snapshot();
+    SecureByteBuffer checkpoint;
+    std::thread writer([&]() { checkpoint = snapshot.serializeKey(); });
+    for (uint32_t i = 0; i < 200; ++i) {
+        pprf.punc(Tag(i * 0x1000000u + 11));
+    }
+    writer.join();
+    ASSERT_EQ(checkpoint, before);
+    GGM_PPRF restored(PPRFKeySerializer::deserialize(checkpoint));
+    ASSERT_EQ(restored.getNumPuncs(), 64);
+    ASSERT_EQ(restored.eval(11), snapshot.eval(11));
+    ASSERT_THROW(pprf.eval(11), TagException);
+    for (uint32_t i = 0; i < 64; ++i) {
+        ASSERT_EQ(pprf.eval(Tag(i * 0x3000000u + 8)), restored.eval(Tag(i * 0x3000000u + 8)));
+    }
+}
+
+TEST_F(GGMPPRFTest, TestTryEvalAndIsPunctured) {
+    unsigned char out[TEST_KEY_LEN / 8];
+    ASSERT_EQ(pprf.tryEval(5, out), PPRFStatus::Ok);
+    SecureByteBuffer expected = pprf.eval(5);
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), out));
+    pprf.punc(5);
+    ASSERT_TRUE(pprf.isPunctured(5));
+    ASSERT_FALSE(pprf.isPunctured(4));
+    ASSERT_EQ(pprf.tryEval(5, out), PPRFStatus::Punctured);
+    ASSERT_EQ(pprf.tryEval(1 << 10, out), PPRFStatus::TagTooLarge);
+    ASSERT_THROW(pprf.isPunctured(1 << 10), TagException);
+}
+
+/* the key a worker would send back */
+static PPRFKey keyOf(GGM_PPRF &pprf) {
+    SecureByteBuffer serialized = pprf.serializeKey();
+    return PPRFKey::fromSerialized(serialized);
+}
+
+static void expectPunctured(GGM_PPRF &pprf, GGM_PPRF &reference, int tagLen, const std::set<long> &punctured) {
+    for (long t = 0; t < (1L << tagLen); ++t) {
+        if (punctured.count(t)) {
+            ASSERT_TRUE(pprf.isPunctured(Tag(t))) << t;
+        } else {
+            ASSERT_EQ(pprf.eval(Tag(t)), reference.eval(Tag(t))) << t;
+        }
+    }
+}
+
+TEST(Delegation, TestDelegateEvaluatesSubtreeOnly) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16));
+    GGM_PPRF worker(pprf.delegate(Tag(0x23AB), 8));
+    ASSERT_EQ(worker.getNumNodes(), 1);
+    ASSERT_EQ(worker.getNumPuncs(), 0);
+    ASSERT_EQ(worker.eval(Tag(0x2300)), pprf.eval(Tag(0x2300)));
+    ASSERT_EQ(worker.eval(Tag(0x23FF)), pprf.eval(Tag(0x23FF)));
+    ASSERT_TRUE(worker.isPunctured(Tag(0x22FF)));
+    ASSERT_TRUE(worker.isPunctured(Tag(0x2400)));
+
+    pprf.punc(Tag(0x2305));
+    GGM_PPRF after(pprf.delegate(Tag(0x2300), 8));
+    ASSERT_EQ(after.getNumNodes(), 8) << "the co-path inside the subtree";
+    ASSERT_TRUE(after.isPunctured(Tag(0x2305)));
+    ASSERT_EQ(after.eval(Tag(0x2306)), pprf.eval(Tag(0x2306)));
+    ASSERT_EQ(GGM_PPRF(pprf.delegate(Tag(0x2305), 16)).getNumNodes(), 0);
+    ASSERT_THROW(pprf.delegate(Tag(0x2300), 17), TagException);
+}
+
+TEST(Delegation, TestMergeIntersectsPunctures) {
+    const int tagLen = 10;
+    GGM_PPRF reference(PPRFKey(TEST_KEY_LEN, tagLen));
+    GGM_PPRF pprf(reference);
+    std::set<long> punctured = {0x005, 0x2FF};
+    for (long t: punctured) {
+        pprf.punc(Tag(t));
+    }
+    /* the subtree 0x100 - 0x1FF: punctures by the worker and by the parent after the delegation */
+    PPRFKey key = pprf.delegate(Tag(0x100), 2);
+    GGM_PPRF worker(key);
+    for (long t: {0x100L, 0x17AL, 0x1FFL}) {
+        worker.punc(Tag(t));
+        punctured.insert(t);
+    }
+    worker.puncPrefix(Tag(0x140), 6);
+    for (long t = 0x140; t < 0x150; ++t) {
+        punctured.insert(t);
+    }
+    for (long t: {0x17AL, 0x180L, 0x300L}) {
+        pprf.punc(Tag(t));
+        punctured.insert(t);
+    }
+    pprf.merge(Tag(0x100), 2, keyOf(worker));
+    ASSERT_EQ(pprf.getNumPuncs(), 2 + 3 + 4);
+    expectPunctured(pprf, reference, tagLen, punctured);
+
+    /* merging into a node covering the subtree splits it */
+    GGM_PPRF fresh(reference);
+    GGM_PPRF slice(fresh.delegate(Tag(0x200), 2));
+    slice.punc(Tag(0x2AA));
+    fresh.merge(Tag(0x200), 2, keyOf(slice));
+    expectPunctured(fresh, reference, tagLen, {0x2AA});
+    ASSERT_EQ(fresh.getNumNodes(), GGM_PPRF(PPRFKey(TEST_KEY_LEN, tagLen)).getNumNodes() + tagLen - 1);
+}
+
+TEST(Delegation, TestMergeRejectsForeignKeys) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16));
+    GGM_PPRF other(PPRFKey::generate(TEST_KEY_LEN, 16));
+    ASSERT_THROW(pprf.merge(Tag(0x2300), 8, other.delegate(Tag(0x2300), 8)), InitializationException);
+    ASSERT_THROW(pprf.merge(Tag(0x2300), 8, pprf.delegate(Tag(0x2400), 8)), InitializationException)
+            << "nodes outside the subtree";
+    ASSERT_THROW(pprf.merge(Tag(0x2300), 8, PPRFKey(TEST_KEY_LEN, 32)), InitializationException);
+    GGM_PPRF unchanged(pprf);
+    ASSERT_EQ(pprf.eval(Tag(0x2301)), unchanged.eval(Tag(0x2301)));
+    ASSERT_EQ(pprf.getNumNodes(), 1);
+}
+
+TEST_P(KaryGGMTest, TestDelegateAndMerge) {
+    GGM_PPRF reference(PPRFKey(TEST_KEY_LEN, 16, GetParam()));
+    GGM_PPRF pprf(reference);
+    GGM_PPRF worker(pprf.delegate(Tag(0x4200), 8));
+    ASSERT_EQ(worker.arity(), GetParam());
+    ASSERT_EQ(worker.eval(Tag(0x4277)), reference.eval(Tag(0x4277)));
+    worker.punc(Tag(0x4277));
+    pprf.punc(Tag(0x4278));
+    pprf.merge(Tag(0x4200), 8, keyOf(worker));
+    ASSERT_TRUE(pprf.isPunctured(Tag(0x4277)));
+    ASSERT_TRUE(pprf.isPunctured(Tag(0x4278)));
+    ASSERT_EQ(pprf.eval(Tag(0x4279)), reference.eval(Tag(0x4279)));
+    ASSERT_EQ(pprf.eval(Tag(0x4300)), reference.eval(Tag(0x4300)));
+}
+
+TEST(Frontier, TestMatchesUnexpandedKey) {
+    const int tagLen = 12;
+    PPRFKey key = PPRFKey::generate(TEST_KEY_LEN, tagLen);
+    GGM_PPRF reference(key);
+    GGM_PPRF pprf(key, 4);
+    ASSERT_EQ(pprf.getNumNodes(), 16u);
+    ASSERT_EQ(pprf.eval(Tag(0x123)), reference.eval(Tag(0x123)));
+    pprf.punc(Tag(0x123));
+    pprf.punc(Tag(0x124));
+    pprf.puncPrefix(Tag(0x800), 2);
+    pprf.puncPrefix(Tag(0x450), 8);
+    pprf.puncPrefix(Tag(0x600), 4);
+    std::set<long> punctured{0x123, 0x124};
+    for (long t = 0; t < (1L << tagLen); ++t) {
+        if ((t >> 10) == 2 || (t >> 4) == 0x45 || (t >> 8) == 6) {
+            punctured.insert(t);
+        }
+    }
+    expectPunctured(pprf, reference, tagLen, punctured);
+    ASSERT_EQ(pprf.getNumPuncs(), 5);
+
+    GGM_PPRF restored(keyOf(pprf));
+    expectPunctured(restored, reference, tagLen, punctured);
+    GGM_PPRF reexpanded(keyOf(pprf), 8);
+    expectPunctured(reexpanded, reference, tagLen, punctured);
+}
+
+TEST(Frontier, TestRejectsUnsupportedDepths) {
+    ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 16), -1), InitializationException);
+    ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 16), 17), InitializationException);
+    ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 32), 25), InitializationException);
+    ASSERT_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 16, 16), 6), InitializationException) << "not on a level";
+    ASSERT_NO_THROW(GGM_PPRF(PPRFKey(TEST_KEY_LEN, 16), 16));
+}
+
+TEST(Frontier, TestSnapshotUnaffectedByPunctures) {
+    GGM_PPRF pprf(PPRFKey::generate(TEST_KEY_LEN, 32), 8);
+    SecureByteBuffer value = pprf.eval(Tag(0x1234567));
+    GGM_PPRFSnapshot snapshot = pprf.snapshot();
+    pprf.punc(Tag(0x1234567));
+    pprf.puncPrefix(Tag(0x2000000), 8);
+    ASSERT_TRUE(pprf.isPunctured(Tag(0x1234567)));
+    ASSERT_TRUE(pprf.isPunctured(Tag(0x2ABCDEF)));
+    ASSERT_EQ(snapshot.eval(Tag(0x1234567)), value);
+    ASSERT_NO_THROW(snapshot.eval(Tag(0x2ABCDEF)));
+    ASSERT_EQ(snapshot.getNumNodes(), 256u);
+    ASSERT_EQ(pprf.getNumNodes(), 256u - 2 + 24);
+}
+
+TEST(Frontier, TestMemoryUsageAndProjection) {
+    GGM_PPRF pprf(PPRFKey(TEST_KEY_LEN, 16), 6);
+    pprf.punc(Tag(1));
+    MemoryUsage usage = pprf.memoryUsage();
+    ASSERT_EQ(usage.secretBytes, pprf.getNumNodes() * TEST_KEY_LEN / 8);
+    ASSERT_EQ(usage.depthHistogram[6], 63u);
+    ASSERT_GT(usage.slackBytes, (size_t) TEST_KEY_LEN / 8) << "the erased slot";
+    MemoryProjection projection = pprf.projectMemoryUsage(2000, PunctureOrder::Sequential);
+    for (int i = 0; i <= 2000; ++i) {
+        pprf.punc(Tag(i));
+    }
+    ASSERT_EQ(projection.numNodes, pprf.getNumNodes());
+    ASSERT_EQ(projection.usage.depthHistogram, pprf.memoryUsage().depthHistogram);
+    ASSERT_EQ(projection.usage.secretBytes, pprf.memoryUsage().secretBytes);
+    ASSERT_EQ(projection.serializedBytes, pprf.serializeKey().size());
+}
+
+TEST(Frontier, TestDepthAcrossTagWords) {
+    PPRFKey key = PPRFKey::generate(TEST_KEY_LEN, 70);
+    GGM_PPRF reference(key);
+    GGM_PPRF pprf(key, 10);
+    Tag tag(12345);
+    tag.set(62);
+    tag.set(65);
+    ASSERT_EQ(pprf.eval(tag), reference.eval(tag));
+    pprf.punc(tag);
+    ASSERT_TRUE(pprf.isPunctured(tag));
+    tag.flip(0);
+    ASSERT_EQ(pprf.eval(tag), reference.eval(tag));
+    tag.flip(64);
+    ASSERT_EQ(pprf.eval(tag), reference.eval(tag));
+    GGM_PPRF restored(keyOf(pprf));
+    ASSERT_EQ(restored.eval(tag), reference.eval(tag));
+}
+
+TEST_P(KaryGGMTest, TestFrontier) {
+    GGM_PPRF reference(PPRFKey::generate(TEST_KEY_LEN, 16, GetParam()));
+    GGM_PPRF pprf(keyOf(reference), 8);
+    int levelBits = 0;
+    while ((1 << levelBits) < GetParam()) {
+        ++levelBits;
+    }
+    pprf.punc(Tag(0x4277));
+    /* one level below and one level above the frontier */
+    GGM_PPRF worker(pprf.delegate(Tag(0x4200), 8 + levelBits));
+    ASSERT_EQ(worker.eval(Tag(0x4200)), reference.eval(Tag(0x4200)));
+    worker.punc(Tag(0x4200));
+    pprf.merge(Tag(0x4200), 8 + levelBits, keyOf(worker));
+    GGM_PPRF slice(pprf.delegate(Tag(0x9000), 8 - levelBits));
+    slice.punc(Tag(0x9003));
+    pprf.merge(Tag(0x9000), 8 - levelBits, keyOf(slice));
+    expectPunctured(pprf, reference, 16, {0x4277, 0x4200, 0x9003});
+}
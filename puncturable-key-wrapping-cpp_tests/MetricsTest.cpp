@@ -0,0 +1,77 @@
+#include "metrics.h"
+#include "pkw/exceptions.h"
+#include "pkw/pprf_aead_pkw.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+class MetricsTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            PKWMetrics::instance().reset();
+            PKWMetrics::instance().setEnabled(true);
+        }
+        void TearDown() override {
+            PKWMetrics::instance().setEnabled(false);
+        }
+};
+
+TEST_F(MetricsTest, TestCountersAndFailures) {
+    PPRF_AEAD_PKW pkw(16, 128);
+    std::vector<unsigned char> header(4, 'h');
+    std::vector<unsigned char> key(16, 'k');
+    auto c = pkw.wrap(1, header, key);
+    pkw.punc(1);
+    ASSERT_THROW(pkw.unwrap(1, header, c), IllegalTagException);
+    auto c2 = pkw.wrap(2, header, key);
+    c2[0] ^= 1;
+    ASSERT_THROW(pkw.unwrap(2, header, c2), UnwrappingException);
+
+    PKWStats stats = PKWMetrics::instance().stats();
+    ASSERT_EQ(stats.counter(MetricCounter::Evals), 3u);
+    ASSERT_EQ(stats.counter(MetricCounter::Punctures), 1u);
+    /* full path for the first wrap, both children along the path for punc, then tag 2 starts at the co-path node covering tags 2 and 3 */
+    ASSERT_EQ(stats.counter(MetricCounter::PRGInvocations), 16u + 32u + 1u + 1u);
+    ASSERT_EQ(stats.counter(MetricCounter::FailedUnwrapsIllegalTag), 1u);
+    ASSERT_EQ(stats.counter(MetricCounter::FailedUnwrapsAuthentication), 1u);
+    ASSERT_EQ(stats.latency(MetricOp::Wrap).count, 2u);
+    ASSERT_EQ(stats.latency(MetricOp::Unwrap).count, 2u);
+}
+
+TEST_F(MetricsTest, TestNodeGauges) {
+    int64_t before = PKWMetrics::instance().stats().nodes;
+    {
+        PPRF_AEAD_PKW pkw(16, 128);
+        pkw.punc(0);
+        PKWStats stats = PKWMetrics::instance().stats();
+        ASSERT_EQ(stats.nodes - before, 16);
+        PPRF_AEAD_PKW copy(pkw);
+        ASSERT_EQ(PKWMetrics::instance().stats().nodes - before, 32);
+    }
+    ASSERT_EQ(PKWMetrics::instance().stats().nodes, before) << "Destroyed keys are removed from the gauge";
+}
+
+TEST_F(MetricsTest, TestDisabledRecordsNothing) {
+    PKWMetrics::instance().setEnabled(false);
+    PPRF_AEAD_PKW pkw(16, 128);
+    pkw.punc(3);
+    ASSERT_EQ(PKWMetrics::instance().stats().counter(MetricCounter::Punctures), 0u);
+}
+
+TEST_F(MetricsTest, TestRenderPrometheus) {
+    PPRF_AEAD_PKW pkw(16, 128);
+    pkw.punc(3);
+    PKWStats stats = PKWMetrics::instance().stats();
+    size_t length = renderPrometheus(stats, nullptr, 0);
+    std::vector<char> buffer(length + 1);
+    ASSERT_EQ(renderPrometheus(stats, buffer.data(), buffer.size()), length);
+    std::string text(buffer.data());
+    ASSERT_EQ(text.size(), length);
+    ASSERT_NE(text.find("pkw_punctures_total 1\n"), std::string::npos);
+    ASSERT_NE(text.find("# TYPE pkw_failed_unwraps_total counter\npkw_failed_unwraps_total{reason=\"illegal_tag\"} 0\npkw_failed_unwraps_total{reason=\"authentication\"} 0\n"), std::string::npos);
+    ASSERT_NE(text.find("pkw_operation_duration_seconds_count{op=\"punc\"} 1\n"), std::string::npos);
+
+    std::vector<char> small(10);
+    ASSERT_EQ(renderPrometheus(stats, small.data(), small.size()), length) << "Truncated output reports the full length";
+    ASSERT_EQ(std::string(small.data()), text.substr(0, 9));
+}
@@ -0,0 +1,552 @@
+#include "pkw/bloom_pkw.h"
+#include "pkw/helpers/password_encrypt.h"
+#include "pkw/naive_pkw.h"
+#include "pkw/pprf_aead_pkw.h"
+#include "pprf/ggm_pprf.h"
+#include "pprf/pprf_key_serializer.h"
+#include "secure_byte_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+/*
+ * Microbenchmarks of the PPRF and PKW hot paths.
+ *
+ * Unless stated otherwise benchmarks take the arguments {tagLen, keyLen, puncs}, where puncs is the number of random
+ * punctures performed on the key before measuring. Every benchmark reports ns/op (time), ops/s (items_per_second) and
+ * the number of bytes allocated per op (bytes_allocated_per_op).
+ *
+ * Run with --benchmark_format=json (or --benchmark_out=<file> --benchmark_out_format=json) for machine readable output.
+ */
+
+static std::atomic<size_t> allocatedBytes{0};
+
+void *operator new(size_t size) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * Accumulates the bytes allocated by the measured operations and reports them as a per-op average.
+ */
+class AllocationCounter {
+    public:
+        explicit AllocationCounter(benchmark::State &state) : state(state) {}
+        ~AllocationCounter() {
+            state.counters["bytes_allocated_per_op"] = benchmark::Counter((double) bytes, benchmark::Counter::kAvgIterations);
+            state.SetItemsProcessed(state.iterations());
+        }
+        void start() { before = allocatedBytes.load(std::memory_order_relaxed); }
+        void stop() { bytes += allocatedBytes.load(std::memory_order_relaxed) - before; }
+
+    private:
+        benchmark::State &state;
+        size_t before = 0;
+        size_t bytes = 0;
+};
+
+static Tag randomTag(std::mt19937_64 &rng, int tagLen) {
+    Tag tag;
+    for (int i = 0; i < tagLen; i += 64) {
+        tag |= Tag(rng()) << i;
+    }
+    return tag & (~Tag() >> (MAX_TAG_LEN - tagLen));
+}
+
+/* at most half of the 2^tagLen tags, so that random punctures terminate and live tags remain to measure on */
+static int reachablePuncs(int tagLen, int puncs) {
+    return tagLen > 30 ? puncs : std::min(puncs, 1 << (tagLen - 1));
+}
+
+static GGM_PPRF puncturedPPRF(int tagLen, int keyLen, int puncs, std::mt19937_64 &rng, int arity = GGM_BINARY) {
+    GGM_PPRF pprf(PPRFKey(keyLen, tagLen, arity));
+    puncs = reachablePuncs(tagLen, puncs);
+    while (pprf.getNumPuncs() < puncs) {
+        pprf.punc(randomTag(rng, tagLen));
+    }
+    return pprf;
+}
+
+static PPRF_AEAD_PKW puncturedPKW(int tagLen, int keyLen, int puncs, std::mt19937_64 &rng) {
+    PPRF_AEAD_PKW pkw(tagLen, keyLen);
+    puncs = reachablePuncs(tagLen, puncs);
+    while (pkw.getNumPuncs() < puncs) {
+        pkw.punc(randomTag(rng, tagLen));
+    }
+    return pkw;
+}
+
+/* Draws a tag which has not been punctured; evaluation on it succeeds */
+template<class F>
+static Tag liveTag(std::mt19937_64 &rng, int tagLen, F &&isLive) {
+    Tag tag;
+    do {
+        tag = randomTag(rng, tagLen);
+    } while (!isLive(tag));
+    return tag;
+}
+
+static void BM_GGM_Eval(benchmark::State &state) {
+    std::mt19937_64 rng(1);
+    int tagLen = state.range(0);
+    GGM_PPRF pprf = puncturedPPRF(tagLen, state.range(1), state.range(2), rng);
+    std::vector<Tag> tags;
+    for (int i = 0; i < 64; ++i) {
+        tags.push_back(liveTag(rng, tagLen, [&](const Tag &t) {
+            try {
+                pprf.eval(t);
+                return true;
+            } catch (std::exception &) {
+                return false;
+            }
+        }));
+    }
+    AllocationCounter counter(state);
+    size_t i = 0;
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pprf.eval(tags[i++ % tags.size()]));
+        counter.stop();
+    }
+}
+
+/*
+ * Arguments {tagLen, arity, puncs}, 128 bit keys. Besides the latency, reports the nodes and serialized bytes of the
+ * punctured key: wider trees evaluate in tagLen / log2(arity) steps but keep arity - 1 siblings per level.
+ */
+static void BM_GGM_EvalArity(benchmark::State &state) {
+    std::mt19937_64 rng(1);
+    int tagLen = state.range(0);
+    GGM_PPRF pprf = puncturedPPRF(tagLen, 128, state.range(2), rng, state.range(1));
+    std::vector<Tag> tags;
+    for (int i = 0; i < 64; ++i) {
+        tags.push_back(liveTag(rng, tagLen, [&](const Tag &t) { return !pprf.isPunctured(t); }));
+    }
+    size_t i = 0;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(pprf.eval(tags[i++ % tags.size()]));
+    }
+    state.counters["nodes"] = (double) pprf.getNumNodes();
+    state.counters["key_bytes"] = (double) pprf.serializeKey().size();
+}
+
+/**
+ * Arguments {tagLen, depth}, 128 bit keys: evaluation with a pre-expanded frontier of 2^depth nodes, which leaves
+ * tagLen - depth derivations per evaluation. Reports the memory the frontier takes.
+ */
+static void BM_GGM_EvalFrontier(benchmark::State &state) {
+    std::mt19937_64 rng(3);
+    int tagLen = state.range(0);
+    GGM_PPRF pprf(PPRFKey::generate(128, tagLen), state.range(1));
+    std::vector<Tag> tags;
+    for (int i = 0; i < 64; ++i) {
+        tags.push_back(randomTag(rng, tagLen));
+    }
+    size_t i = 0;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(pprf.eval(tags[i++ % tags.size()]));
+    }
+    state.counters["memory_bytes"] = (double) pprf.memoryUsage().total();
+}
+
+/*
+ * The puncture benchmarks puncture a fresh instance per iteration. It is deserialized, and the previous one destroyed,
+ * while timing is paused: a copy of the base instance would share its chunks and copy them inside the timed puncture.
+ */
+static void freshPPRF(std::unique_ptr<GGM_PPRF> &pprf, SecureByteBuffer &serialized) {
+    pprf.reset();
+    pprf.reset(new GGM_PPRF(PPRFKey::fromSerialized(serialized)));
+}
+
+/* arguments {tagLen, arity, puncs} */
+static void BM_GGM_PuncArity(benchmark::State &state) {
+    std::mt19937_64 rng(2);
+    int tagLen = state.range(0);
+    SecureByteBuffer serialized = puncturedPPRF(tagLen, 128, state.range(2), rng, state.range(1)).serializeKey();
+    std::unique_ptr<GGM_PPRF> pprf;
+    for (auto _: state) {
+        state.PauseTiming();
+        freshPPRF(pprf, serialized);
+        Tag tag = randomTag(rng, tagLen);
+        state.ResumeTiming();
+        pprf->punc(tag);
+    }
+}
+
+static void BM_GGM_Punc(benchmark::State &state) {
+    std::mt19937_64 rng(2);
+    int tagLen = state.range(0);
+    SecureByteBuffer serialized = puncturedPPRF(tagLen, state.range(1), state.range(2), rng).serializeKey();
+    std::unique_ptr<GGM_PPRF> pprf;
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        state.PauseTiming();
+        freshPPRF(pprf, serialized);
+        Tag tag = randomTag(rng, tagLen);
+        state.ResumeTiming();
+        counter.start();
+        pprf->punc(tag);
+        counter.stop();
+    }
+}
+
+static void BM_GGM_SerializeKey(benchmark::State &state) {
+    std::mt19937_64 rng(3);
+    GGM_PPRF pprf = puncturedPPRF(state.range(0), state.range(1), state.range(2), rng);
+    AllocationCounter counter(state);
+    size_t size = 0;
+    for (auto _: state) {
+        counter.start();
+        SecureByteBuffer serialized = pprf.serializeKey();
+        counter.stop();
+        size = serialized.size();
+    }
+    state.counters["serialized_bytes"] = (double) size;
+}
+
+static void BM_GGM_FromSerialized(benchmark::State &state) {
+    std::mt19937_64 rng(4);
+    SecureByteBuffer serialized = puncturedPPRF(state.range(0), state.range(1), state.range(2), rng).serializeKey();
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        GGM_PPRF pprf(PPRFKey::fromSerialized(serialized));
+        counter.stop();
+        benchmark::DoNotOptimize(pprf);
+    }
+}
+
+/**
+ * A key of numNodes nodes at depth 24 (tagLen 128), as left by many punctures, without performing them.
+ */
+static PPRFKey largeKey(size_t numNodes) {
+    std::vector<SecretRoot> nodes;
+    nodes.reserve(numNodes);
+    for (size_t i = 0; i < numNodes; ++i) {
+        std::string prefix(24, '0');
+        for (int bit = 0; bit < 24; ++bit) {
+            if ((i >> (23 - bit)) & 1) {
+                prefix[bit] = '1';
+            }
+        }
+        nodes.emplace_back(prefix, SecureByteBuffer(16, (unsigned char) i));
+    }
+    return {128, 128, (int) numNodes, nodes};
+}
+
+/* arguments {numNodes, threads} */
+static void BM_PPRFKey_Serialize(benchmark::State &state) {
+    PPRFKeySerializer serializer(largeKey(state.range(0)));
+    size_t size = 0;
+    for (auto _: state) {
+        SecureByteBuffer serialized = serializer.serialize(state.range(1));
+        size = serialized.size();
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+/* arguments {numNodes, threads} */
+static void BM_PPRFKey_Deserialize(benchmark::State &state) {
+    SecureByteBuffer serialized = PPRFKeySerializer(largeKey(state.range(0))).serialize();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(PPRFKeySerializer::deserialize(serialized, state.range(1)));
+    }
+    state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+
+static void BM_PKW_Wrap(benchmark::State &state) {
+    std::mt19937_64 rng(5);
+    int tagLen = state.range(0);
+    PPRF_AEAD_PKW pkw = puncturedPKW(tagLen, state.range(1), state.range(2), rng);
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    Tag tag = liveTag(rng, tagLen, [&](const Tag &t) {
+        try {
+            pkw.wrap(t, header, key);
+            return true;
+        } catch (std::exception &) {
+            return false;
+        }
+    });
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pkw.wrap(tag, header, key));
+        counter.stop();
+    }
+    /* may be below the argument for small tag spaces, see reachablePuncs */
+    state.counters["puncs"] = pkw.getNumPuncs();
+}
+
+static void BM_PKW_Unwrap(benchmark::State &state) {
+    std::mt19937_64 rng(6);
+    int tagLen = state.range(0);
+    PPRF_AEAD_PKW pkw = puncturedPKW(tagLen, state.range(1), state.range(2), rng);
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    ciphertext c;
+    Tag tag = liveTag(rng, tagLen, [&](const Tag &t) {
+        try {
+            c = pkw.wrap(t, header, key);
+            return true;
+        } catch (std::exception &) {
+            return false;
+        }
+    });
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pkw.unwrap(tag, header, c));
+        counter.stop();
+    }
+    /* may be below the argument for small tag spaces, see reachablePuncs */
+    state.counters["puncs"] = pkw.getNumPuncs();
+}
+
+static void BM_PKW_EncryptExport(benchmark::State &state) {
+    std::mt19937_64 rng(7);
+    SecureByteBuffer serialized = puncturedPKW(state.range(0), state.range(1), state.range(2), rng).serializeKey();
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(encryptExport(serialized, "password"));
+        counter.stop();
+    }
+}
+
+static void BM_PKW_DecryptExport(benchmark::State &state) {
+    std::mt19937_64 rng(8);
+    SecureByteBuffer serialized = puncturedPKW(state.range(0), state.range(1), state.range(2), rng).serializeKey();
+    SecureByteBuffer encrypted = encryptExport(serialized, "password");
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(decryptExport(encrypted, "password"));
+        counter.stop();
+    }
+}
+
+/* NaivePKW benchmarks take {tagLen}; its keys are fixed at KEY_LEN bytes and punctures do not change costs */
+
+static void BM_Naive_Construct(benchmark::State &state) {
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        NaivePKW naive(state.range(0));
+        counter.stop();
+        benchmark::DoNotOptimize(naive);
+    }
+}
+
+static void BM_Naive_Wrap(benchmark::State &state) {
+    NaivePKW naive(state.range(0));
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    AllocationCounter counter(state);
+    long tag = 0;
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(naive.wrap(tag, header, key));
+        counter.stop();
+        tag = (tag + 1) % (1L << state.range(0));
+    }
+}
+
+static void BM_Naive_Unwrap(benchmark::State &state) {
+    NaivePKW naive(state.range(0));
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    std::vector<unsigned char> c = naive.wrap(1, header, key);
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(naive.unwrap(1, header, c));
+        counter.stop();
+    }
+}
+
+static void BM_Naive_Punc(benchmark::State &state) {
+    const long numTags = 1L << state.range(0);
+    std::unique_ptr<NaivePKW> naive(new NaivePKW(state.range(0)));
+    AllocationCounter counter(state);
+    long tag = 0;
+    for (auto _: state) {
+        if (tag == numTags) {
+            state.PauseTiming();
+            naive.reset(new NaivePKW(state.range(0)));
+            tag = 0;
+            state.ResumeTiming();
+        }
+        counter.start();
+        naive->punc(tag++);
+        counter.stop();
+    }
+}
+
+/* BloomPKW against PPRF_AEAD_PKW with 256 bit tags and 128 bit keys. The benchmarks take {scheme, puncs}, scheme 0 being
+ * PPRF_AEAD_PKW and 1 BloomPKW sized for BLOOM_PUNCS punctures at a false puncture rate of BLOOM_RATE, and report the
+ * serialized key size after the punctures */
+
+static const size_t BLOOM_PUNCS = 10000;
+static const double BLOOM_RATE = 0.001;
+
+static std::unique_ptr<BloomPKW> puncturedBloom(int puncs, std::mt19937_64 &rng) {
+    std::unique_ptr<BloomPKW> pkw(new BloomPKW(BloomPKW::parametersFor(BLOOM_PUNCS, BLOOM_RATE)));
+    while (pkw->getNumPuncs() < puncs) {
+        pkw->punc(randomTag(rng, MAX_TAG_LEN));
+    }
+    return pkw;
+}
+
+template<class PKW>
+static void wrapLoop(benchmark::State &state, PKW &pkw, std::mt19937_64 &rng) {
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    Tag tag = liveTag(rng, MAX_TAG_LEN, [&](const Tag &t) { return !pkw.isPunctured(t); });
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pkw.wrap(tag, header, key));
+        counter.stop();
+    }
+    state.counters["key_bytes"] = (double) pkw.serializeKey().size();
+}
+
+template<class PKW>
+static void unwrapLoop(benchmark::State &state, PKW &pkw, std::mt19937_64 &rng) {
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+    Tag tag = liveTag(rng, MAX_TAG_LEN, [&](const Tag &t) { return !pkw.isPunctured(t); });
+    std::vector<unsigned char> c = pkw.wrap(tag, header, key);
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pkw.unwrap(tag, header, c));
+        counter.stop();
+    }
+    state.counters["key_bytes"] = (double) pkw.serializeKey().size();
+}
+
+/* punctures accumulate on one key; copying a large PPRF key per iteration would dominate the measurement */
+template<class PKW>
+static void puncLoop(benchmark::State &state, PKW &pkw, std::mt19937_64 &rng) {
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        Tag tag = randomTag(rng, MAX_TAG_LEN);
+        counter.start();
+        pkw.punc(tag);
+        counter.stop();
+    }
+    state.counters["key_bytes"] = (double) pkw.serializeKey().size();
+}
+
+template<void (*Loop)(benchmark::State &, PPRF_AEAD_PKW &, std::mt19937_64 &),
+         void (*BloomLoop)(benchmark::State &, BloomPKW &, std::mt19937_64 &)>
+static void BM_Bloom_Compare(benchmark::State &state) {
+    std::mt19937_64 rng(11);
+    if (state.range(0) == 0) {
+        PPRF_AEAD_PKW pkw = puncturedPKW(MAX_TAG_LEN, 128, state.range(1), rng);
+        Loop(state, pkw, rng);
+    } else {
+        std::unique_ptr<BloomPKW> pkw = puncturedBloom(state.range(1), rng);
+        BloomLoop(state, *pkw, rng);
+    }
+}
+
+/* Batch benchmarks take {tagLen, keyLen} and wrap BATCH_SIZE keys per iteration: through the static batch driver,
+ * through the virtual interface of an instance from the factory, and as one bundle under a single tag */
+
+static const size_t BATCH_SIZE = 64;
+
+static void BM_PKW_WrapBatch(benchmark::State &state) {
+    PPRF_AEAD_PKW pkw(state.range(0), state.range(1));
+    std::vector<Tag> tags;
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        tags.emplace_back(i);
+    }
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<std::vector<unsigned char>> keys(BATCH_SIZE, std::vector<unsigned char>(32, 'k'));
+    std::vector<ciphertext> out;
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        pkw.wrapBatch(tags, header, keys, out);
+        counter.stop();
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+static void BM_PKW_WrapBatchVirtual(benchmark::State &state) {
+    SecureByteBuffer serialized = PPRF_AEAD_PKW(state.range(0), state.range(1)).serializeKey();
+    std::shared_ptr<AbstractPKW<Tag, ciphertext>> instance = PPRF_AEAD_PKW_Factory().fromSerialized(serialized);
+    AbstractPKW<Tag, ciphertext> &pkw = *instance;
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<std::vector<unsigned char>> keys(BATCH_SIZE, std::vector<unsigned char>(32, 'k'));
+    std::vector<ciphertext> out(BATCH_SIZE);
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        for (size_t i = 0; i < BATCH_SIZE; ++i) {
+            out[i] = pkw.wrap(Tag(i), header, keys[i]);
+        }
+        counter.stop();
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+static void BM_PKW_WrapBundle(benchmark::State &state) {
+    PPRF_AEAD_PKW pkw(state.range(0), state.range(1));
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<std::vector<unsigned char>> keys(BATCH_SIZE, std::vector<unsigned char>(32, 'k'));
+    AllocationCounter counter(state);
+    for (auto _: state) {
+        counter.start();
+        benchmark::DoNotOptimize(pkw.wrapBundle(1, header, keys));
+        counter.stop();
+    }
+}
+
+static const std::vector<int64_t> TAG_LENS = {16, 32, 64, 128, 256};
+static const std::vector<int64_t> KEY_LENS = {128, 256};
+static const std::vector<int64_t> PUNCS = {0, 100, 1000};
+
+BENCHMARK(BM_GGM_Eval)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({TAG_LENS, KEY_LENS, PUNCS});
+BENCHMARK(BM_GGM_Punc)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({TAG_LENS, KEY_LENS, PUNCS});
+BENCHMARK(BM_GGM_EvalArity)->ArgNames({"tagLen", "arity", "puncs"})->ArgsProduct({{64, 256}, {2, 4, 16, 256}, {0, 100}});
+BENCHMARK(BM_GGM_EvalFrontier)->ArgNames({"tagLen", "depth"})->ArgsProduct({{32, 128}, {0, 8, 16, 20}});
+BENCHMARK(BM_GGM_PuncArity)->ArgNames({"tagLen", "arity", "puncs"})->ArgsProduct({{64, 256}, {2, 4, 16, 256}, {100}});
+BENCHMARK(BM_GGM_SerializeKey)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({TAG_LENS, {128}, PUNCS});
+BENCHMARK(BM_GGM_FromSerialized)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({TAG_LENS, {128}, PUNCS});
+BENCHMARK(BM_PPRFKey_Serialize)->ArgNames({"nodes", "threads"})->ArgsProduct({{1 << 16, 1 << 21}, {1, 2, 4, 8}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_PPRFKey_Deserialize)->ArgNames({"nodes", "threads"})->ArgsProduct({{1 << 16, 1 << 21}, {1, 2, 4, 8}})->Unit(benchmark::kMillisecond)->UseRealTime();
+/* small tag lengths overlap with the NaivePKW benchmarks, to locate the crossover */
+BENCHMARK(BM_PKW_Wrap)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({{8, 12, 16, 32, 64, 128, 256}, KEY_LENS, PUNCS});
+BENCHMARK(BM_PKW_Unwrap)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({{8, 12, 16, 32, 64, 128, 256}, KEY_LENS, PUNCS});
+BENCHMARK(BM_PKW_EncryptExport)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({{128}, {128}, PUNCS});
+BENCHMARK(BM_PKW_DecryptExport)->ArgNames({"tagLen", "keyLen", "puncs"})->ArgsProduct({{128}, {128}, PUNCS});
+BENCHMARK(BM_PKW_WrapBatch)->ArgNames({"tagLen", "keyLen"})->ArgsProduct({{32, 128}, KEY_LENS});
+BENCHMARK(BM_PKW_WrapBatchVirtual)->ArgNames({"tagLen", "keyLen"})->ArgsProduct({{32, 128}, KEY_LENS});
+BENCHMARK(BM_PKW_WrapBundle)->ArgNames({"tagLen", "keyLen"})->ArgsProduct({{32, 128}, KEY_LENS});
+BENCHMARK_TEMPLATE(BM_Bloom_Compare, wrapLoop<PPRF_AEAD_PKW>, wrapLoop<BloomPKW>)->Name("BM_Bloom_Wrap")->ArgNames({"scheme", "puncs"})->ArgsProduct({{0, 1}, {0, 1000, 10000}});
+BENCHMARK_TEMPLATE(BM_Bloom_Compare, unwrapLoop<PPRF_AEAD_PKW>, unwrapLoop<BloomPKW>)->Name("BM_Bloom_Unwrap")->ArgNames({"scheme", "puncs"})->ArgsProduct({{0, 1}, {0, 1000, 10000}});
+BENCHMARK_TEMPLATE(BM_Bloom_Compare, puncLoop<PPRF_AEAD_PKW>, puncLoop<BloomPKW>)->Name("BM_Bloom_Punc")->ArgNames({"scheme", "puncs"})->ArgsProduct({{0, 1}, {0, 1000, 10000}});
+BENCHMARK(BM_Naive_Construct)->ArgName("tagLen")->DenseRange(8, 16, 4)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Naive_Wrap)->ArgName("tagLen")->DenseRange(8, 16, 4);
+BENCHMARK(BM_Naive_Unwrap)->ArgName("tagLen")->DenseRange(8, 16, 4);
+BENCHMARK(BM_Naive_Punc)->ArgName("tagLen")->DenseRange(8, 16, 4);
+
+BENCHMARK_MAIN();
@@ -1,7 +1,12 @@
 #include "pkw/exceptions.h"
+#include "pkw/mapped_naive_pkw.h"
+#include "pkw/naive_key_table.h"
 #include "pkw/naive_pkw.h"
+#include <cstdio>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <unistd.h>
 #include <vector>
 
 
@@ -118,4 +123,145 @@ TEST_F(NaivePKWTest, TestWrapExportImportKeyWithWrongPassword) {
 
     auto exp = naive.serializeAndEncryptKey("myPassword");
     ASSERT_THROW(NaivePKWFactory().fromSerializedAndEncrypted(exp, "wrongPassword"), ImportException) << "Should not be able to import if decrypted with wrong password";
-}
\ No newline at end of file
+}
+TEST_F(NaivePKWTest, TestMemoryUsage) {
+    MemoryUsage before = naive.memoryUsage();
+    ASSERT_EQ(before.secretBytes, 1024u * KEY_LEN);
+    ASSERT_TRUE(before.depthHistogram.empty());
+    MemoryProjection projection = naive.projectMemoryUsage(10, PunctureOrder::Sequential);
+    for (int i = 0; i < 10; ++i) {
+        naive.punc(i);
+    }
+    ASSERT_EQ(naive.memoryUsage().secretBytes, 1014u * KEY_LEN);
+    ASSERT_EQ(projection.usage.total(), naive.memoryUsage().total());
+    ASSERT_EQ(projection.serializedBytes, naive.serializeKey().size());
+}
+
+TEST_F(NaivePKWTest, TestTagOutOfRange) {
+    auto empty = std::vector<unsigned char>();
+    ASSERT_THROW(naive.wrap(-1, empty, empty), IllegalTagException);
+    ASSERT_THROW(naive.wrap(1024, empty, empty), IllegalTagException);
+    ASSERT_THROW(naive.punc(1024), IllegalTagException);
+    naive.punc(1023);
+    auto key = naive.serializeKey();
+    auto naive2 = NaivePKWFactory().fromSerialized(key);
+    ASSERT_THROW(naive2->wrap(1023, empty, empty), IllegalTagException) << "punctured tag stays in the tag space";
+    ASSERT_THROW(naive2->wrap(1024, empty, empty), IllegalTagException);
+}
+
+TEST_F(NaivePKWTest, TestTagLengthOutOfRange) {
+    ASSERT_THROW(NaivePKW(-1), IllegalTagException);
+    ASSERT_THROW(NaivePKW(NaiveKeyTable::MAX_TAG_LEN + 1), IllegalTagException);
+    ASSERT_THROW(NaivePKW(64), IllegalTagException);
+    const std::string path = "mapped_naive_pkw_range_test.tbl";
+    ASSERT_THROW(MappedNaivePKW::create(path, -1), IllegalTagException);
+    ASSERT_THROW(MappedNaivePKW::create(path, 64), IllegalTagException);
+    ASSERT_NE(::access(path.c_str(), F_OK), 0) << "no file is created";
+}
+
+TEST_F(NaivePKWTest, TestFixedLayout) {
+    naive.punc(5);
+    auto serialized = naive.serializeKey();
+    ASSERT_EQ(serialized.size(), NaiveKeyTable::sizeFor(10));
+    NaiveKeyTable table = NaiveKeyTable::open(serialized.data(), serialized.size());
+    ASSERT_EQ(table.numPunctures(), 1);
+    ASSERT_TRUE(table.isPunctured(5));
+    ASSERT_FALSE(table.isPunctured(4));
+    ASSERT_EQ(std::vector<unsigned char>(table.key(5), table.key(5) + KEY_LEN), std::vector<unsigned char>(KEY_LEN, 0));
+    ASSERT_THROW(NaiveKeyTable::open(serialized.data(), serialized.size() - 1), DeserializationError);
+}
+
+TEST(NaivePKWFormatTest, TestRecordFormat) {
+    /* tags 0 to 2 of a tag space of 4, tag 3 punctured */
+    std::vector<unsigned char> records = {1, 0, 0, 0, 0, 0, 0, 0};
+    for (unsigned char tag = 0; tag < 3; ++tag) {
+        std::vector<unsigned char> record(sizeof(long) + KEY_LEN, tag);
+        std::fill(record.begin(), record.begin() + sizeof(long), 0);
+        record[0] = tag;
+        records.insert(records.end(), record.begin(), record.end());
+    }
+    SecureByteBuffer serialized(records);
+    auto naive = NaivePKWFactory().fromSerialized(serialized);
+    std::vector<unsigned char> empty;
+    ASSERT_EQ(naive->getNumPuncs(), 1);
+    ASSERT_NO_THROW(naive->wrap(2, empty, empty));
+    ASSERT_THROW(naive->wrap(3, empty, empty), IllegalTagException);
+    ASSERT_THROW(naive->wrap(4, empty, empty), IllegalTagException);
+}
+
+TEST(MappedNaivePKWTest, TestPuncturesPersist) {
+    const std::string path = "mapped_naive_pkw_test.tbl";
+    std::string key_str = "mykey";
+    std::vector<unsigned char> key(key_str.begin(), key_str.end());
+    std::vector<unsigned char> head;
+    std::vector<unsigned char> wrapped;
+    MappedNaivePKW::create(path, 12);
+    {
+        MappedNaivePKW mapped(path);
+        wrapped = mapped.wrap(7, head, key);
+        mapped.punc(8);
+        ASSERT_EQ(mapped.getNumPuncs(), 1);
+    }
+    {
+        MappedNaivePKW mapped(path);
+        ASSERT_EQ(mapped.getNumPuncs(), 1);
+        ASSERT_EQ(mapped.unwrap(7, head, wrapped), key);
+        ASSERT_THROW(mapped.wrap(8, head, key), IllegalTagException);
+        auto serialized = mapped.serializeKey();
+        auto naive = NaivePKWFactory().fromSerialized(serialized);
+        ASSERT_EQ(naive->unwrap(7, head, wrapped), key) << "same layout in memory and on disk";
+        mapped.secureTeardown();
+        ASSERT_THROW(mapped.unwrap(7, head, wrapped), TornDownException);
+        ASSERT_THROW(mapped.getNumPuncs(), TornDownException);
+    }
+    std::remove(path.c_str());
+    ASSERT_THROW(MappedNaivePKW mapped(path), ImportException);
+}
+
+TEST(MappedNaivePKWTest, TestTornPunctures) {
+    const std::string path = "mapped_naive_pkw_torn_test.tbl";
+    std::vector<unsigned char> key(16, 'k');
+    std::vector<unsigned char> head;
+    MappedNaivePKW::create(path, 8);
+    {
+        /* a crash after zeroizing the key of tag 3 but before marking it, and one after marking tag 4 */
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        std::vector<char> table((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        NaiveKeyTable t = NaiveKeyTable::open(reinterpret_cast<unsigned char *>(table.data()), table.size());
+        t.zeroizeKey(3);
+        ASSERT_TRUE(t.markPunctured(4));
+        file.seekp(0);
+        file.write(table.data(), table.size());
+    }
+    {
+        MappedNaivePKW mapped(path);
+        ASSERT_THROW(mapped.wrap(3, head, key), IllegalTagException) << "never wrap under a zero key";
+        ASSERT_THROW(mapped.wrap(4, head, key), IllegalTagException);
+        ASSERT_NO_THROW(mapped.wrap(5, head, key));
+        mapped.punc(4);
+        mapped.punc(3);
+        ASSERT_EQ(mapped.getNumPuncs(), 2);
+    }
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> table((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    NaiveKeyTable t = NaiveKeyTable::open(reinterpret_cast<unsigned char *>(table.data()), table.size());
+    ASSERT_TRUE(t.isPunctured(3));
+    ASSERT_TRUE(t.isZeroKey(4)) << "puncturing again erases the key left behind";
+    ASSERT_FALSE(t.isZeroKey(5));
+    std::remove(path.c_str());
+}
+
+TEST_F(NaivePKWTest, TestBatchOperations) {
+    std::vector<long> tags = {4, 5};
+    std::vector<unsigned char> head(4, 'h');
+    std::vector<std::vector<unsigned char>> keys = {std::vector<unsigned char>(16, 'a'),
+                                                    std::vector<unsigned char>(16, 'b')};
+    std::vector<std::vector<unsigned char>> wrapped;
+    naive.wrapBatch(tags, head, keys, wrapped);
+    std::vector<std::vector<unsigned char>> unwrapped;
+    naive.unwrapBatch(tags, head, wrapped, unwrapped);
+    ASSERT_EQ(unwrapped, keys);
+    naive.puncBatch(tags);
+    ASSERT_EQ(naive.getNumPuncs(), 2);
+    ASSERT_THROW(naive.wrapBatch(tags, head, keys, wrapped), IllegalTagException);
+}
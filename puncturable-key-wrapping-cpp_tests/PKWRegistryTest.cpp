@@ -0,0 +1,210 @@
+#include "pkw/exceptions.h"
+#include "pkw/pkw_registry.h"
+#include <cstdlib>
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class PKWRegistryTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            char pattern[] = "/tmp/pkw_registry_test_XXXXXX";
+            ASSERT_NE(mkdtemp(pattern), nullptr);
+            dir = pattern;
+        }
+
+        void TearDown() override {
+            ::rmdir(dir.c_str());
+        }
+
+    public:
+        PKWRegistryTest() : head(4, 'h'), key(16, 'k') {}
+
+        PKWRegistryOptions options(size_t budget) const {
+            PKWRegistryOptions o;
+            o.memoryBudget = budget;
+            o.spillDirectory = dir;
+            return o;
+        }
+
+        size_t spillFiles() const {
+            size_t n = 0;
+            DIR *d = opendir(dir.c_str());
+            while (dirent *e = readdir(d)) {
+                n += e->d_name[0] != '.';
+            }
+            closedir(d);
+            return n;
+        }
+
+        /* the memory of one fresh resident key */
+        static size_t freshKeyBytes() {
+            return PPRF_AEAD_PKW(32, 128).memoryUsage().total();
+        }
+
+        std::string dir;
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST_F(PKWRegistryTest, TestEvictsLeastRecentlyUsed) {
+    PKWRegistry registry(options(3 * freshKeyBytes()));
+    std::map<std::string, ciphertext> wrapped;
+    for (int t = 0; t < 10; ++t) {
+        std::string tenant = "tenant" + std::to_string(t);
+        registry.create(tenant, 32, 128);
+        wrapped[tenant] = registry.wrap(tenant, Tag(t), head, key);
+        ASSERT_LE(registry.residentBytes(), 3 * freshKeyBytes());
+    }
+    ASSERT_EQ(registry.numTenants(), 10);
+    ASSERT_EQ(registry.numResident(), 3);
+    ASSERT_EQ(spillFiles(), 7);
+    ASSERT_FALSE(registry.isResident("tenant0"));
+    ASSERT_TRUE(registry.isResident("tenant9"));
+
+    /* touching tenant7 makes tenant8 the least recently used */
+    registry.with("tenant7", [](PPRF_AEAD_PKW &) {});
+    ASSERT_EQ(registry.unwrap("tenant0", Tag(0), head, wrapped["tenant0"]), key);
+    ASSERT_TRUE(registry.isResident("tenant0"));
+    ASSERT_TRUE(registry.isResident("tenant7"));
+    ASSERT_FALSE(registry.isResident("tenant8"));
+    for (auto &w: wrapped) {
+        int t = std::stoi(w.first.substr(6));
+        ASSERT_EQ(registry.unwrap(w.first, Tag(t), head, w.second), key);
+    }
+    PKWRegistryStats stats = registry.stats();
+    ASSERT_GE(stats.evictions, 7);
+    ASSERT_GE(stats.loads, 7);
+}
+
+TEST_F(PKWRegistryTest, TestPuncturesSurviveEviction) {
+    PKWRegistry registry(options(1));
+    registry.create("a", 32, 128);
+    ciphertext c = registry.wrap("a", Tag(5), head, key);
+    registry.punc("a", Tag(5));
+    ASSERT_FALSE(registry.isResident("a")) << "the budget fits no key once it is not in use";
+    ASSERT_THROW(registry.unwrap("a", Tag(5), head, c), IllegalTagException);
+    ASSERT_EQ(registry.with("a", [](PPRF_AEAD_PKW &pkw) { return pkw.getNumPuncs(); }), 1);
+    ASSERT_EQ(registry.residentBytes(), 0);
+}
+
+TEST_F(PKWRegistryTest, TestTenantsHaveDistinctKeys) {
+    PKWRegistry registry(options(size_t(1) << 30));
+    registry.create("alice", 32, 128);
+    registry.create("bob", 32, 128);
+    ciphertext c = registry.wrap("alice", Tag(1), head, key);
+    ASSERT_THROW(registry.unwrap("bob", Tag(1), head, c), UnwrappingException);
+    ASSERT_EQ(registry.unwrap("alice", Tag(1), head, c), key);
+}
+
+TEST_F(PKWRegistryTest, TestAddLoadsLazily) {
+    PPRF_AEAD_PKW pkw(32, 128);
+    ciphertext c = pkw.wrap(Tag(1), head, key);
+    PKWRegistry registry(options(size_t(1) << 30));
+    registry.add("a", pkw.serializeKey());
+    ASSERT_THROW(registry.add("a", pkw.serializeKey()), std::invalid_argument);
+    ASSERT_FALSE(registry.isResident("a"));
+    ASSERT_EQ(registry.stats().loads, 0);
+    ASSERT_EQ(spillFiles(), 1);
+    ASSERT_EQ(registry.unwrap("a", Tag(1), head, c), key);
+    ASSERT_TRUE(registry.isResident("a"));
+    ASSERT_EQ(registry.stats().loads, 1);
+    registry.punc("a", Tag(1));
+    ASSERT_EQ(spillFiles(), 0) << "no copy of the key from before the puncture remains";
+}
+
+TEST_F(PKWRegistryTest, TestLoaderAndRemove) {
+    PPRF_AEAD_PKW pkw(32, 128);
+    ciphertext c = pkw.wrap(Tag(1), head, key);
+    SecureByteBuffer exported = pkw.serializeAndEncryptKey("secret");
+    int calls = 0;
+    PKWRegistryOptions o = options(1);
+    o.loader = [&](const std::string &tenant) {
+        ++calls;
+        return tenant == "known" ? exported : SecureByteBuffer();
+    };
+    o.loaderPassword = "secret";
+    {
+        PKWRegistry registry(o);
+        ASSERT_THROW(registry.with("unknown", [](PPRF_AEAD_PKW &) {}), std::out_of_range);
+        ASSERT_FALSE(registry.contains("unknown"));
+        ASSERT_EQ(registry.unwrap("known", Tag(1), head, c), key);
+        ASSERT_EQ(spillFiles(), 1) << "the key is evicted right away";
+        registry.with("known", [&](PPRF_AEAD_PKW &) {
+            ASSERT_EQ(spillFiles(), 0) << "the spill file is deleted once the key is loaded";
+        });
+        ASSERT_EQ(calls, 2) << "the second access reads the spill file";
+        ASSERT_EQ(spillFiles(), 1) << "and evicts the key again";
+        registry.remove("known");
+        ASSERT_FALSE(registry.contains("known"));
+        ASSERT_EQ(spillFiles(), 0);
+        registry.punc("known", Tag(2));
+        ASSERT_EQ(spillFiles(), 1);
+    }
+    ASSERT_EQ(spillFiles(), 0) << "spill files are deleted with the registry";
+    ASSERT_THROW(PKWRegistry(options(0)), std::invalid_argument);
+    ASSERT_THROW(PKWRegistry(options(1)).with("a", [](PPRF_AEAD_PKW &) {}), std::out_of_range);
+}
+
+TEST_F(PKWRegistryTest, TestRejectsModifiedSpillFile) {
+    PKWRegistry registry(options(1));
+    registry.create("a", 32, 128);
+    DIR *d = opendir(dir.c_str());
+    std::string file;
+    while (dirent *e = readdir(d)) {
+        if (e->d_name[0] != '.') {
+            file = dir + "/" + e->d_name;
+        }
+    }
+    closedir(d);
+    ASSERT_FALSE(file.empty());
+    FILE *f = fopen(file.c_str(), "r+b");
+    fseek(f, 20, SEEK_SET);
+    int b = fgetc(f);
+    fseek(f, 20, SEEK_SET);
+    fputc(b ^ 1, f);
+    fclose(f);
+    ASSERT_THROW(registry.with("a", [](PPRF_AEAD_PKW &) {}), ImportException);
+}
+
+TEST_F(PKWRegistryTest, TestConcurrentTenants) {
+    PKWRegistry registry(options(4 * freshKeyBytes()));
+    const int tenants = 16;
+    for (int t = 0; t < tenants; ++t) {
+        registry.create(std::to_string(t), 32, 128);
+    }
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (int w = 0; w < 4; ++w) {
+        threads.emplace_back([&, w] {
+            std::vector<unsigned char> h(4, 'h');
+            std::vector<unsigned char> k(16, (unsigned char) w);
+            for (int i = 0; i < 200; ++i) {
+                std::string tenant = std::to_string((i * 7 + w) % tenants);
+                Tag tag(1000 * w + i);
+                ciphertext c = registry.wrap(tenant, tag, h, k);
+                if (registry.unwrap(tenant, tag, h, c) != k) {
+                    ++failures[w];
+                }
+                if (i % 10 == 0) {
+                    registry.punc(tenant, tag);
+                }
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    ASSERT_EQ(failures, std::vector<int>(4, 0));
+    ASSERT_LE(registry.residentBytes(), 4 * freshKeyBytes() * 2);
+    long puncs = 0;
+    for (int t = 0; t < tenants; ++t) {
+        puncs += registry.with(std::to_string(t), [](PPRF_AEAD_PKW &pkw) { return pkw.getNumPuncs(); });
+    }
+    ASSERT_EQ(puncs, 4 * 20);
+}
@@ -121,4 +121,124 @@ TEST_F(PPRF_AEAD_PKWTest, TestWrapExportImportKeyWithWrongPassword) {
 
     auto exp = pkw.serializeAndEncryptKey("myPassword");
     ASSERT_THROW(PPRF_AEAD_PKW_Factory().fromSerializedAndEncrypted(exp, "wrongPassword"), ImportException) << "Should not be able to import if decrypted with wrong password";
-}
\ No newline at end of file
+}
+TEST_F(PPRF_AEAD_PKWTest, TestTryOperations) {
+    std::vector<unsigned char> key(16, 'k');
+    std::vector<unsigned char> head(4, 'h');
+    PKWResult<ciphertext> wrapped = pkw.tryWrap(1, head, key);
+    ASSERT_TRUE(wrapped.ok());
+    PKWResult<std::vector<unsigned char>> unwrapped = pkw.tryUnwrap(1, head, wrapped.value());
+    ASSERT_TRUE(unwrapped);
+    ASSERT_EQ(unwrapped.value(), key);
+
+    ciphertext tampered = wrapped.value();
+    tampered[0] ^= 1;
+    ASSERT_EQ(pkw.tryUnwrap(1, head, tampered).error(), PKWError::Authentication);
+    ASSERT_EQ(pkw.tryUnwrap(1, head, ciphertext(3)).error(), PKWError::Authentication);
+    ASSERT_EQ(pkw.tryWrap(Tag(1) << 128, head, key).error(), PKWError::IllegalTag);
+    ASSERT_EQ(pkw.tryPunc(Tag(1) << 128).error(), PKWError::IllegalTag);
+
+    ASSERT_FALSE(pkw.isPunctured(1));
+    ASSERT_TRUE(pkw.tryPunc(1).ok());
+    ASSERT_TRUE(pkw.isPunctured(1));
+    ASSERT_FALSE(pkw.isPunctured(2));
+    ASSERT_THROW(pkw.isPunctured(Tag(1) << 128), IllegalTagException);
+    PKWResult<std::vector<unsigned char>> punctured = pkw.tryUnwrap(1, head, wrapped.value());
+    ASSERT_EQ(punctured.error(), PKWError::Punctured);
+    ASSERT_THROW(punctured.value(), IllegalTagException);
+    ASSERT_EQ(pkw.tryWrap(1, head, key).error(), PKWError::Punctured);
+}
+
+TEST_F(PPRF_AEAD_PKWTest, TestBatchOperations) {
+    std::vector<Tag> tags = {1, 2, 3};
+    std::vector<unsigned char> head(4, 'h');
+    std::vector<std::vector<unsigned char>> keys = {std::vector<unsigned char>(16, 'a'),
+                                                    std::vector<unsigned char>(16, 'b'),
+                                                    std::vector<unsigned char>(32, 'c')};
+    std::vector<ciphertext> wrapped;
+    pkw.wrapBatch(tags, head, keys, wrapped);
+    ASSERT_EQ(wrapped.size(), tags.size());
+    std::vector<std::vector<unsigned char>> unwrapped;
+    pkw.unwrapBatch(tags, head, wrapped, unwrapped);
+    ASSERT_EQ(unwrapped, keys);
+    ASSERT_THROW(pkw.unwrapBatch({1, 2}, head, wrapped, unwrapped), std::invalid_argument);
+
+    pkw.puncBatch({2, 3});
+    ASSERT_EQ(pkw.getNumPuncs(), 2);
+    ASSERT_THROW(pkw.unwrapBatch(tags, head, wrapped, unwrapped), IllegalTagException);
+}
+
+TEST_F(PPRF_AEAD_PKWTest, TestFactoryReturnsConcreteType) {
+    std::vector<unsigned char> key(16, 'k');
+    std::vector<unsigned char> head(4, 'h');
+    SecureByteBuffer serialized = pkw.serializeKey();
+    std::shared_ptr<AbstractPKW<Tag, ciphertext>> abstract = PPRF_AEAD_PKW_Factory().fromSerialized(serialized);
+    std::shared_ptr<PPRF_AEAD_PKW> concrete = std::dynamic_pointer_cast<PPRF_AEAD_PKW>(abstract);
+    ASSERT_NE(concrete, nullptr);
+    ciphertext c = abstract->wrap(5, head, key);
+    ASSERT_EQ(concrete->unwrap(5, head, c), key);
+    abstract->punc(5);
+    ASSERT_TRUE(concrete->isPunctured(5));
+    ASSERT_EQ(concrete->getNumPuncs(), 1);
+    ASSERT_THROW(abstract->unwrap(5, head, c), IllegalTagException);
+}
+
+TEST_F(PPRF_AEAD_PKWTest, TestBindsToAbstractPKW) {
+    std::vector<unsigned char> key(16, 'k');
+    std::vector<unsigned char> head(4, 'h');
+    AbstractPKW<Tag, ciphertext> &abstract = pkw;
+    ciphertext c = abstract.wrap(5, head, key);
+    ASSERT_EQ(pkw.unwrap(5, head, c), key);
+    std::shared_ptr<AbstractPKW<Tag, ciphertext>> shared = std::make_shared<PPRF_AEAD_PKW>(64, 128);
+    shared->punc(5);
+    ASSERT_EQ(shared->getNumPuncs(), 1);
+}
+
+TEST_F(PPRF_AEAD_PKWTest, TestBundleWrapThenUnwrap) {
+    std::vector<unsigned char> head(4, 'h');
+    std::vector<std::vector<unsigned char>> keys;
+    for (int i = 0; i < 20; ++i) {
+        keys.emplace_back(16 + i, (unsigned char) i);
+    }
+    ciphertext bundle = pkw.wrapBundle(7, head, keys);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(pkw.unwrapBundle(7, head, bundle, i), keys[i]);
+    }
+    ASSERT_THROW(pkw.unwrapBundle(7, head, bundle, keys.size()), UnwrappingException);
+    ASSERT_THROW(pkw.unwrapBundle(8, head, bundle, 0), UnwrappingException);
+    std::vector<unsigned char> otherHead(4, 'x');
+    ASSERT_THROW(pkw.unwrapBundle(7, otherHead, bundle, 0), UnwrappingException);
+
+    ciphertext tampered = bundle;
+    tampered.back() ^= 1;
+    ASSERT_THROW(pkw.unwrapBundle(7, head, tampered, keys.size() - 1), UnwrappingException);
+    ASSERT_EQ(pkw.unwrapBundle(7, head, tampered, 0), keys[0]) << "Other entries are not affected";
+    ASSERT_THROW(pkw.unwrapBundle(7, head, ciphertext(3), 0), UnwrappingException);
+    ciphertext truncated(bundle.begin(), bundle.begin() + 40);
+    ASSERT_THROW(pkw.unwrapBundle(7, head, truncated, 0), UnwrappingException);
+
+    ASSERT_THROW(pkw.unwrapBundle(7, head, pkw.wrapBundle(7, head, {}), 0), UnwrappingException);
+
+    pkw.punc(7);
+    ASSERT_THROW(pkw.unwrapBundle(7, head, bundle, 0), IllegalTagException);
+    ASSERT_THROW(pkw.wrapBundle(7, head, keys), IllegalTagException);
+}
+
+TEST_F(PPRF_AEAD_PKWTest, TestDelegateToWorker) {
+    std::vector<unsigned char> head(4, 'h');
+    std::vector<unsigned char> key(16, 'k');
+    /* the worker owns the tags whose top 8 bits are 0x7F */
+    Tag slice = Tag(0x7F) << 120;
+    SecureByteBuffer delegated = pkw.delegate(slice, 8);
+    PPRF_AEAD_PKW worker(delegated);
+    std::vector<unsigned char> wrapped = worker.wrap(slice | Tag(5), head, key);
+    ASSERT_EQ(pkw.unwrap(slice | Tag(5), head, wrapped), key);
+    ASSERT_THROW(worker.wrap(Tag(5), head, key), IllegalTagException);
+
+    worker.punc(slice | Tag(5));
+    SecureByteBuffer returned = worker.serializeKey();
+    pkw.merge(slice, 8, returned);
+    ASSERT_THROW(pkw.unwrap(slice | Tag(5), head, wrapped), IllegalTagException);
+    ASSERT_EQ(pkw.getNumPuncs(), 1);
+    ASSERT_THROW(pkw.delegate(slice, 129), IllegalTagException);
+}
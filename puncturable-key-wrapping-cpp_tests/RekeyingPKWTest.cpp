@@ -0,0 +1,98 @@
+#include "pkw/exceptions.h"
+#include "pkw/rekeying_pkw.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+class RekeyingPKWTest : public ::testing::Test {
+    protected:
+    public:
+        RekeyingPKWTest() : head(4, 'h'), key(16, 'k') {}
+
+        static RekeyPolicy nodeBudget(size_t maxNodes) {
+            RekeyPolicy policy;
+            policy.maxNodes = maxNodes;
+            return policy;
+        }
+
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST_F(RekeyingPKWTest, TestRekeyAndMigrate) {
+    RekeyingPKW pkw(32, 128, nodeBudget(100));
+    std::vector<WrappedKey> live;
+    for (uint32_t tag = 1000; tag < 1010; ++tag) {
+        live.push_back({Tag(tag), head, pkw.wrap(tag, head, key)});
+    }
+    /* each random puncture adds up to 32 nodes */
+    for (uint32_t i = 0; i < 4; ++i) {
+        ASSERT_FALSE(pkw.migrating());
+        pkw.punc(Tag(i * 0x10000000u + 5));
+    }
+    ASSERT_TRUE(pkw.migrating());
+    ASSERT_EQ(pkw.getGeneration(), 1u);
+    ASSERT_EQ(pkw.getNumPuncs(), 0) << "the new key is fresh";
+    ASSERT_EQ(pkw.getNumNodes(), 1u);
+    ASSERT_THROW(pkw.serializeKey(), MigrationException);
+
+    ASSERT_EQ(pkw.unwrap(live[0].tag, head, live[0].c), key) << "the previous key unwraps during the migration";
+    pkw.punc(Tag(1009));
+    std::vector<WrappedKey> batch(live.begin(), live.begin() + 5);
+    ASSERT_EQ(pkw.migrate(batch), 5u);
+    ASSERT_EQ(pkw.migrate(batch), 0u) << "already migrated";
+    ASSERT_EQ(batch.size(), 5u);
+    std::vector<WrappedKey> rest(live.begin() + 5, live.end());
+    ASSERT_EQ(pkw.migrate(rest), 4u);
+    ASSERT_EQ(rest.size(), 4u) << "the punctured tag is dropped";
+    pkw.finishMigration();
+    ASSERT_FALSE(pkw.migrating());
+
+    for (WrappedKey &wrapped: batch) {
+        ASSERT_EQ(pkw.unwrap(wrapped.tag, wrapped.header, wrapped.c), key);
+    }
+    for (WrappedKey &wrapped: rest) {
+        ASSERT_EQ(pkw.unwrap(wrapped.tag, wrapped.header, wrapped.c), key);
+    }
+    ASSERT_THROW(pkw.unwrap(live[0].tag, head, live[0].c), UnwrappingException) << "the previous key is gone";
+    ASSERT_THROW(pkw.migrate(batch), MigrationException);
+    ASSERT_NO_THROW(pkw.serializeKey());
+}
+
+TEST_F(RekeyingPKWTest, TestGraceWindowExpires) {
+    RekeyPolicy policy = nodeBudget(0);
+    policy.graceWindow = std::chrono::milliseconds(1);
+    RekeyingPKW pkw(16, 128, policy);
+    auto wrapped = pkw.wrap(3, head, key);
+    pkw.beginMigration();
+    ASSERT_THROW(pkw.beginMigration(), MigrationException);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_FALSE(pkw.migrating());
+    ASSERT_THROW(pkw.unwrap(3, head, wrapped), UnwrappingException);
+}
+
+TEST_F(RekeyingPKWTest, TestByteBudget) {
+    RekeyPolicy policy;
+    policy.maxBytes = 64 * 1024;
+    RekeyingPKW pkw(64, 128, policy);
+    size_t puncs = 0;
+    while (!pkw.migrating()) {
+        pkw.punc(Tag(puncs * 0x9E3779B97F4A7C15ull));
+        ++puncs;
+        ASSERT_LT(puncs, 10000u);
+    }
+    ASSERT_GT(pkw.memoryUsage().total(), policy.maxBytes) << "both keys are held";
+    pkw.finishMigration();
+    ASSERT_LT(pkw.memoryUsage().total(), 1024u);
+}
+
+TEST_F(RekeyingPKWTest, TestRestoreFromSerialized) {
+    RekeyingPKW pkw(16, 128, RekeyPolicy());
+    auto wrapped = pkw.wrap(3, head, key);
+    pkw.punc(4);
+    RekeyingPKW restored(pkw.serializeKey(), RekeyPolicy());
+    ASSERT_EQ(restored.unwrap(3, head, wrapped), key);
+    ASSERT_THROW(restored.unwrap(4, head, wrapped), IllegalTagException);
+    RekeyingPKW other(16, 128, RekeyPolicy());
+    ASSERT_THROW(other.unwrap(3, head, wrapped), UnwrappingException) << "fresh keys are random";
+}
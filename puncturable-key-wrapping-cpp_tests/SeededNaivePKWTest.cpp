@@ -0,0 +1,79 @@
+#include "pkw/exceptions.h"
+#include "pkw/helpers/puncture_set.h"
+#include "pkw/seeded_naive_pkw.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class SeededNaivePKWTest : public ::testing::Test {
+    protected:
+    public:
+        SeededNaivePKWTest() : pkw(40), head(4, 'h'), key(16, 'k') {}
+
+        SeededNaivePKW pkw;
+        std::vector<unsigned char> head;
+        std::vector<unsigned char> key;
+};
+
+TEST_F(SeededNaivePKWTest, TestWrapThenUnwrap) {
+    long tag = (1L << 40) - 1;
+    auto wrapped = pkw.wrap(tag, head, key);
+    ASSERT_EQ(pkw.unwrap(tag, head, wrapped), key);
+    auto other = pkw.wrap(tag - 1, head, key);
+    ASSERT_NE(wrapped, other) << "keys differ per tag";
+    ASSERT_THROW(pkw.wrap(1L << 40, head, key), IllegalTagException);
+    ASSERT_THROW(pkw.wrap(-1, head, key), IllegalTagException);
+}
+
+TEST_F(SeededNaivePKWTest, TestPuncThenUnwrap) {
+    auto wrapped = pkw.wrap(7, head, key);
+    pkw.punc(7);
+    pkw.punc(7);
+    ASSERT_EQ(pkw.getNumPuncs(), 1);
+    ASSERT_THROW(pkw.unwrap(7, head, wrapped), IllegalTagException);
+    ASSERT_THROW(pkw.wrap(7, head, key), IllegalTagException);
+}
+
+TEST_F(SeededNaivePKWTest, TestExportImportKey) {
+    auto wrapped = pkw.wrap(3, head, key);
+    for (long tag = 100; tag < 100 + 5000; ++tag) {
+        pkw.punc(tag);
+    }
+    pkw.punc(1L << 39);
+    auto serialized = pkw.serializeKey();
+    ASSERT_LT(serialized.size(), 9000u) << "only the seed and the compressed puncture set";
+    auto imported = SeededNaivePKWFactory().fromSerialized(serialized);
+    ASSERT_EQ(imported->getNumPuncs(), 5001);
+    ASSERT_EQ(imported->unwrap(3, head, wrapped), key);
+    ASSERT_THROW(imported->wrap(4000, head, key), IllegalTagException);
+    ASSERT_THROW(imported->wrap(1L << 39, head, key), IllegalTagException);
+    ASSERT_NO_THROW(imported->wrap(99, head, key));
+
+    SecureByteBuffer truncated(serialized.size() - 1);
+    std::copy(serialized.begin(), serialized.end() - 1, truncated.begin());
+    ASSERT_THROW(SeededNaivePKWFactory().fromSerialized(truncated), DeserializationError);
+}
+
+TEST(PunctureSetTest, TestArrayAndBitmapContainers) {
+    PunctureSet set;
+    for (uint64_t tag = 0; tag < 2 * PunctureSet::ARRAY_MAX; tag += 2) {
+        ASSERT_TRUE(set.insert(tag));
+    }
+    ASSERT_FALSE(set.insert(0));
+    ASSERT_TRUE(set.insert(uint64_t(1) << 50));
+    ASSERT_EQ(set.size(), PunctureSet::ARRAY_MAX + 1);
+    ASSERT_TRUE(set.contains(2));
+    ASSERT_FALSE(set.contains(3));
+    ASSERT_TRUE(set.insert(3)) << "converts the first group to a bitmap";
+    ASSERT_TRUE(set.contains(3));
+    ASSERT_FALSE(set.insert(3));
+
+    std::vector<unsigned char> buffer;
+    set.serialize(buffer);
+    size_t offset = 0;
+    PunctureSet copy = PunctureSet::deserialize(buffer.data(), buffer.size(), offset);
+    ASSERT_EQ(offset, buffer.size());
+    ASSERT_EQ(copy.size(), set.size());
+    ASSERT_TRUE(copy.contains(3));
+    ASSERT_TRUE(copy.contains(uint64_t(1) << 50));
+    ASSERT_FALSE(copy.contains(5));
+}
@@ -0,0 +1,135 @@
+#include "pkw/exceptions.h"
+#include "pkw/pprf_aead_pkw.h"
+#include "pkw/stream_aead.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <vector>
+
+class StreamTest : public ::testing::Test {
+    protected:
+    public:
+        StreamTest() : pkw(32, 128), head(4, 'h') {}
+
+        std::vector<unsigned char> payload(size_t n) {
+            std::vector<unsigned char> data(n);
+            for (size_t i = 0; i < n; ++i) {
+                data[i] = (unsigned char) (i * 31 + 7);
+            }
+            return data;
+        }
+
+        std::vector<unsigned char> wrap(Tag tag, const std::vector<unsigned char> &data, size_t chunkSize) {
+            MemorySource in(data.data(), data.size());
+            std::vector<unsigned char> c;
+            VectorSink out(c);
+            pkw.wrapStream(tag, head, in, out, chunkSize);
+            return c;
+        }
+
+        std::vector<unsigned char> unwrap(Tag tag, const std::vector<unsigned char> &c) {
+            MemorySource in(c.data(), c.size());
+            std::vector<unsigned char> data;
+            VectorSink out(data);
+            pkw.unwrapStream(tag, head, in, out);
+            return data;
+        }
+
+        PPRF_AEAD_PKW pkw;
+        std::vector<unsigned char> head;
+};
+
+TEST_F(StreamTest, TestWrapThenUnwrap) {
+    const size_t chunk = 64;
+    for (size_t n: {size_t(0), size_t(1), chunk - 1, chunk, chunk + 1, 3 * chunk, 5 * chunk + 17}) {
+        std::vector<unsigned char> data = payload(n);
+        std::vector<unsigned char> c = wrap(3, data, chunk);
+        size_t chunks = n == 0 ? 1 : (n + chunk - 1) / chunk;
+        ASSERT_EQ(c.size(), STREAM_HEADER_LEN + n + 16 * chunks) << n;
+        ASSERT_EQ(unwrap(3, c), data) << n;
+    }
+}
+
+TEST_F(StreamTest, TestTamperingDetected) {
+    const size_t chunk = 64;
+    const size_t chunkLen = chunk + 16;
+    std::vector<unsigned char> c = wrap(3, payload(4 * chunk), chunk);
+
+    std::vector<unsigned char> truncated(c.begin(), c.begin() + STREAM_HEADER_LEN + 2 * chunkLen);
+    ASSERT_THROW(unwrap(3, truncated), UnwrappingException) << "Truncation at a chunk boundary must be detected";
+
+    std::vector<unsigned char> reordered(c);
+    std::swap_ranges(reordered.begin() + STREAM_HEADER_LEN, reordered.begin() + STREAM_HEADER_LEN + chunkLen,
+                     reordered.begin() + STREAM_HEADER_LEN + chunkLen);
+    ASSERT_THROW(unwrap(3, reordered), UnwrappingException);
+
+    std::vector<unsigned char> flipped(c);
+    flipped[STREAM_HEADER_LEN + chunkLen + 5] ^= 1;
+    ASSERT_THROW(unwrap(3, flipped), UnwrappingException);
+
+    std::vector<unsigned char> resized(c);
+    resized[4] = 32;
+    ASSERT_THROW(unwrap(3, resized), UnwrappingException) << "The chunk size is authenticated";
+
+    ASSERT_THROW(unwrap(4, c), UnwrappingException);
+    head[0] = 'x';
+    ASSERT_THROW(unwrap(3, c), UnwrappingException);
+}
+
+TEST_F(StreamTest, TestSeekToChunk) {
+    const size_t chunk = 100;
+    std::vector<unsigned char> data = payload(5 * chunk + 30);
+    std::vector<unsigned char> c = wrap(9, data, chunk);
+    MemorySource in(c.data(), c.size());
+    StreamDecryptor decryptor = pkw.openStream(9, head, in);
+    ASSERT_EQ(decryptor.chunkSize(), chunk);
+
+    std::vector<unsigned char> out;
+    decryptor.seek(3);
+    ASSERT_TRUE(decryptor.next(out));
+    ASSERT_TRUE(std::equal(out.begin(), out.end(), data.begin() + 3 * chunk));
+    decryptor.seek(5);
+    ASSERT_TRUE(decryptor.next(out));
+    ASSERT_EQ(out, std::vector<unsigned char>(data.begin() + 5 * chunk, data.end()));
+    ASSERT_FALSE(decryptor.next(out));
+    decryptor.seek(6);
+    ASSERT_THROW(decryptor.next(out), UnwrappingException);
+}
+
+TEST_F(StreamTest, TestFileDescriptors) {
+    const std::string path = "stream_test.bin";
+    std::vector<unsigned char> data = payload(3 * STREAM_DEFAULT_CHUNK_SIZE + 5);
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(fd, 0);
+        MemorySource in(data.data(), data.size());
+        FdSink out(fd);
+        pkw.wrapStream(1, head, in, out);
+        ::close(fd);
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    FdSource in(fd);
+    std::vector<unsigned char> unwrapped;
+    VectorSink out(unwrapped);
+    pkw.unwrapStream(1, head, in, out);
+    ASSERT_EQ(unwrapped, data);
+
+    in.seek(0);
+    StreamDecryptor decryptor = pkw.openStream(1, head, in);
+    decryptor.seek(2);
+    std::vector<unsigned char> chunk;
+    ASSERT_TRUE(decryptor.next(chunk));
+    ASSERT_TRUE(std::equal(chunk.begin(), chunk.end(), data.begin() + 2 * STREAM_DEFAULT_CHUNK_SIZE));
+    ::close(fd);
+    std::remove(path.c_str());
+}
+
+TEST_F(StreamTest, TestPuncturedTag) {
+    std::vector<unsigned char> c = wrap(5, payload(10), 64);
+    pkw.punc(5);
+    ASSERT_THROW(unwrap(5, c), IllegalTagException);
+    ASSERT_THROW(wrap(5, payload(10), 64), IllegalTagException);
+    ASSERT_THROW(wrap(6, payload(10), 0), WrappingException);
+}
@@ -0,0 +1,80 @@
+#include "pkw/pprf_aead_pkw.h"
+#include "tracing.h"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class RecordingSink : public TraceSink {
+    public:
+        std::vector<std::pair<char, TraceOp>> events;
+        void begin(TraceOp op, int, size_t) override {
+            events.emplace_back('B', op);
+        }
+        void end(TraceOp op, int, size_t) override {
+            events.emplace_back('E', op);
+        }
+        size_t countBegin(TraceOp op) const {
+            size_t n = 0;
+            for (auto &e: events) {
+                n += e.first == 'B' && e.second == op;
+            }
+            return n;
+        }
+};
+
+TEST(TracingTest, TestSpansFromWrapAndPunc) {
+    RecordingSink sink;
+    setTraceSink(&sink);
+    PPRF_AEAD_PKW pkw(16, 128);
+    std::vector<unsigned char> header(4, 'h');
+    std::vector<unsigned char> key(16, 'k');
+    auto c = pkw.wrap(1, header, key);
+    pkw.punc(1);
+    setTraceSink(nullptr);
+#ifdef PKW_TRACING
+    ASSERT_EQ(sink.countBegin(TraceOp::Wrap), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::Eval), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::Derivation), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::AEAD), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::Punc), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::CoPath), 1u);
+    ASSERT_EQ(sink.countBegin(TraceOp::Splice), 1u);
+    /* spans are properly nested */
+    std::vector<TraceOp> stack;
+    for (auto &e: sink.events) {
+        if (e.first == 'B') {
+            stack.push_back(e.second);
+        } else {
+            ASSERT_FALSE(stack.empty());
+            ASSERT_EQ(stack.back(), e.second);
+            stack.pop_back();
+        }
+    }
+    ASSERT_TRUE(stack.empty());
+#else
+    ASSERT_TRUE(sink.events.empty());
+#endif
+}
+
+TEST(TracingTest, TestChromeTraceSink) {
+    std::string path = "tracing_test.json";
+    {
+        ChromeTraceSink sink(path);
+        sink.begin(TraceOp::Eval, 16, 1);
+        sink.begin(TraceOp::Derivation, 16, 1);
+        sink.end(TraceOp::Derivation, 16, 1);
+        sink.end(TraceOp::Eval, 16, 1);
+    }
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string json = content.str();
+    ASSERT_EQ(json.find("{\"traceEvents\":["), 0u);
+    ASSERT_NE(json.find("\"name\":\"derivation\",\"ph\":\"B\""), std::string::npos);
+    ASSERT_NE(json.find("\"args\":{\"depth\":16,\"nodes\":1}"), std::string::npos);
+    ASSERT_NE(json.find("]}"), std::string::npos);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,376 @@
+#include "pkw/exceptions.h"
+#include "pkw/pprf_aead_pkw.h"
+#include "secure_byte_buffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Macro benchmark replaying mixed wrap/unwrap/punc traces against a PPRF_AEAD_PKW, reporting how latency and key size
+ * evolve over the lifetime of a key.
+ *
+ * Usage: WorkloadBenchmarks [scenario] [--ops N] [--record file] [--replay file]
+ *
+ * Traces are text files with one operation per line, "w <tag>", "u <tag>" or "p <tag>", where <tag> is a bit-string.
+ * A line holding only a bit-string is a puncture on its first tagLen bits, as in the former serialization benchmark,
+ * so its rands.txt files (256-bit tags) replay as is. Runs in which tags do not fit the key are not reported.
+ */
+
+enum class OpType { Wrap, Unwrap, Punc };
+
+struct TraceOp {
+        OpType type;
+        Tag tag;
+};
+
+enum class TagPattern {
+    /* uniformly random tags */
+    Uniform,
+    /* tags are consecutive counter values */
+    Monotone,
+    /* uniformly random tags inside a window of windowSize tags, which moves on every windowSize operations */
+    Windowed
+};
+
+struct Scenario {
+        std::string name;
+        int tagLen;
+        int keyLen;
+        long ops;
+        double wrapRatio;
+        double unwrapRatio;
+        double puncRatio;
+        TagPattern pattern;
+        long windowSize;
+        /* unwraps pick recently wrapped tags with a Zipf(zipfS) distribution instead of uniformly */
+        bool zipfUnwrap;
+        double zipfS;
+        long sampleEvery;
+};
+
+static const std::vector<Scenario> SCENARIOS = {
+        /* the former serialization size benchmark: random punctures only */
+        {"serialization-size", 16, 128, 10000, 0, 0, 1, TagPattern::Uniform, 0, false, 0, 10},
+        {"uniform", 32, 128, 20000, 0.4, 0.4, 0.2, TagPattern::Uniform, 0, false, 0, 1000},
+        {"monotone", 32, 128, 20000, 0.4, 0.4, 0.2, TagPattern::Monotone, 0, false, 0, 1000},
+        {"windowed", 32, 128, 20000, 0.4, 0.4, 0.2, TagPattern::Windowed, 1024, false, 0, 1000},
+        {"zipf-hot-unwrap", 32, 128, 20000, 0.2, 0.7, 0.1, TagPattern::Uniform, 0, true, 1.1, 1000},
+};
+
+class TraceGenerator {
+    public:
+        explicit TraceGenerator(const Scenario &scenario) : scenario(scenario), rng(42) {}
+
+        TraceOp next() {
+            double r = std::uniform_real_distribution<double>(0, 1)(rng);
+            OpType type = r < scenario.wrapRatio ? OpType::Wrap : r < scenario.wrapRatio + scenario.unwrapRatio ? OpType::Unwrap : OpType::Punc;
+            ops++;
+            switch (type) {
+                case OpType::Wrap:
+                    return {type, nextTag()};
+                case OpType::Unwrap:
+                    return {type, wrapped.empty() ? nextTag() : wrapped[pickWrapped()]};
+                case OpType::Punc:
+                default:
+                    if (wrapped.empty()) {
+                        return {type, nextTag()};
+                    }
+                    /* expire the oldest wrapped tag */
+                    Tag oldest = wrapped.front();
+                    wrapped.pop_front();
+                    return {type, oldest};
+            }
+        }
+
+        /* Informs the generator that a wrap on tag succeeded, making it a candidate for unwrap and punc */
+        void wrappedOn(const Tag &tag) {
+            wrapped.push_back(tag);
+        }
+
+    private:
+        const Scenario &scenario;
+        std::mt19937_64 rng;
+        std::deque<Tag> wrapped;
+        long ops = 0;
+        unsigned long counter = 0;
+
+        Tag randomTag(int bits) {
+            Tag tag;
+            for (int i = 0; i < bits; i += 64) {
+                tag |= Tag(rng()) << i;
+            }
+            return tag & (~Tag() >> (MAX_TAG_LEN - bits));
+        }
+
+        Tag nextTag() {
+            switch (scenario.pattern) {
+                case TagPattern::Monotone:
+                    return Tag(counter++);
+                case TagPattern::Windowed: {
+                    unsigned long window = ops / scenario.windowSize;
+                    unsigned long offset = std::uniform_int_distribution<unsigned long>(0, scenario.windowSize - 1)(rng);
+                    return Tag(window * scenario.windowSize + offset);
+                }
+                case TagPattern::Uniform:
+                default:
+                    return randomTag(scenario.tagLen);
+            }
+        }
+
+        /* index into wrapped; rank 0 is the most recently wrapped tag */
+        size_t pickWrapped() {
+            size_t n = wrapped.size();
+            double u = std::uniform_real_distribution<double>(0, 1)(rng);
+            size_t rank;
+            if (!scenario.zipfUnwrap) {
+                rank = (size_t) (u * n);
+            } else if (std::abs(scenario.zipfS - 1) < 1e-9) {
+                rank = (size_t) std::pow((double) n, u) - 1;
+            } else {
+                double e = 1 - scenario.zipfS;
+                rank = (size_t) std::pow((std::pow((double) n, e) - 1) * u + 1, 1 / e) - 1;
+            }
+            return n - 1 - std::min(rank, n - 1);
+        }
+};
+
+static char opChar(OpType type) {
+    return type == OpType::Wrap ? 'w' : type == OpType::Unwrap ? 'u' : 'p';
+}
+
+static bool isBitString(const std::string &s) {
+    return !s.empty() && s.size() <= MAX_TAG_LEN && s.find_first_not_of("01") == std::string::npos;
+}
+
+static std::vector<TraceOp> readTrace(const std::string &path, int tagLen) {
+    std::vector<TraceOp> trace;
+    std::ifstream in(path, std::ifstream::in);
+    if (!in.is_open()) {
+        std::cerr << "File could not be read: " << path << std::endl;
+        throw std::exception();
+    }
+    std::string line;
+    for (long number = 1; std::getline(in, line); ++number) {
+        if (line.empty()) {
+            continue;
+        }
+        if (isBitString(line)) {
+            /* the leading bits, i.e. the former rand >> (MAX_TAG_LEN - tagLen) for MAX_TAG_LEN-bit lines */
+            trace.push_back({OpType::Punc, Tag(line.substr(0, tagLen))});
+            continue;
+        }
+        const std::string ops = "wup";
+        if (line.size() < 3 || ops.find(line[0]) == std::string::npos || line[1] != ' ' || !isBitString(line.substr(2))) {
+            std::cerr << "Malformed trace line " << number << ": " << line << std::endl;
+            throw std::exception();
+        }
+        OpType type = line[0] == 'w' ? OpType::Wrap : line[0] == 'u' ? OpType::Unwrap : OpType::Punc;
+        trace.push_back({type, Tag(line.substr(2))});
+    }
+    return trace;
+}
+
+/**
+ * Writes the time spent in its scope to us, also when the scope is left by an exception.
+ */
+class ScopeTimer {
+    public:
+        explicit ScopeTimer(double &us) : us(us), start(std::chrono::high_resolution_clock::now()) {}
+        ~ScopeTimer() { us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count(); }
+
+    private:
+        double &us;
+        std::chrono::high_resolution_clock::time_point start;
+};
+
+static long residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    long pages, resident;
+    if (statm >> pages >> resident) {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+static double percentile(std::vector<double> &values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, (size_t) std::ceil(p * values.size()) - (p > 0 ? 1 : 0));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+struct Sample {
+        long ops;
+        long puncs;
+        size_t nodes;
+        size_t serializedSize;
+        long resident;
+        double p50;
+        double p99;
+        double p999;
+};
+
+std::string writeResults(const Scenario &scenario, const std::vector<Sample> &samples) {
+    std::time_t time = std::time(nullptr);
+    mkdir("out", 0777);
+    std::string path = "out/workloadBenchmark_" + scenario.name + "_tagsize" + std::to_string(scenario.tagLen) + "_" + std::to_string(time) + ".tsv";
+    std::ofstream out(path, std::ofstream::out);
+    out << "ops\tpuncs\tnodes\tserialized\tresident\tp50_us\tp99_us\tp999_us" << std::endl;
+    for (const Sample &s: samples) {
+        out << s.ops << "\t" << s.puncs << "\t" << s.nodes << "\t" << s.serializedSize << "\t" << s.resident << "\t"
+            << s.p50 << "\t" << s.p99 << "\t" << s.p999 << std::endl;
+    }
+    out.close();
+    return path;
+}
+
+int main(int argc, char **argv) {
+    std::string scenarioName = "serialization-size";
+    std::string recordPath, replayPath;
+    long ops = -1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ops" && i + 1 < argc) {
+            ops = std::stol(argv[++i]);
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else {
+            scenarioName = arg;
+        }
+    }
+    auto scenarioIt = std::find_if(SCENARIOS.begin(), SCENARIOS.end(), [&](const Scenario &s) { return s.name == scenarioName; });
+    if (scenarioIt == SCENARIOS.end()) {
+        std::cerr << "Unknown scenario " << scenarioName << ", available:";
+        for (const Scenario &s: SCENARIOS) {
+            std::cerr << " " << s.name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    Scenario scenario = *scenarioIt;
+    if (ops >= 0) {
+        scenario.ops = ops;
+    }
+
+    std::vector<TraceOp> replay;
+    if (!replayPath.empty()) {
+        replay = readTrace(replayPath, scenario.tagLen);
+        scenario.ops = (long) replay.size();
+        std::cout << "Read " << replay.size() << " operations." << std::endl;
+    }
+    std::ofstream record;
+    if (!recordPath.empty()) {
+        record.open(recordPath, std::ofstream::out);
+    }
+
+    std::cout << "Starting scenario " << scenario.name << "." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    PPRF_AEAD_PKW pkw(scenario.tagLen, scenario.keyLen);
+    TraceGenerator generator(scenario);
+    std::map<std::string, std::vector<unsigned char>> ciphertexts;
+    std::vector<unsigned char> header(16, 'h');
+    std::vector<unsigned char> key(32, 'k');
+
+    std::map<OpType, std::vector<double>> latencies;
+    std::vector<double> window;
+    std::vector<Sample> samples;
+    long failures = 0;
+    long illegalTags = 0;
+    for (long i = 0; i < scenario.ops; ++i) {
+        TraceOp op = replay.empty() ? generator.next() : replay[i];
+        if (record.is_open()) {
+            record << opChar(op.type) << " " << op.tag.to_string().substr(MAX_TAG_LEN - scenario.tagLen) << "\n";
+        }
+        std::string tagKey = op.tag.to_string();
+        /* only the PKW call is timed, not the bookkeeping around it */
+        double us = -1;
+        try {
+            switch (op.type) {
+                case OpType::Wrap: {
+                    ciphertext c;
+                    {
+                        ScopeTimer timer(us);
+                        c = pkw.wrap(op.tag, header, key);
+                    }
+                    ciphertexts[tagKey] = std::move(c);
+                    generator.wrappedOn(op.tag);
+                    break;
+                }
+                case OpType::Unwrap: {
+                    auto c = ciphertexts.find(tagKey);
+                    if (c == ciphertexts.end()) {
+                        throw UnwrappingException();
+                    }
+                    ScopeTimer timer(us);
+                    pkw.unwrap(op.tag, header, c->second);
+                    break;
+                }
+                case OpType::Punc: {
+                    {
+                        ScopeTimer timer(us);
+                        pkw.punc(op.tag);
+                    }
+                    ciphertexts.erase(tagKey);
+                    break;
+                }
+            }
+        } catch (IllegalTagException &e) {
+            illegalTags++;
+            us = -1;
+        } catch (PuncturableKeyWrappingException &e) {
+            failures++;
+        }
+        if (us >= 0) {
+            latencies[op.type].push_back(us);
+            window.push_back(us);
+        }
+
+        if ((i + 1) % scenario.sampleEvery == 0 || i + 1 == scenario.ops) {
+            SecureByteBuffer serialized = pkw.serializeKey();
+            Sample s{i + 1, pkw.getNumPuncs(), pkw.getNumNodes(), serialized.size(), residentBytes(),
+                     percentile(window, 0.5), percentile(window, 0.99), percentile(window, 0.999)};
+            samples.push_back(s);
+            window.clear();
+            std::cout << "After " << s.ops << " ops (" << s.puncs << " punctures): nodes = " << s.nodes << ",\t serialized = " << s.serializedSize
+                      << ",\t resident = " << s.resident << ",\t p50/p99/p999 = " << s.p50 << "/" << s.p99 << "/" << s.p999 << " us" << std::endl;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << std::endl;
+    for (auto &entry: latencies) {
+        std::cout << opChar(entry.first) << ": " << entry.second.size() << " ops, p50/p99/p999 = " << percentile(entry.second, 0.5) << "/"
+                  << percentile(entry.second, 0.99) << "/" << percentile(entry.second, 0.999) << " us" << std::endl;
+    }
+    std::cout << "Failed operations: " << failures << std::endl;
+    if (illegalTags > 0) {
+        std::cerr << illegalTags << " operations had tags outside the key's " << scenario.tagLen
+                  << "-bit tag space; the run does not measure the scenario and is not reported." << std::endl;
+        return 1;
+    }
+    std::string path = writeResults(scenario, samples);
+    std::cout << "Finished benchmark." << std::endl;
+    std::cout << "Execution time: " << std::chrono::duration<double, std::milli>(end - start).count() << "ms" << std::endl;
+    std::cout << "Output file at: " << path << std::endl;
+}
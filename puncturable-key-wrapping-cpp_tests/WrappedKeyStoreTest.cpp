@@ -0,0 +1,116 @@
+#include "pkw/exceptions.h"
+#include "pkw/wrapped_key_store.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <vector>
+
+class WrappedKeyStoreTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            std::remove(path.c_str());
+        }
+
+        void TearDown() override {
+            std::remove(path.c_str());
+        }
+
+    public:
+        WrappedKeyStoreTest() : pkw(PPRFKey::generate(128, 32).serialize()), path("wrapped_key_store_test.log") {}
+
+        static std::vector<unsigned char> keyFor(uint32_t tag) {
+            return std::vector<unsigned char>(16 + tag % 17, (unsigned char) tag);
+        }
+
+        PPRF_AEAD_PKW pkw;
+        std::string path;
+};
+
+TEST_F(WrappedKeyStoreTest, TestPutThenGet) {
+    WrappedKeyStore store(pkw, path);
+    std::vector<unsigned char> out;
+    ASSERT_FALSE(store.get(Tag(1), out));
+    for (uint32_t tag = 0; tag < 50; ++tag) {
+        store.put(Tag(tag), std::vector<unsigned char>(tag % 5, 'h'), keyFor(tag));
+    }
+    ASSERT_EQ(store.size(), 50);
+    for (uint32_t tag = 0; tag < 50; ++tag) {
+        ASSERT_TRUE(store.get(Tag(tag), out));
+        ASSERT_EQ(out, keyFor(tag));
+    }
+    store.put(Tag(3), {}, keyFor(4));
+    ASSERT_TRUE(store.get(Tag(3), out));
+    ASSERT_EQ(out, keyFor(4)) << "A put replaces the record of the tag";
+    ASSERT_EQ(store.size(), 50);
+    ASSERT_GT(store.garbageBytes(), 0);
+}
+
+TEST_F(WrappedKeyStoreTest, TestReopen) {
+    {
+        WrappedKeyStore store(pkw, path);
+        for (uint32_t tag = 0; tag < 20; ++tag) {
+            store.put(Tag(tag), {}, keyFor(tag));
+        }
+        store.put(Tag(5), {}, keyFor(6));
+        store.punc(Tag(7));
+        store.sync();
+    }
+    pkw.punc(Tag(8));
+    WrappedKeyStore store(pkw, path);
+    ASSERT_EQ(store.size(), 18) << "Records of punctured tags are not indexed";
+    std::vector<unsigned char> out;
+    ASSERT_TRUE(store.get(Tag(5), out));
+    ASSERT_EQ(out, keyFor(6));
+    ASSERT_FALSE(store.contains(Tag(7)));
+    ASSERT_FALSE(store.contains(Tag(8)));
+    ASSERT_TRUE(store.get(Tag(19), out));
+    ASSERT_EQ(out, keyFor(19));
+}
+
+TEST_F(WrappedKeyStoreTest, TestPuncAndCompaction) {
+    WrappedKeyStore store(pkw, path);
+    std::vector<unsigned char> header(1000, 'h');
+    for (uint32_t tag = 0; tag < 200; ++tag) {
+        store.put(Tag(tag), header, keyFor(tag));
+    }
+    const size_t full = store.logBytes();
+    for (uint32_t tag = 0; tag < 150; ++tag) {
+        store.punc(Tag(tag));
+    }
+    ASSERT_EQ(store.size(), 50);
+    ASSERT_LT(store.logBytes(), full) << "Compaction ran automatically";
+    ASSERT_LE(store.garbageBytes(), store.logBytes() - store.garbageBytes());
+
+    pkw.punc(Tag(199));
+    std::vector<unsigned char> out;
+    ASSERT_THROW(store.get(Tag(199), out), IllegalTagException);
+    store.compact();
+    ASSERT_EQ(store.size(), 49);
+    ASSERT_EQ(store.garbageBytes(), 0);
+    ASSERT_FALSE(store.get(Tag(199), out));
+    ASSERT_TRUE(store.get(Tag(198), out));
+    ASSERT_EQ(out, keyFor(198));
+    ASSERT_THROW(store.put(Tag(1), header, keyFor(1)), IllegalTagException);
+}
+
+TEST_F(WrappedKeyStoreTest, TestGetRange) {
+    WrappedKeyStore store(pkw, path);
+    for (int tag = 100; tag > 0; tag -= 3) {
+        store.put(Tag(tag), {}, keyFor(tag));
+    }
+    pkw.punc(Tag(52));
+    std::vector<uint32_t> seen;
+    size_t n = store.getRange(Tag(40), Tag(60), [&](const Tag &tag, const std::vector<unsigned char> &key) {
+        seen.push_back((uint32_t) tag.to_ulong());
+        EXPECT_EQ(key, keyFor((uint32_t) tag.to_ulong()));
+    });
+    ASSERT_EQ(seen, std::vector<uint32_t>({40, 43, 46, 49, 55, 58}));
+    ASSERT_EQ(n, seen.size());
+    ASSERT_EQ(store.getRange(Tag(60), Tag(40), [](const Tag &, const std::vector<unsigned char> &) {}), 0);
+}
+
+TEST_F(WrappedKeyStoreTest, TestNotALog) {
+    FILE *f = std::fopen(path.c_str(), "wb");
+    std::fputs("not a log", f);
+    std::fclose(f);
+    ASSERT_THROW(WrappedKeyStore(pkw, path), ImportException);
+}